@@ -165,23 +165,46 @@ bool NvidiaAV1Encoder::EncodeYUV420(const std::vector<uint8_t>& yuv_data,
     return false;
   }
   
-  return EncodeFrame(yuv_data, encoded_frame, false);
+  return EncodeYUV420(VideoFrameView::FromYUV420(yuv_data.data(), width_, height_),
+                      encoded_frame);
 }
 
-bool NvidiaAV1Encoder::EncodeNV12(const std::vector<uint8_t>& nv12_data,
-                                   std::vector<uint8_t>* encoded_frame) {
-  if (!initialized_ || nv12_data.size() < frame_size_) {
+bool NvidiaAV1Encoder::EncodeYUV420(const VideoFrameView& frame,
+                                     std::vector<uint8_t>* encoded_frame) {
+  std::vector<EncodedPacket> packets;
+  if (!EncodeYUV420(frame, &packets)) {
     return false;
   }
   
-  return EncodeFrame(nv12_data, encoded_frame, true);
+  encoded_frame->clear();
+  AppendPackets(packets, encoded_frame);
+  return true;
 }
 
-bool NvidiaAV1Encoder::EncodeFrame(const std::vector<uint8_t>& frame_data,
-                                   std::vector<uint8_t>* encoded_frame,
-                                   bool is_nv12) {
-  // Clear output buffer
-  encoded_frame->clear();
+bool NvidiaAV1Encoder::EncodeYUV420(const VideoFrameView& frame,
+                                     std::vector<EncodedPacket>* packets) {
+  if (!initialized_) {
+    return false;
+  }
+  
+  // Copy the planes into frame_, interleaving U and V when it is NV12
+  AVFrame* input = PrepareEncoderFrame(frame, frame_, nullptr);
+  if (!input) {
+    return false;
+  }
+  
+  if (frame.pts >= 0) {
+    pts_ = frame.pts;
+  }
+  
+  return EncodeFrame(input, packets);
+}
+
+bool NvidiaAV1Encoder::EncodeNV12(const std::vector<uint8_t>& nv12_data,
+                                   std::vector<uint8_t>* encoded_frame) {
+  if (!initialized_ || nv12_data.size() < frame_size_) {
+    return false;
+  }
   
   // Make sure the frame is writable
   int ret = av_frame_make_writable(frame_);
@@ -190,64 +213,51 @@ bool NvidiaAV1Encoder::EncodeFrame(const std::vector<uint8_t>& frame_data,
     return false;
   }
   
-  // Copy frame data
-  if (is_nv12) {
-    // NV12: Y plane followed by interleaved UV plane
-    std::memcpy(frame_->data[0], frame_data.data(), y_plane_size_);
-    std::memcpy(frame_->data[1], frame_data.data() + y_plane_size_, y_plane_size_ / 2);
-  } else {
-    // YUV420P to NV12 conversion (if codec_context_->pix_fmt is NV12)
-    if (codec_context_->pix_fmt == AV_PIX_FMT_NV12) {
-      // Copy Y plane directly
-      std::memcpy(frame_->data[0], frame_data.data(), y_plane_size_);
-      
-      // Convert separate U and V planes to interleaved UV plane
-      const uint8_t* u_plane = frame_data.data() + y_plane_size_;
-      const uint8_t* v_plane = frame_data.data() + y_plane_size_ + (y_plane_size_ / 4);
-      uint8_t* uv_plane = frame_->data[1];
-      
-      for (int i = 0; i < y_plane_size_ / 4; i++) {
-        uv_plane[i * 2] = u_plane[i];
-        uv_plane[i * 2 + 1] = v_plane[i];
-      }
-    } else {
-      // If the codec accepts YUV420P directly, just copy the planes
-      std::memcpy(frame_->data[0], frame_data.data(), y_plane_size_);
-      std::memcpy(frame_->data[1], frame_data.data() + y_plane_size_, y_plane_size_ / 4);
-      std::memcpy(frame_->data[2], frame_data.data() + y_plane_size_ + (y_plane_size_ / 4), y_plane_size_ / 4);
-    }
+  // NV12: Y plane followed by interleaved UV plane
+  std::memcpy(frame_->data[0], nv12_data.data(), y_plane_size_);
+  std::memcpy(frame_->data[1], nv12_data.data() + y_plane_size_, y_plane_size_ / 2);
+  
+  std::vector<EncodedPacket> packets;
+  if (!EncodeFrame(frame_, &packets)) {
+    return false;
   }
   
+  encoded_frame->clear();
+  AppendPackets(packets, encoded_frame);
+  return true;
+}
+
+bool NvidiaAV1Encoder::EncodeFrame(AVFrame* frame,
+                                   std::vector<EncodedPacket>* packets) {
+  // Clear output list
+  packets->clear();
+  
   // Set timestamp
-  frame_->pts = pts_++;
+  frame->pts = pts_++;
   
   // Send frame for encoding
-  ret = avcodec_send_frame(codec_context_, frame_);
+  int ret = avcodec_send_frame(codec_context_, frame);
   if (ret < 0) {
     std::cerr << "Error sending frame for encoding: " << ret << std::endl;
     return false;
   }
   
   // Receive encoded packets
-  ret = avcodec_receive_packet(codec_context_, packet_);
-  if (ret < 0) {
-    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-      // Need more data or end of stream, not necessarily an error
-      return true;
-    } else {
-      std::cerr << "Error receiving packet from encoder: " << ret << std::endl;
-      return false;
+  while (true) {
+    ret = avcodec_receive_packet(codec_context_, packet_);
+    if (ret < 0) {
+      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+        // Need more data or end of stream, not necessarily an error
+        return true;
+      } else {
+        std::cerr << "Error receiving packet from encoder: " << ret << std::endl;
+        return false;
+      }
     }
+    
+    // Hand the packet buffer to the caller without copying it
+    packets->push_back(EncodedPacket::TakeFrom(packet_));
   }
-  
-  // Copy the encoded data to output vector
-  encoded_frame->resize(packet_->size);
-  std::memcpy(encoded_frame->data(), packet_->data, packet_->size);
-  
-  // Unref packet for reuse
-  av_packet_unref(packet_);
-  
-  return true;
 }
 
 }  // namespace media
\ No newline at end of file
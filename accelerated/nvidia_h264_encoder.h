@@ -13,6 +13,9 @@ extern "C" {
 #include <libavutil/imgutils.h>
 }
 
+#include "media_encoded_packet.h"
+#include "media_video_frame.h"
+
 namespace media {
 
 /**
@@ -57,6 +60,26 @@ public:
      */
     bool EncodeYUV420(const std::vector<uint8_t>& yuv_data, std::vector<uint8_t>* encoded_frame);
 
+    /**
+     * Encode a YUV420 frame described by plane pointers and strides.
+     * The planes are interleaved into the encoder's NV12 frame in a single pass.
+     *
+     * @param frame Input frame planes, strides and dimensions
+     * @param encoded_frame Output encoded H.264 frame
+     * @return True if encoding was successful, false otherwise
+     */
+    bool EncodeYUV420(const VideoFrameView& frame, std::vector<uint8_t>* encoded_frame);
+
+    /**
+     * Encode a YUV420 frame and return every packet the encoder produced.
+     * Packets reference the encoder's buffers and are never copied.
+     *
+     * @param frame Input frame planes, strides and dimensions
+     * @param packets Output encoded packets with timestamps and keyframe flags
+     * @return True if encoding was successful, false otherwise
+     */
+    bool EncodeYUV420(const VideoFrameView& frame, std::vector<EncodedPacket>* packets);
+
     /**
      * Encode a NV12 format frame.
      *
@@ -74,9 +97,7 @@ private:
     bool Initialize(const NvidiaH264EncoderConfig& config);
     
     // Common encoding function used by both EncodeYUV420 and EncodeNV12
-    bool EncodeFrame(const std::vector<uint8_t>& frame_data, 
-                     std::vector<uint8_t>* encoded_frame, 
-                     bool is_nv12);
+    bool EncodeFrame(AVFrame* frame, std::vector<EncodedPacket>* packets);
 
     // FFmpeg/avcodec objects
     AVCodecContext* codec_context_ = nullptr;
@@ -9,9 +9,12 @@ extern "C" {
 }
 
 #include <cstring>
+#include <deque>
 #include <iostream>
 #include <map>
 
+#include "media_stream_parser.h"
+
 namespace media {
 
 namespace {
@@ -155,6 +158,18 @@ class AV1DecoderImpl : public AV1Decoder {
     // Apply color conversion settings
     ApplyColorConversionSettings();
 
+    // Sequence header passed out of band (av1C or OBUs)
+    if (!config_.extradata.empty()) {
+      codec_ctx_->extradata = static_cast<uint8_t*>(
+          av_mallocz(config_.extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+      if (!codec_ctx_->extradata) {
+        std::cerr << "Failed to allocate extradata" << std::endl;
+        return false;
+      }
+      std::memcpy(codec_ctx_->extradata, config_.extradata.data(), config_.extradata.size());
+      codec_ctx_->extradata_size = static_cast<int>(config_.extradata.size());
+    }
+
     // Open the codec
     if (avcodec_open2(codec_ctx_, codec, nullptr) < 0) {
       std::cerr << "Failed to open codec" << std::endl;
@@ -188,15 +203,36 @@ class AV1DecoderImpl : public AV1Decoder {
 
   int DecodeToYUV420(std::vector<uint8_t>& yuv_frame,
                      const std::vector<uint8_t>* av1_frame) override {
-    if (!initialized_ && !Initialize()) {
+    DecodedFrame frame;
+    if (Decode(&frame, av1_frame) <= 0) {
       return 0;
     }
 
-    if (!av1_frame || av1_frame->empty()) {
-      std::cerr << "Invalid input frame" << std::endl;
+    // Pack the planes into the output buffer in the requested layout,
+    // honoring each plane's stride
+    if (!frame.CopyTo(&yuv_frame, config_.pixel_format)) {
       return 0;
     }
 
+    return 1;
+  }
+
+  int Decode(DecodedFrame* frame,
+             const std::vector<uint8_t>* av1_frame) override {
+    if (!initialized_ && !Initialize()) {
+      return -1;
+    }
+
+    if (!frame) {
+      return -1;
+    }
+
+    // End of stream: queue what the decoder still holds
+    if (!av1_frame || av1_frame->empty()) {
+      Drain();
+      return NextFrame(frame);
+    }
+
     // Reset packet
     av_packet_unref(packet_);
     
@@ -206,11 +242,17 @@ class AV1DecoderImpl : public AV1Decoder {
     uint8_t* parsed_data = nullptr;
     int parsed_size = 0;
     
-    parsed_size = av_parser_parse2(parser_ctx_, codec_ctx_, &parsed_data, &parsed_size,
-                                 data, data_size, AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+    // The return value is the number of input bytes consumed; the unit to
+    // decode comes back through parsed_data/parsed_size
+    int used = av_parser_parse2(parser_ctx_, codec_ctx_, &parsed_data, &parsed_size,
+                                data, data_size, AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
     
-    if (parsed_size < 0) {
+    if (used < 0) {
       std::cerr << "Error during parsing" << std::endl;
+      return used;
+    }
+    if (parsed_size <= 0) {
+      // The parser is holding the data back
       return 0;
     }
     
@@ -219,52 +261,74 @@ class AV1DecoderImpl : public AV1Decoder {
     packet_->size = parsed_size;
 
     // Send packet to decoder
-    int ret = avcodec_send_packet(codec_ctx_, packet_);
+    int ret = SendPacket(packet_);
     if (ret < 0) {
       std::cerr << "Error sending packet for decoding" << std::endl;
-      return 0;
+      return ret;
     }
 
-    // Receive frame
-    ret = avcodec_receive_frame(codec_ctx_, frame_);
-    if (ret < 0) {
-      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-        // Need more data
-        return 0;
+    return NextFrame(frame);
+  }
+
+  int DecodeStream(const uint8_t* data, size_t size,
+                   std::vector<DecodedFrame>* frames) override {
+    if (!initialized_ && !Initialize()) {
+      return -1;
+    }
+
+    if (!frames) {
+      return -1;
+    }
+
+    int count = 0;
+    stream_parser_.Feed(data, size);
+    while (stream_parser_.Next(codec_ctx_, packet_)) {
+      if (SendPacket(packet_) < 0) {
+        // A damaged temporal unit should not end the stream
+        std::cerr << "Error sending temporal unit for decoding" << std::endl;
+        continue;
       }
-      std::cerr << "Error during decoding" << std::endl;
-      return 0;
+      count += ReceiveFrames(frames);
     }
 
-    // Get frame dimensions
-    width_ = frame_->width;
-    height_ = frame_->height;
+    // End of stream: drain the decoder
+    if (!data || size == 0) {
+      count += Flush(frames);
+    }
 
-    // Calculate required buffer size for YUV420 format
-    int y_size = width_ * height_;
-    int u_size = (width_ / 2) * (height_ / 2);
-    int v_size = u_size;
-    int total_size = y_size + u_size + v_size;
+    return count;
+  }
 
-    // Resize output buffer
-    yuv_frame.resize(total_size);
+  int ReceiveFrames(std::vector<DecodedFrame>* frames) override {
+    if (!initialized_ || !frames) {
+      return 0;
+    }
 
-    // Copy Y plane
-    std::memcpy(yuv_frame.data(), frame_->data[0], y_size);
-    
-    // Copy U plane
-    std::memcpy(yuv_frame.data() + y_size, frame_->data[1], u_size);
-    
-    // Copy V plane
-    std::memcpy(yuv_frame.data() + y_size + u_size, frame_->data[2], v_size);
+    int count = 0;
+    DecodedFrame frame;
+    while (NextFrame(&frame) > 0) {
+      frames->push_back(frame);
+      count++;
+    }
+    return count;
+  }
+
+  int Flush(std::vector<DecodedFrame>* frames) override {
+    if (!initialized_ || !frames) {
+      return 0;
+    }
 
-    // Unref frame for next decode
-    av_frame_unref(frame_);
+    Drain();
+    return ReceiveFrames(frames);
+  }
 
-    return 1;
+  int GetDelay() const override {
+    return initialized_ ? DecoderDelay(codec_ctx_) : 0;
   }
 
   void Reset() override {
+    stream_parser_.Reset();
+    pending_.clear();
     if (codec_ctx_) {
       avcodec_flush_buffers(codec_ctx_);
     }
@@ -279,6 +343,70 @@ class AV1DecoderImpl : public AV1Decoder {
   }
 
  private:
+  // Takes the next ready picture from the decoder; 1 if there was one
+  int ReceiveFrame(DecodedFrame* frame) {
+    int ret = avcodec_receive_frame(codec_ctx_, frame_);
+    if (ret < 0) {
+      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+        // Need more data
+        return 0;
+      }
+      std::cerr << "Error during decoding" << std::endl;
+      return ret;
+    }
+
+    // Get frame dimensions
+    width_ = frame_->width;
+    height_ = frame_->height;
+
+    // High bit depth pictures stay native only when the caller asked for them
+    if (!config_.output_10bit && !ReduceTo8Bit(frame_)) {
+      av_frame_unref(frame_);
+      return -1;
+    }
+
+    // Hand the decoder's buffers to the caller without copying them
+    *frame = DecodedFrame::TakeFrom(frame_);
+
+    return 1;
+  }
+
+  // Hands out the oldest picture, queued ones first; 1 if there was one
+  int NextFrame(DecodedFrame* frame) {
+    if (pending_.empty()) {
+      return ReceiveFrame(frame);
+    }
+    *frame = pending_.front();
+    pending_.pop_front();
+    return 1;
+  }
+
+  // Sends a packet (nullptr to drain). On EAGAIN the ready pictures move to
+  // pending_ and the packet is sent again instead of being lost.
+  int SendPacket(const AVPacket* packet) {
+    int ret = avcodec_send_packet(codec_ctx_, packet);
+    if (ret == AVERROR(EAGAIN)) {
+      DecodedFrame frame;
+      while (ReceiveFrame(&frame) > 0) {
+        pending_.push_back(frame);
+      }
+      ret = avcodec_send_packet(codec_ctx_, packet);
+    }
+    return ret;
+  }
+
+  // Sends the end of stream, queues every picture left and resets the
+  // decoder for the next stream
+  void Drain() {
+    if (SendPacket(nullptr) >= 0) {
+      DecodedFrame frame;
+      while (ReceiveFrame(&frame) > 0) {
+        pending_.push_back(frame);
+      }
+    }
+    avcodec_flush_buffers(codec_ctx_);
+  }
+
   void ApplyBasicConfig() {
     // Thread management
     codec_ctx_->thread_count = config_.threads;
@@ -446,6 +574,10 @@ class AV1DecoderImpl : public AV1Decoder {
   AV1DecoderConfig config_;
   AVCodecContext* codec_ctx_ = nullptr;
   AVCodecParserContext* parser_ctx_ = nullptr;
+  StreamParser stream_parser_{CodecType::AV1};
+
+  // Pictures taken out of the decoder ahead of the caller, oldest first
+  std::deque<DecodedFrame> pending_;
   AVFrame* frame_ = nullptr;
   AVPacket* packet_ = nullptr;
   int width_ = 0;
@@ -2,10 +2,13 @@
 #ifndef MEDIA_AV1_DECODER_H_
 #define MEDIA_AV1_DECODER_H_
 
+#include <cstddef>
 #include <memory>
 #include <vector>
 #include <string>
 
+#include "media_decoded_frame.h"
+
 namespace media {
 
 struct AV1DecoderConfig {
@@ -71,6 +74,9 @@ struct AV1DecoderConfig {
   std::string color_trc;              // Transfer characteristics (e.g., "bt709", "pq")
   std::string colorspace;             // Colorspace (e.g., "bt709", "bt2020nc")
   std::string color_range;            // Color range (e.g., "tv", "pc")
+  int pixel_format = -1;              // DecodeToYUV420 layout: AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12 or -1 (decoder's own)
+  std::vector<uint8_t> extradata;     // Out-of-band sequence header (av1C or OBUs), empty if in-band
+  bool output_10bit = false;          // Hand out 10-bit pictures as YUV420P10 instead of rounding to 8 bits
 };
 
 class AV1Decoder {
@@ -80,10 +86,42 @@ class AV1Decoder {
 
   virtual ~AV1Decoder() = default;
 
-  // Decodes the AV1 compressed frame into YUV420 format
+  // Decodes the AV1 compressed frame into YUV420 format. With output_10bit,
+  // 10-bit frames are written as YUV420P10 (two bytes per sample).
   // Returns 1 on success, 0 on failure
   virtual int DecodeToYUV420(std::vector<uint8_t>& yuv_frame,
                              const std::vector<uint8_t>* av1_frame) = 0;
+
+  // Decodes the AV1 compressed frame without copying the picture. |frame|
+  // references the decoder's buffers and stays valid across later calls.
+  // An empty packet ends the stream; each such call then hands out one of
+  // the remaining pictures until 0 is returned.
+  // Returns 1 if a frame was output, 0 if more data is needed, negative on error
+  virtual int Decode(DecodedFrame* frame,
+                     const std::vector<uint8_t>* av1_frame) = 0;
+
+  // Streaming input: |data| is any slice of a low-overhead OBU stream, such
+  // as one socket read. Temporal units are cut at temporal delimiter OBUs
+  // without copying the chunk, and every frame they complete is appended
+  // to |frames|. An empty chunk ends the stream and drains the decoder.
+  // Returns the number of frames appended, negative on failure
+  virtual int DecodeStream(const uint8_t* data, size_t size,
+                           std::vector<DecodedFrame>* frames) = 0;
+
+  // Decode() returns at most one frame per packet. With frame threading a
+  // packet can release several, so call this after each Decode() to
+  // collect the rest; they are appended to |frames| in output order.
+  // Returns the number of frames appended
+  virtual int ReceiveFrames(std::vector<DecodedFrame>* frames) = 0;
+
+  // Ends the stream: appends every picture still buffered to |frames| and
+  // leaves the decoder ready for a new stream.
+  // Returns the number of frames appended
+  virtual int Flush(std::vector<DecodedFrame>* frames) = 0;
+
+  // Frames the decoder holds back before output (reorder buffer plus frame
+  // threads), i.e. how far output lags input
+  virtual int GetDelay() const = 0;
                             
   // Resets the decoder state
   virtual void Reset() = 0;
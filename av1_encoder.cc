@@ -6,6 +6,7 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
 }
 
 namespace media {
@@ -17,6 +18,14 @@ AV1Encoder::~AV1Encoder() {
     av_frame_free(&frame_);
   }
   
+  if (input_frame_) {
+    av_frame_free(&input_frame_);
+  }
+  
+  if (packet_) {
+    av_packet_free(&packet_);
+  }
+  
   if (codec_context_) {
     avcodec_free_context(&codec_context_);
   }
@@ -54,9 +63,14 @@ bool AV1Encoder::Initialize(const AV1EncoderConfig& config) {
   codec_context_->framerate = AVRational{config.framerate, 1};
   codec_context_->bit_rate = config.bitrate;
   codec_context_->gop_size = config.keyframe_interval;
+  if (!config.auto_keyframe) {
+    // libaom only places keyframes on its own while min and max differ
+    codec_context_->keyint_min = config.keyframe_interval;
+  }
   codec_context_->max_b_frames = 0;       // AV1 doesn't use B-frames
-  codec_context_->pix_fmt = AV_PIX_FMT_YUV420P;
+  codec_context_->pix_fmt = config.bit_depth == 10 ? AV_PIX_FMT_YUV420P10LE : AV_PIX_FMT_YUV420P;
   codec_context_->thread_count = config.threads;
+  clock_ = FrameClock(config.framerate);
 
   // Set all advanced encoder parameters
   if (!SetEncoderParameters()) {
@@ -89,6 +103,20 @@ bool AV1Encoder::Initialize(const AV1EncoderConfig& config) {
     return false;
   }
 
+  // Allocate the frame used to reference caller-owned planes
+  input_frame_ = av_frame_alloc();
+  if (!input_frame_) {
+    std::cerr << "Failed to allocate input frame" << std::endl;
+    return false;
+  }
+
+  // Allocate the packet reused for every avcodec_receive_packet() call
+  packet_ = av_packet_alloc();
+  if (!packet_) {
+    std::cerr << "Failed to allocate packet" << std::endl;
+    return false;
+  }
+
   initialized_ = true;
   return true;
 }
@@ -180,6 +208,9 @@ bool AV1Encoder::SetEncoderParameters() {
 
   // Set color properties
   codec_context_->color_range = config_.color_range ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+  if (config_.colorspace >= 0) {
+    codec_context_->colorspace = static_cast<AVColorSpace>(config_.colorspace);
+  }
 
   // Partition settings
   av_opt_set_int(codec_context_->priv_data, "enable-rect-partitions", config_.enable_rect_partitions ? 1 : 0, 0);
@@ -222,68 +253,78 @@ bool AV1Encoder::EncodeYUV420(const std::vector<uint8_t>& yuv_data,
     return false;
   }
 
-  // Make sure the frame is writable
-  int ret = av_frame_make_writable(frame_);
-  if (ret < 0) {
-    std::cerr << "Failed to make frame writable" << std::endl;
+  // Check input size; 10-bit input has two bytes per sample
+  const int bit_depth = av_pix_fmt_desc_get(codec_context_->pix_fmt)->comp[0].depth;
+  if (yuv_data.size() < YUV420BufferSize(config_.width, config_.height, bit_depth)) {
+    std::cerr << "Input YUV data is too small" << std::endl;
     return false;
   }
 
-  // Calculate plane sizes
-  int y_size = config_.width * config_.height;
-  int u_size = y_size / 4;
-  int v_size = y_size / 4;
+  return EncodeYUV420(
+      VideoFrameView::FromYUV420(yuv_data.data(), config_.width, config_.height, bit_depth),
+      output_frame);
+}
 
-  // Check input size
-  if (yuv_data.size() < static_cast<size_t>(y_size + u_size + v_size)) {
-    std::cerr << "Input YUV data is too small" << std::endl;
+bool AV1Encoder::EncodeYUV420(const VideoFrameView& frame,
+                             std::vector<uint8_t>* output_frame) {
+  if (!initialized_ || !output_frame) {
     return false;
   }
 
-  // Copy Y plane
-  std::memcpy(frame_->data[0], yuv_data.data(), y_size);
-  
-  // Copy U plane
-  std::memcpy(frame_->data[1], yuv_data.data() + y_size, u_size);
-  
-  // Copy V plane
-  std::memcpy(frame_->data[2], yuv_data.data() + y_size + u_size, v_size);
+  std::vector<EncodedPacket> packets;
+  if (!EncodeYUV420(frame, &packets)) {
+    return false;
+  }
+
+  output_frame->clear();
+  AppendPackets(packets, output_frame);
+  return true;
+}
+
+bool AV1Encoder::EncodeYUV420(const VideoFrameView& frame,
+                             std::vector<EncodedPacket>* packets) {
+  if (!initialized_ || !packets) {
+    return false;
+  }
+
+  // Reference the caller planes directly or copy them into frame_
+  AVFrame* input = PrepareEncoderFrame(frame, frame_, input_frame_);
+  if (!input) {
+    return false;
+  }
 
   // Set presentation timestamp
-  frame_->pts = pts_++;
+  int64_t pts = clock_.Next();
+  input->pts = frame.pts >= 0 ? frame.pts : pts;
 
   // Encode the frame
-  ret = avcodec_send_frame(codec_context_, frame_);
+  int ret = avcodec_send_frame(codec_context_, input);
+  av_frame_unref(input_frame_);
   if (ret < 0) {
     std::cerr << "Error sending frame for encoding" << std::endl;
     return false;
   }
 
-  // Get encoded packets
-  AVPacket* packet = av_packet_alloc();
-  if (!packet) {
-    std::cerr << "Failed to allocate packet" << std::endl;
+  return ReceivePackets(packets);
+}
+
+bool AV1Encoder::Flush(std::vector<uint8_t>* output_frame) {
+  if (!initialized_ || !output_frame) {
     return false;
   }
 
-  bool success = false;
-  ret = avcodec_receive_packet(codec_context_, packet);
-  if (ret == 0) {
-    success = ProcessEncodedPacket(packet, output_frame);
-  } else if (ret == AVERROR(EAGAIN)) {
-    // No output packet available yet, but not an error
-    success = true;
-    output_frame->clear();
-  } else {
-    std::cerr << "Error during encoding" << std::endl;
+  std::vector<EncodedPacket> packets;
+  if (!Flush(&packets)) {
+    return false;
   }
 
-  av_packet_free(&packet);
-  return success;
+  output_frame->clear();
+  AppendPackets(packets, output_frame);
+  return true;
 }
 
-bool AV1Encoder::Flush(std::vector<uint8_t>* output_frame) {
-  if (!initialized_ || !output_frame) {
+bool AV1Encoder::Flush(std::vector<EncodedPacket>* packets) {
+  if (!initialized_ || !packets) {
     return false;
   }
 
@@ -295,38 +336,51 @@ bool AV1Encoder::Flush(std::vector<uint8_t>* output_frame) {
   }
 
   // Get remaining packets
-  AVPacket* packet = av_packet_alloc();
-  if (!packet) {
-    std::cerr << "Failed to allocate packet" << std::endl;
+  return ReceivePackets(packets);
+}
+
+bool AV1Encoder::UpdateRateControl(int bitrate, int max_bitrate,
+                                   int buffer_size, int framerate) {
+  if (!initialized_) {
     return false;
   }
 
-  bool success = false;
-  ret = avcodec_receive_packet(codec_context_, packet);
-  if (ret == 0) {
-    success = ProcessEncodedPacket(packet, output_frame);
-  } else if (ret == AVERROR_EOF) {
-    // End of stream, no more output packets
-    success = true;
-    output_frame->clear();
-  } else {
-    std::cerr << "Error during flushing" << std::endl;
+  // FFmpeg hands the bitrate and buffer targets to libaom only when the
+  // codec is opened, so they cannot change on a running encoder
+  if (bitrate > 0 || max_bitrate > 0 || buffer_size > 0) {
+    std::cerr << "Bitrate and VBV updates are not supported by the running AV1 encoder"
+              << std::endl;
+    return false;
   }
 
-  av_packet_free(&packet);
-  return success;
-}
-
-bool AV1Encoder::ProcessEncodedPacket(AVPacket* packet, std::vector<uint8_t>* output_frame) {
-  if (!packet || !output_frame) {
+  // The time base is fixed once the codec is open, so a lower rate is
+  // expressed through wider timestamp spacing, which libaom rate control
+  // follows frame by frame
+  if (framerate > 0 && !clock_.SetFramerate(framerate)) {
+    std::cerr << "Frame rate " << framerate
+              << " exceeds the rate the encoder was opened with" << std::endl;
     return false;
   }
 
-  // Resize output vector and copy encoded data
-  output_frame->resize(packet->size);
-  std::memcpy(output_frame->data(), packet->data, packet->size);
-  
   return true;
 }
 
+bool AV1Encoder::ReceivePackets(std::vector<EncodedPacket>* packets) {
+  packets->clear();
+
+  while (true) {
+    int ret = avcodec_receive_packet(codec_context_, packet_);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+      // No more output packets available yet, but not an error
+      return true;
+    } else if (ret < 0) {
+      std::cerr << "Error during encoding" << std::endl;
+      return false;
+    }
+
+    // Hand the packet buffer to the caller without copying it
+    packets->push_back(EncodedPacket::TakeFrom(packet_));
+  }
+}
+
 }  // namespace media
\ No newline at end of file
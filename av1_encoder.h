@@ -13,6 +13,9 @@ extern "C" {
 #include <libavutil/opt.h>
 }
 
+#include "media_encoded_packet.h"
+#include "media_video_frame.h"
+
 namespace media {
 
 // Enumeration for AV1 available presets
@@ -59,6 +62,7 @@ struct AV1EncoderConfig {
 
   // Basic encoding parameters
   int keyframe_interval = 120;  // Default: every 2s at 60fps
+  bool auto_keyframe = true;    // Let libaom add keyframes before the interval ends
   int threads = 4;              // Default: 4 encoding threads
   int crf = 23;                 // Constant Rate Factor (quality, lower is better)
   
@@ -98,6 +102,8 @@ struct AV1EncoderConfig {
   
   // Color parameters
   int color_range = 0;          // Color range (0=limited, 1=full)
+  int colorspace = -1;          // Matrix coefficients (AVColorSpace, -1 = unspecified)
+  int bit_depth = 8;            // 8, or 10 for YUV420P10 input (main profile)
   
   // Complexity parameters
   bool enable_superblock_split = true; // Allow more aggressive superblock splits
@@ -127,8 +133,26 @@ class AV1Encoder {
   bool EncodeYUV420(const std::vector<uint8_t>& yuv_data, 
                    std::vector<uint8_t>* output_frame);
 
+  // Encodes a YUV420 frame described by plane pointers and strides.
+  // Planes are read in place when their layout allows it, otherwise they are
+  // copied once, row by row, into the encoder's frame.
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* output_frame);
+
+  // Encodes a frame and returns every packet the encoder produced for it.
+  // Packets reference the encoder's buffers directly and keep packet
+  // boundaries, timestamps and the keyframe flag.
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets);
+
   // Flush the encoder to get any pending frames
   bool Flush(std::vector<uint8_t>* output_frame);
+  bool Flush(std::vector<EncodedPacket>* packets);
+
+  // Change the frame rate of the running encoder, up to the rate it was
+  // opened with. libaom takes bitrate and buffer size only when it is
+  // opened, so nonzero values for them are rejected.
+  bool UpdateRateControl(int bitrate, int max_bitrate, int buffer_size, int framerate);
 
  private:
   // Private constructor, use Create() instead
@@ -137,8 +161,8 @@ class AV1Encoder {
   // Initializes the encoder with the provided configuration
   bool Initialize(const AV1EncoderConfig& config);
 
-  // Process encoded packets
-  bool ProcessEncodedPacket(AVPacket* packet, std::vector<uint8_t>* output_frame);
+  // Drains every packet the encoder has ready into |packets|
+  bool ReceivePackets(std::vector<EncodedPacket>* packets);
 
   // Helper to set all config parameters
   bool SetEncoderParameters();
@@ -147,7 +171,9 @@ class AV1Encoder {
   AV1EncoderConfig config_;
   AVCodecContext* codec_context_ = nullptr;
   AVFrame* frame_ = nullptr;
-  int64_t pts_ = 0;
+  AVFrame* input_frame_ = nullptr;  // References caller planes, never owns them
+  AVPacket* packet_ = nullptr;
+  FrameClock clock_;  // Timestamps in the time base the codec was opened with
   bool initialized_ = false;
 };
 
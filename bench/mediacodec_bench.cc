@@ -0,0 +1,728 @@
+// mediacodec_bench: encode/decode throughput over synthetic content
+//
+// Every run renders the same deterministic clip in memory (scrolling
+// gradient, moving blocks, noise and a frame counter drawn as text), so
+// results are comparable across machines and commits without test media.
+// Each codec is run at every preset and thread count; the Opus encoder and
+// decoder are run over a generated tone-plus-noise signal. Results are
+// written as JSON to stdout or to the file given with --output.
+//
+// Usage:
+//   mediacodec_bench [--width W] [--height H] [--frames N]
+//                    [--codecs h264,hevc,vp8,vp9,av1,opus]
+//                    [--threads 1,2,4] [--output results.json]
+
+#include "media_video_encoder.h"
+#include "media_video_decoder.h"
+#include "opus_encoder.h"
+#include "opus_decoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif !defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Small deterministic generator so the noise is identical on every platform
+class Lcg {
+public:
+    explicit Lcg(uint32_t seed) : state_(seed) {}
+
+    uint32_t Next() {
+        state_ = state_ * 1664525u + 1013904223u;
+        return state_ >> 8;
+    }
+
+private:
+    uint32_t state_;
+};
+
+// 3x5 digit glyphs, one bit per pixel, top row first
+const uint16_t kDigitGlyphs[10] = {
+    0x7B6F, 0x2C97, 0x73E7, 0x73CF, 0x5BC9, 0x79CF, 0x79EF, 0x7249, 0x7BEF, 0x7BCF
+};
+
+void DrawDigit(uint8_t* y, int stride, int x0, int y0, int scale, int digit, uint8_t value) {
+    for (int row = 0; row < 5; row++) {
+        for (int col = 0; col < 3; col++) {
+            if (!(kDigitGlyphs[digit] & (1 << (14 - row * 3 - col)))) {
+                continue;
+            }
+            for (int dy = 0; dy < scale; dy++) {
+                uint8_t* line = y + (y0 + row * scale + dy) * stride + x0 + col * scale;
+                std::memset(line, value, scale);
+            }
+        }
+    }
+}
+
+// Renders frame |index| of the synthetic clip into a packed YUV420 buffer:
+// a diagonal gradient scrolling right, two blocks moving in opposite
+// directions, a noise band that changes every frame and the frame number
+// printed in the top left corner.
+void RenderFrame(std::vector<uint8_t>* frame, int width, int height, int index) {
+    uint8_t* y = frame->data();
+    uint8_t* u = y + width * height;
+    uint8_t* v = u + (width / 2) * (height / 2);
+    const int chroma_width = width / 2;
+    const int chroma_height = height / 2;
+
+    // Gradient background
+    for (int row = 0; row < height; row++) {
+        uint8_t* line = y + row * width;
+        for (int col = 0; col < width; col++) {
+            line[col] = static_cast<uint8_t>(16 + ((col + row / 2 + index * 4) * 219 / (width + height)) % 220);
+        }
+    }
+    for (int row = 0; row < chroma_height; row++) {
+        for (int col = 0; col < chroma_width; col++) {
+            u[row * chroma_width + col] = static_cast<uint8_t>(96 + (col * 64) / chroma_width);
+            v[row * chroma_width + col] = static_cast<uint8_t>(96 + (row * 64) / chroma_height);
+        }
+    }
+
+    // Moving blocks
+    const int block = std::max(16, width / 10) & ~1;
+    const int span_x = std::max(1, width - block);
+    const int span_y = std::max(1, height - block);
+    const int positions[2][2] = {
+        {(index * 7) % span_x, (index * 3) % span_y},
+        {span_x - 1 - (index * 5) % span_x, (height / 3 + index * 2) % span_y},
+    };
+    for (int b = 0; b < 2; b++) {
+        const int bx = positions[b][0] & ~1;
+        const int by = positions[b][1] & ~1;
+        for (int row = by; row < std::min(height, by + block); row++) {
+            std::memset(y + row * width + bx, b == 0 ? 235 : 40, std::min(block, width - bx));
+        }
+        for (int row = by / 2; row < std::min(chroma_height, (by + block) / 2); row++) {
+            const int len = std::min(block / 2, chroma_width - bx / 2);
+            std::memset(u + row * chroma_width + bx / 2, b == 0 ? 200 : 60, len);
+            std::memset(v + row * chroma_width + bx / 2, b == 0 ? 60 : 200, len);
+        }
+    }
+
+    // Noise band across the bottom quarter
+    Lcg lcg(static_cast<uint32_t>(index) * 2654435761u + 1);
+    for (int row = height * 3 / 4; row < height; row++) {
+        uint8_t* line = y + row * width;
+        for (int col = 0; col < width; col++) {
+            int value = line[col] + static_cast<int>(lcg.Next() % 48) - 24;
+            line[col] = static_cast<uint8_t>(std::min(235, std::max(16, value)));
+        }
+    }
+
+    // Frame counter
+    const int scale = std::max(2, height / 90);
+    char digits[16];
+    std::snprintf(digits, sizeof(digits), "%06d", index);
+    for (int i = 0; digits[i] != '\0'; i++) {
+        const int x0 = scale * 2 + i * scale * 4;
+        if (x0 + scale * 3 > width || scale * 7 > height) {
+            break;
+        }
+        DrawDigit(y, width, x0, scale * 2, scale, digits[i] - '0', 235);
+    }
+}
+
+// Interleaved 16-bit stereo: a slow chirp on the left, a chord on the right,
+// both with a little noise so the encoder cannot coast
+std::vector<uint8_t> RenderAudioFrame(int sample_rate, int channels, int samples, int index) {
+    std::vector<uint8_t> pcm(static_cast<size_t>(samples) * channels * 2);
+    Lcg lcg(static_cast<uint32_t>(index) * 40503u + 7);
+    const double kPi = 3.14159265358979323846;
+    for (int i = 0; i < samples; i++) {
+        const double t = static_cast<double>(index * samples + i) / sample_rate;
+        const double chirp = std::sin(2.0 * kPi * (220.0 + 40.0 * t) * t);
+        const double chord = (std::sin(2.0 * kPi * 261.63 * t) +
+                              std::sin(2.0 * kPi * 329.63 * t) +
+                              std::sin(2.0 * kPi * 392.00 * t)) / 3.0;
+        for (int c = 0; c < channels; c++) {
+            const double noise = (static_cast<double>(lcg.Next() % 2001) - 1000.0) / 20000.0;
+            const double value = ((c == 0) ? chirp : chord) * 0.5 + noise;
+            const int16_t sample = static_cast<int16_t>(std::lrint(value * 32767.0));
+            const size_t offset = (static_cast<size_t>(i) * channels + c) * 2;
+            pcm[offset] = static_cast<uint8_t>(sample & 0xFF);
+            pcm[offset + 1] = static_cast<uint8_t>((sample >> 8) & 0xFF);
+        }
+    }
+    return pcm;
+}
+
+// Peak resident set size of the process in kilobytes (-1 if unavailable).
+// On Linux the high-water mark is reset before every run, so the value is
+// the peak of that run alone; elsewhere it is the peak since process start.
+int64_t PeakRssKb() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<int64_t>(counters.PeakWorkingSetSize / 1024);
+    }
+    return -1;
+#elif defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::atoll(line.c_str() + 6);
+        }
+    }
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#if defined(__APPLE__)
+    return static_cast<int64_t>(usage.ru_maxrss / 1024);
+#else
+    return static_cast<int64_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+void ResetPeakRss() {
+#if defined(__linux__)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (clear_refs) {
+        clear_refs << "5";
+    }
+#endif
+}
+
+int64_t ElapsedUs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+struct LatencySummary {
+    double mean_us = 0.0;
+    int64_t p50_us = 0;
+    int64_t p95_us = 0;
+    int64_t p99_us = 0;
+    int64_t max_us = 0;
+};
+
+LatencySummary Summarize(std::vector<int64_t> samples) {
+    LatencySummary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * samples.size()));
+        return samples[std::min(samples.size() - 1, rank > 0 ? rank - 1 : 0)];
+    };
+    int64_t total = 0;
+    for (int64_t sample : samples) {
+        total += sample;
+    }
+    summary.mean_us = static_cast<double>(total) / samples.size();
+    summary.p50_us = percentile(0.50);
+    summary.p95_us = percentile(0.95);
+    summary.p99_us = percentile(0.99);
+    summary.max_us = samples.back();
+    return summary;
+}
+
+// One direction (encode or decode) of a run
+struct PhaseResult {
+    bool ok = false;
+    int64_t frames = 0;
+    int64_t total_us = 0;
+    LatencySummary latency;
+};
+
+struct RunResult {
+    std::string codec;
+    std::string preset;
+    int threads = 0;
+    int width = 0;
+    int height = 0;
+    int64_t bytes = 0;
+    double bitrate_kbps = 0.0;
+    PhaseResult encode;
+    PhaseResult decode;
+    int64_t peak_rss_kb = -1;
+    std::string error;
+};
+
+struct Preset {
+    std::string name;
+    std::function<void(media::VideoEncoderConfig*, int threads)> apply;
+};
+
+struct CodecCase {
+    std::string name;
+    media::CodecType type;
+    std::vector<Preset> presets;
+};
+
+std::vector<CodecCase> VideoCodecCases() {
+    std::vector<CodecCase> cases;
+
+    CodecCase h264{"h264", media::CodecType::H264, {}};
+    for (const char* name : {"ultrafast", "veryfast", "medium"}) {
+        std::string preset = name;
+        h264.presets.push_back({preset, [preset](media::VideoEncoderConfig* config, int threads) {
+            media::codec::H264Params params;
+            params.preset = preset;
+            params.threads = threads;
+            config->SetH264Params(params);
+        }});
+    }
+    cases.push_back(h264);
+
+    CodecCase hevc{"hevc", media::CodecType::HEVC, {}};
+    for (const char* name : {"ultrafast", "veryfast", "medium"}) {
+        std::string preset = name;
+        hevc.presets.push_back({preset, [preset](media::VideoEncoderConfig* config, int threads) {
+            media::codec::HEVCParams params;
+            params.preset = preset;
+            params.threads = threads;
+            config->SetHEVCParams(params);
+        }});
+    }
+    cases.push_back(hevc);
+
+    // VP8 has no speed preset in VideoEncoderConfig; sweep the quality target
+    CodecCase vp8{"vp8", media::CodecType::VP8, {}};
+    for (int quality : {4, 10, 32}) {
+        vp8.presets.push_back({"quality-" + std::to_string(quality),
+                               [quality](media::VideoEncoderConfig* config, int threads) {
+            media::codec::VP8Params params;
+            params.quality = quality;
+            params.threads = threads;
+            config->SetVP8Params(params);
+        }});
+    }
+    cases.push_back(vp8);
+
+    CodecCase vp9{"vp9", media::CodecType::VP9, {}};
+    for (const char* name : {"realtime", "good"}) {
+        std::string speed = name;
+        vp9.presets.push_back({speed, [speed](media::VideoEncoderConfig* config, int threads) {
+            media::codec::VP9Params params;
+            params.speed = speed;
+            params.threads = threads;
+            config->SetVP9Params(params);
+        }});
+    }
+    cases.push_back(vp9);
+
+    CodecCase av1{"av1", media::CodecType::AV1, {}};
+    for (int speed : {10, 8, 6}) {
+        av1.presets.push_back({"speed-" + std::to_string(speed),
+                               [speed](media::VideoEncoderConfig* config, int threads) {
+            media::codec::AV1Params params;
+            params.speed = speed;
+            params.threads = threads;
+            config->SetAV1Params(params);
+        }});
+    }
+    cases.push_back(av1);
+
+    return cases;
+}
+
+RunResult RunVideo(const CodecCase& codec, const Preset& preset, int threads,
+                   const std::vector<std::vector<uint8_t>>& clip, int width, int height,
+                   int framerate) {
+    RunResult result;
+    result.codec = codec.name;
+    result.preset = preset.name;
+    result.threads = threads;
+    result.width = width;
+    result.height = height;
+
+    ResetPeakRss();
+
+    media::VideoEncoderConfig config;
+    config.output_codec = codec.type;
+    config.width = width;
+    config.height = height;
+    config.framerate = framerate;
+    config.bitrate = std::max(250000, width * height * 3);
+    preset.apply(&config, threads);
+
+    auto encoder = media::VideoEncoder::Create(config);
+    if (!encoder) {
+        result.error = "encoder creation failed";
+        return result;
+    }
+
+    // Encode, keeping every access unit for the decode pass
+    std::vector<std::vector<uint8_t>> access_units;
+    std::vector<int64_t> latencies;
+    latencies.reserve(clip.size());
+    std::vector<media::EncodedPacket> packets;
+    auto keep = [&](const std::vector<media::EncodedPacket>& out) {
+        for (const auto& packet : out) {
+            access_units.emplace_back(packet.data(), packet.data() + packet.size());
+            result.bytes += static_cast<int64_t>(packet.size());
+        }
+    };
+
+    auto encode_start = Clock::now();
+    for (size_t i = 0; i < clip.size(); i++) {
+        media::VideoFrameView view = media::VideoFrameView::FromYUV420(clip[i].data(), width, height);
+        auto frame_start = Clock::now();
+        bool ok = encoder->EncodeYUV420(view, &packets);
+        latencies.push_back(ElapsedUs(frame_start));
+        if (!ok) {
+            result.error = "encode failed at frame " + std::to_string(i);
+            return result;
+        }
+        keep(packets);
+    }
+    if (!encoder->Flush(&packets)) {
+        result.error = "encoder flush failed";
+        return result;
+    }
+    keep(packets);
+    result.encode.total_us = ElapsedUs(encode_start);
+    result.encode.frames = static_cast<int64_t>(clip.size());
+    result.encode.latency = Summarize(latencies);
+    result.encode.ok = true;
+    encoder.reset();
+
+    const double seconds = static_cast<double>(clip.size()) / framerate;
+    result.bitrate_kbps = seconds > 0 ? result.bytes * 8.0 / seconds / 1000.0 : 0.0;
+
+    // Decode the stream just produced
+    media::VideoDecoderConfig decoder_config;
+    decoder_config.input_codec = codec.type;
+    decoder_config.width = width;
+    decoder_config.height = height;
+    decoder_config.threads = threads;
+
+    auto decoder = media::VideoDecoder::Create(decoder_config);
+    if (!decoder) {
+        result.error = "decoder creation failed";
+        result.peak_rss_kb = PeakRssKb();
+        return result;
+    }
+
+    latencies.clear();
+    std::vector<media::DecodedFrame> frames;
+    auto decode_start = Clock::now();
+    for (const auto& access_unit : access_units) {
+        auto packet_start = Clock::now();
+        frames.clear();
+        int status = decoder->DecodeFrames(access_unit, &frames);
+        latencies.push_back(ElapsedUs(packet_start));
+        if (status < 0) {
+            result.error = "decode failed";
+            break;
+        }
+        result.decode.frames += status;
+    }
+    // Frames held for reordering and by frame threads count too
+    if (result.error.empty()) {
+        frames.clear();
+        result.decode.frames += decoder->Flush(&frames);
+    }
+    result.decode.total_us = ElapsedUs(decode_start);
+    result.decode.latency = Summarize(latencies);
+    result.decode.ok = result.error.empty();
+    result.peak_rss_kb = PeakRssKb();
+    return result;
+}
+
+// Opus has no thread setting; its presets are encoder complexity levels
+std::vector<RunResult> RunOpus(int audio_seconds) {
+    std::vector<RunResult> results;
+    const int sample_rate = 48000;
+    const int channels = 2;
+    const int frame_ms = 20;
+    const int samples = sample_rate * frame_ms / 1000;
+    const int frame_count = audio_seconds * 1000 / frame_ms;
+
+    std::vector<std::vector<uint8_t>> pcm_frames;
+    for (int i = 0; i < frame_count; i++) {
+        pcm_frames.push_back(RenderAudioFrame(sample_rate, channels, samples, i));
+    }
+
+    for (int complexity : {0, 5, 10}) {
+        RunResult result;
+        result.codec = "opus";
+        result.preset = "complexity-" + std::to_string(complexity);
+        result.threads = 1;
+
+        ResetPeakRss();
+
+        media::OPUSEncoderConfig encoder_config;
+        encoder_config.sample_rate = sample_rate;
+        encoder_config.channels = channels;
+        encoder_config.frame_duration_ms = frame_ms;
+        encoder_config.complexity = complexity;
+        auto encoder = media::OPUSEncoder::Create(encoder_config);
+
+        media::OPUSDecoderConfig decoder_config;
+        decoder_config.sample_rate = sample_rate;
+        decoder_config.channels = channels;
+        auto decoder = media::OPUSDecoder::Create(decoder_config);
+
+        if (!encoder || !decoder) {
+            result.error = "opus codec creation failed";
+            results.push_back(result);
+            continue;
+        }
+
+        std::vector<std::vector<uint8_t>> opus_frames;
+        std::vector<int64_t> latencies;
+        auto encode_start = Clock::now();
+        for (const auto& pcm : pcm_frames) {
+            std::vector<uint8_t> opus_frame;
+            auto frame_start = Clock::now();
+            int ok = encoder->EncodePCM_S16LE(pcm, &opus_frame);
+            latencies.push_back(ElapsedUs(frame_start));
+            if (ok <= 0) {
+                result.error = "opus encode failed: " + encoder->GetLastError();
+                break;
+            }
+            result.bytes += static_cast<int64_t>(opus_frame.size());
+            opus_frames.push_back(std::move(opus_frame));
+        }
+        result.encode.total_us = ElapsedUs(encode_start);
+        result.encode.frames = static_cast<int64_t>(opus_frames.size());
+        result.encode.latency = Summarize(latencies);
+        result.encode.ok = result.error.empty();
+        result.bitrate_kbps = result.bytes * 8.0 / audio_seconds / 1000.0;
+
+        latencies.clear();
+        std::vector<uint8_t> pcm;
+        auto decode_start = Clock::now();
+        for (const auto& opus_frame : opus_frames) {
+            auto frame_start = Clock::now();
+            int ok = decoder->DecodeToPCM_S16LE(opus_frame, &pcm);
+            latencies.push_back(ElapsedUs(frame_start));
+            if (ok <= 0) {
+                result.error = std::string("opus decode failed: ") + decoder->GetLastError();
+                break;
+            }
+            result.decode.frames++;
+        }
+        result.decode.total_us = ElapsedUs(decode_start);
+        result.decode.latency = Summarize(latencies);
+        result.decode.ok = result.error.empty();
+        result.peak_rss_kb = PeakRssKb();
+        results.push_back(result);
+    }
+    return results;
+}
+
+std::string JsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out += buffer;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+void WritePhase(std::ostream& out, const char* name, const PhaseResult& phase) {
+    const double fps = phase.total_us > 0 ? phase.frames * 1e6 / phase.total_us : 0.0;
+    out << "      \"" << name << "\": {"
+        << "\"ok\": " << (phase.ok ? "true" : "false")
+        << ", \"frames\": " << phase.frames
+        << ", \"total_us\": " << phase.total_us
+        << ", \"fps\": " << fps
+        << ", \"latency_us\": {"
+        << "\"mean\": " << phase.latency.mean_us
+        << ", \"p50\": " << phase.latency.p50_us
+        << ", \"p95\": " << phase.latency.p95_us
+        << ", \"p99\": " << phase.latency.p99_us
+        << ", \"max\": " << phase.latency.max_us
+        << "}}";
+}
+
+void WriteJson(std::ostream& out, const std::vector<RunResult>& results,
+               int width, int height, int frames, int framerate, int64_t baseline_rss_kb) {
+    out << "{\n";
+    out << "  \"width\": " << width << ",\n";
+    out << "  \"height\": " << height << ",\n";
+    out << "  \"frames\": " << frames << ",\n";
+    out << "  \"framerate\": " << framerate << ",\n";
+    out << "  \"baseline_rss_kb\": " << baseline_rss_kb << ",\n";
+    out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const RunResult& r = results[i];
+        out << "    {\n";
+        out << "      \"codec\": \"" << JsonEscape(r.codec) << "\",\n";
+        out << "      \"preset\": \"" << JsonEscape(r.preset) << "\",\n";
+        out << "      \"threads\": " << r.threads << ",\n";
+        out << "      \"width\": " << r.width << ",\n";
+        out << "      \"height\": " << r.height << ",\n";
+        out << "      \"bytes\": " << r.bytes << ",\n";
+        out << "      \"bitrate_kbps\": " << r.bitrate_kbps << ",\n";
+        WritePhase(out, "encode", r.encode);
+        out << ",\n";
+        WritePhase(out, "decode", r.decode);
+        out << ",\n";
+        out << "      \"peak_rss_kb\": " << r.peak_rss_kb << ",\n";
+        out << "      \"error\": " << (r.error.empty() ? "null" : "\"" + JsonEscape(r.error) + "\"") << "\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+std::vector<std::string> SplitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+void PrintUsage() {
+    std::cerr << "Usage: mediacodec_bench [--width W] [--height H] [--frames N] [--framerate F]\n"
+              << "                        [--codecs h264,hevc,vp8,vp9,av1,opus]\n"
+              << "                        [--threads 1,2,4] [--output results.json]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int width = 1280;
+    int height = 720;
+    int frames = 120;
+    int framerate = 30;
+    std::vector<std::string> codecs = {"h264", "hevc", "vp8", "vp9", "av1", "opus"};
+    std::vector<int> thread_counts;
+    std::string output_path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            PrintUsage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--width") {
+            width = std::atoi(value.c_str());
+        } else if (arg == "--height") {
+            height = std::atoi(value.c_str());
+        } else if (arg == "--frames") {
+            frames = std::atoi(value.c_str());
+        } else if (arg == "--framerate") {
+            framerate = std::atoi(value.c_str());
+        } else if (arg == "--codecs") {
+            codecs = SplitList(value);
+        } else if (arg == "--threads") {
+            for (const auto& item : SplitList(value)) {
+                thread_counts.push_back(std::atoi(item.c_str()));
+            }
+        } else if (arg == "--output") {
+            output_path = value;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (width <= 0 || height <= 0 || (width % 2) || (height % 2) || frames <= 0 || framerate <= 0) {
+        std::cerr << "Width and height must be positive and even; frames and framerate positive" << std::endl;
+        return 1;
+    }
+
+    if (thread_counts.empty()) {
+        thread_counts = {1, 2, 4};
+        int hardware = static_cast<int>(std::thread::hardware_concurrency());
+        if (hardware > 4) {
+            thread_counts.push_back(hardware);
+        }
+    }
+
+    auto wants = [&codecs](const std::string& name) {
+        return std::find(codecs.begin(), codecs.end(), name) != codecs.end();
+    };
+
+    // Render the clip once; every run reads the same frames
+    std::vector<std::vector<uint8_t>> clip(frames, std::vector<uint8_t>(width * height * 3 / 2));
+    for (int i = 0; i < frames; i++) {
+        RenderFrame(&clip[i], width, height, i);
+    }
+
+    // Memory held before any codec is created, mostly the clip itself
+    ResetPeakRss();
+    const int64_t baseline_rss_kb = PeakRssKb();
+
+    std::vector<RunResult> results;
+    for (const auto& codec : VideoCodecCases()) {
+        if (!wants(codec.name)) {
+            continue;
+        }
+        for (const auto& preset : codec.presets) {
+            for (int threads : thread_counts) {
+                std::cerr << codec.name << " " << preset.name << " threads=" << threads << " ..." << std::endl;
+                results.push_back(RunVideo(codec, preset, threads, clip, width, height, framerate));
+                if (!results.back().error.empty()) {
+                    std::cerr << "  " << results.back().error << std::endl;
+                }
+            }
+        }
+    }
+
+    if (wants("opus")) {
+        std::cerr << "opus ..." << std::endl;
+        int audio_seconds = std::max(1, frames / framerate);
+        for (auto& result : RunOpus(audio_seconds)) {
+            results.push_back(std::move(result));
+        }
+    }
+
+    if (output_path.empty()) {
+        WriteJson(std::cout, results, width, height, frames, framerate, baseline_rss_kb);
+    } else {
+        std::ofstream file(output_path);
+        if (!file) {
+            std::cerr << "Failed to open " << output_path << std::endl;
+            return 1;
+        }
+        WriteJson(file, results, width, height, frames, framerate, baseline_rss_kb);
+        std::cerr << "Results written to " << output_path << std::endl;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "media_encoder_farm.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Fills a YUV420 frame with a moving gradient so the encoder has real work
+static void FillSyntheticFrame(std::vector<uint8_t>* frame, int width, int height, int index) {
+    uint8_t* y = frame->data();
+    uint8_t* u = y + width * height;
+    uint8_t* v = u + (width / 2) * (height / 2);
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            y[row * width + col] = static_cast<uint8_t>(col + row + index * 3);
+        }
+    }
+    for (int row = 0; row < height / 2; row++) {
+        for (int col = 0; col < width / 2; col++) {
+            u[row * (width / 2) + col] = static_cast<uint8_t>(128 + col - index);
+            v[row * (width / 2) + col] = static_cast<uint8_t>(128 + row + index);
+        }
+    }
+}
+
+int main() {
+    const int width = 640;
+    const int height = 360;
+    const int frames_per_session = 60;
+    const int session_counts[] = {1, 2, 4, 8, 16, 32, 64};
+
+    // Configure one low-latency H264 session
+    media::VideoEncoderConfig config;
+    config.output_codec = media::CodecType::H264;
+    config.width = width;
+    config.height = height;
+    config.framerate = 30;
+    config.bitrate = 1000000;
+
+    media::codec::H264Params h264_params;
+    h264_params.preset = "ultrafast";
+    h264_params.profile = "baseline";
+    h264_params.max_b_frames = 0;
+    config.SetH264Params(h264_params);
+
+    // Pre-render a few frames shared by every session
+    std::vector<std::vector<uint8_t>> source_frames(8, std::vector<uint8_t>(width * height * 3 / 2));
+    for (size_t i = 0; i < source_frames.size(); i++) {
+        FillSyntheticFrame(&source_frames[i], width, height, static_cast<int>(i));
+    }
+
+    for (int sessions : session_counts) {
+        media::EncoderFarmConfig farm_config;
+        farm_config.threads_per_session = 1;
+        farm_config.session_queue_depth = 4;
+        auto farm = media::EncoderFarm::Create(farm_config);
+
+        std::atomic<uint64_t> total_bytes{0};
+        std::vector<int> ids;
+        for (int i = 0; i < sessions; i++) {
+            int id = farm->AddSession(config,
+                [&total_bytes](int, const std::vector<media::EncodedPacket>& packets) {
+                    for (const auto& packet : packets) {
+                        total_bytes += packet.size();
+                    }
+                });
+            if (id < 0) {
+                std::cerr << "Failed to create session " << i << std::endl;
+                return -1;
+            }
+            ids.push_back(id);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        // Interleave submissions so every session is busy at the same time
+        for (int frame = 0; frame < frames_per_session; frame++) {
+            const std::vector<uint8_t>& source = source_frames[frame % source_frames.size()];
+            for (int id : ids) {
+                media::VideoFrameView view = media::VideoFrameView::FromYUV420(source.data(), width, height);
+                view.pts = frame;
+                farm->SubmitFrame(id, view, nullptr);
+            }
+        }
+        for (int id : ids) {
+            farm->Flush(id);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double aggregate_fps = sessions * frames_per_session / seconds;
+
+        std::cout << "sessions: " << sessions
+                  << " workers: " << farm->GetWorkerCount()
+                  << " aggregate fps: " << aggregate_fps
+                  << " per-session fps: " << aggregate_fps / sessions
+                  << " bytes: " << total_bytes.load() << std::endl;
+
+        for (int id : ids) {
+            farm->RemoveSession(id);
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
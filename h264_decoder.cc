@@ -8,6 +8,10 @@ extern "C" {
 
 #include <algorithm>
 #include <cstring>
+#include <deque>
+
+#include "media_keyframe.h"
+#include "media_stream_parser.h"
 
 namespace media {
 
@@ -24,7 +28,8 @@ class H264DecoderInstance : public H264Decoder {
         packet_(nullptr),
         initialized_(false),
         frame_width_(0),
-        frame_height_(0) {}
+        frame_height_(0),
+        stream_parser_(CodecType::H264) {}
 
   ~H264DecoderInstance() override {
     if (frame_) {
@@ -97,6 +102,7 @@ class H264DecoderInstance : public H264Decoder {
   }
 
   void Reset() override {
+    stream_parser_.Reset();
     if (codec_context_) {
       avcodec_flush_buffers(codec_context_);
       
@@ -106,35 +112,127 @@ class H264DecoderInstance : public H264Decoder {
         DecodeToYUV420(dummy, nullptr);
       }
     }
+    pending_.clear();
   }
 
   int DecodeToYUV420(std::vector<uint8_t>& yuv_frame, 
                      const std::vector<uint8_t>* h264_frame) override {
-    if (!initialized_) {
+    DecodedFrame frame;
+    int ret = Decode(&frame, h264_frame);
+    if (ret <= 0) {
+      return ret;
+    }
+
+    // Pack the planes into the caller buffer in the requested layout,
+    // honoring each plane's stride
+    if (!frame.CopyTo(&yuv_frame, config_.pixel_format)) {
+      return -1;
+    }
+
+    return 1; // Success
+  }
+
+  int Decode(DecodedFrame* frame, const std::vector<uint8_t>* h264_frame) override {
+    if (!initialized_ || !frame) {
       return -1;
     }
 
     int ret = 0;
     
-    // Set up the packet with input data
-    if (h264_frame && !h264_frame->empty()) {
-      packet_->data = const_cast<uint8_t*>(h264_frame->data());
-      packet_->size = static_cast<int>(h264_frame->size());
-    } else {
-      // Flush mode - send null packet to get any remaining frames
-      packet_->data = nullptr;
-      packet_->size = 0;
+    // Non-key packets would be discarded by the decoder; skip the send
+    if (config_.keyframes_only && h264_frame && !h264_frame->empty() &&
+        !IsKeyframePacket(CodecType::H264, h264_frame->data(), h264_frame->size())) {
+      return 0;
     }
 
+    // End of stream: queue what the decoder still holds
+    if (!h264_frame || h264_frame->empty()) {
+      Drain();
+      return NextFrame(frame);
+    }
+
+    // Set up the packet with input data
+    packet_->data = const_cast<uint8_t*>(h264_frame->data());
+    packet_->size = static_cast<int>(h264_frame->size());
+
     // Send packet to decoder
-    ret = avcodec_send_packet(codec_context_, packet_);
+    ret = SendPacket(packet_);
     if (ret < 0) {
       // Error handling
       return ret;
     }
 
+    return NextFrame(frame);
+  }
+
+  int DecodeStream(const uint8_t* data, size_t size,
+                   std::vector<DecodedFrame>* frames) override {
+    if (!initialized_ || !frames) {
+      return -1;
+    }
+
+    int count = 0;
+    stream_parser_.Feed(data, size);
+    while (stream_parser_.Next(codec_context_, packet_)) {
+      if (config_.keyframes_only &&
+          !IsKeyframePacket(CodecType::H264, packet_->data, packet_->size)) {
+        continue;
+      }
+      if (SendPacket(packet_) < 0) {
+        // A damaged access unit should not end the stream; skip it
+        continue;
+      }
+      count += ReceiveFrames(frames);
+    }
+
+    // End of stream: drain the pictures held for reordering
+    if (!data || size == 0) {
+      count += Flush(frames);
+    }
+
+    return count;
+  }
+
+  int ReceiveFrames(std::vector<DecodedFrame>* frames) override {
+    if (!initialized_ || !frames) {
+      return 0;
+    }
+
+    int count = 0;
+    DecodedFrame frame;
+    while (NextFrame(&frame) > 0) {
+      frames->push_back(frame);
+      count++;
+    }
+    return count;
+  }
+
+  int Flush(std::vector<DecodedFrame>* frames) override {
+    if (!initialized_ || !frames) {
+      return 0;
+    }
+
+    Drain();
+    return ReceiveFrames(frames);
+  }
+
+  int GetDelay() const override {
+    return initialized_ ? DecoderDelay(codec_context_) : 0;
+  }
+
+  void GetFrameDimensions(int* width, int* height) const override {
+    if (width) {
+      *width = frame_width_;
+    }
+    if (height) {
+      *height = frame_height_;
+    }
+  }
+
+ private:
+  int ReceiveFrame(DecodedFrame* frame) {
     // Receive decoded frame
-    ret = avcodec_receive_frame(codec_context_, frame_);
+    int ret = avcodec_receive_frame(codec_context_, frame_);
     if (ret < 0) {
       if (ret == AVERROR(EAGAIN)) {
         // Need more data
@@ -152,45 +250,48 @@ class H264DecoderInstance : public H264Decoder {
     frame_width_ = frame_->width;
     frame_height_ = frame_->height;
 
-    // Calculate required buffer size for YUV420 format
-    int yuv_size = frame_->width * frame_->height * 3 / 2; // Y + U + V
-    yuv_frame.resize(yuv_size);
-
-    // Copy Y plane
-    int y_size = frame_->width * frame_->height;
-    std::memcpy(yuv_frame.data(), frame_->data[0], y_size);
-    
-    // Copy U plane
-    int uv_stride = frame_->width / 2;
-    int uv_height = frame_->height / 2;
-    int u_size = uv_stride * uv_height;
-    
-    for (int i = 0; i < uv_height; i++) {
-      std::memcpy(yuv_frame.data() + y_size + i * uv_stride,
-                 frame_->data[1] + i * frame_->linesize[1],
-                 uv_stride);
-    }
-    
-    // Copy V plane
-    for (int i = 0; i < uv_height; i++) {
-      std::memcpy(yuv_frame.data() + y_size + u_size + i * uv_stride,
-                 frame_->data[2] + i * frame_->linesize[2],
-                 uv_stride);
-    }
+    // Hand the decoder's buffers to the caller without copying them
+    *frame = DecodedFrame::TakeFrom(frame_);
 
     return 1; // Success
   }
 
-  void GetFrameDimensions(int* width, int* height) const override {
-    if (width) {
-      *width = frame_width_;
+  // Hands out the oldest picture, queued ones first; 1 if there was one
+  int NextFrame(DecodedFrame* frame) {
+    if (pending_.empty()) {
+      return ReceiveFrame(frame);
+    }
+    *frame = pending_.front();
+    pending_.pop_front();
+    return 1;
+  }
+
+  // Sends a packet (nullptr to drain). On EAGAIN the ready pictures move to
+  // pending_ and the packet is sent again instead of being lost.
+  int SendPacket(const AVPacket* packet) {
+    int ret = avcodec_send_packet(codec_context_, packet);
+    if (ret == AVERROR(EAGAIN)) {
+      DecodedFrame frame;
+      while (ReceiveFrame(&frame) > 0) {
+        pending_.push_back(frame);
+      }
+      ret = avcodec_send_packet(codec_context_, packet);
     }
-    if (height) {
-      *height = frame_height_;
+    return ret;
+  }
+
+  // Sends the end of stream, queues every picture left and resets the
+  // decoder for the next stream
+  void Drain() {
+    if (SendPacket(nullptr) >= 0) {
+      DecodedFrame frame;
+      while (ReceiveFrame(&frame) > 0) {
+        pending_.push_back(frame);
+      }
     }
+    avcodec_flush_buffers(codec_context_);
   }
 
- private:
   void ApplyDecoderOptions() {
     if (config_.thread_count > 0) {
       codec_context_->thread_count = config_.thread_count;
@@ -208,6 +309,10 @@ class H264DecoderInstance : public H264Decoder {
       codec_context_->skip_frame = AVDISCARD_NONREF;
     }
     
+    if (config_.keyframes_only) {
+      codec_context_->skip_frame = AVDISCARD_NONKEY;
+    }
+    
     if (config_.error_concealment) {
       codec_context_->error_concealment = FF_EC_GUESS_MVS | FF_EC_DEBLOCK;
     }
@@ -249,10 +354,6 @@ class H264DecoderInstance : public H264Decoder {
       codec_context_->max_b_frames = config_.max_b_frames;
     }
     
-    if (config_.pixel_format >= 0) {
-      codec_context_->pix_fmt = static_cast<AVPixelFormat>(config_.pixel_format);
-    }
-    
     if (config_.refs > 0) {
       codec_context_->refs = config_.refs;
     }
@@ -286,6 +387,10 @@ class H264DecoderInstance : public H264Decoder {
   bool initialized_;
   int frame_width_;
   int frame_height_;
+  StreamParser stream_parser_;
+
+  // Pictures taken out of the decoder ahead of the caller, oldest first
+  std::deque<DecodedFrame> pending_;
 };
 
 }  // namespace
@@ -1,11 +1,14 @@
 #ifndef H264_DECODER_H_
 #define H264_DECODER_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <vector>
 #include <mutex>
 
+#include "media_decoded_frame.h"
+
 namespace media {
 
 // Configuration options for the H264 decoder
@@ -25,6 +28,10 @@ struct H264DecoderConfig {
   
   // Skip frame (bidir predicted frames)
   bool skip_frame = false;
+
+  // Decode keyframes only: packets without an IDR, I slice or recovery
+  // point are dropped before decoding and the rest use AVDISCARD_NONKEY
+  bool keyframes_only = false;
   
   // Error concealment flags
   bool error_concealment = false;
@@ -57,7 +64,8 @@ struct H264DecoderConfig {
   // Custom extradata buffer (SPS/PPS)
   std::vector<uint8_t> extradata;
   
-  // Request a specific pixel format (FFmpeg format constants)
+  // Pixel format written by DecodeToYUV420 (FFmpeg format constants):
+  // AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, or -1 for the decoder's own
   int pixel_format = -1;
   
   // Decoder delay (in frames)
@@ -93,10 +101,40 @@ class H264Decoder {
   // Virtual destructor to allow proper cleanup in derived classes
   virtual ~H264Decoder() = default;
   
-  // Decode a H264 frame to YUV420 format
+  // Decode a H264 frame to YUV420 format, laid out as config.pixel_format
   // Returns 1 on success, 0 if more data is needed, negative value on error
   virtual int DecodeToYUV420(std::vector<uint8_t>& yuv_frame, const std::vector<uint8_t>* h264_frame) = 0;
   
+  // Decode a H264 frame without copying the picture. |frame| references the
+  // decoder's buffers and stays valid across later calls.
+  // An empty packet ends the stream; each such call then hands out one of
+  // the remaining pictures until 0 is returned.
+  // Returns 1 on success, 0 if more data is needed, negative value on error
+  virtual int Decode(DecodedFrame* frame, const std::vector<uint8_t>* h264_frame) = 0;
+  
+  // Streaming input: |data| is any slice of an Annex B stream, such as one
+  // socket read. Access units are split off with av_parser_parse2 without
+  // copying the chunk, and every frame they complete is appended to
+  // |frames|. An empty chunk ends the stream and drains the decoder.
+  // Returns the number of frames appended, negative value on error
+  virtual int DecodeStream(const uint8_t* data, size_t size,
+                           std::vector<DecodedFrame>* frames) = 0;
+  
+  // Decode() returns at most one frame per packet. With frame threading a
+  // packet can release several, so call this after each Decode() to
+  // collect the rest; they are appended to |frames| in output order.
+  // Returns the number of frames appended
+  virtual int ReceiveFrames(std::vector<DecodedFrame>* frames) = 0;
+  
+  // Ends the stream: appends every picture still buffered to |frames| and
+  // leaves the decoder ready for a new stream.
+  // Returns the number of frames appended
+  virtual int Flush(std::vector<DecodedFrame>* frames) = 0;
+  
+  // Frames the decoder holds back before output (reorder buffer plus frame
+  // threads), i.e. how far output lags input
+  virtual int GetDelay() const = 0;
+  
   // Reset the decoder state
   virtual void Reset() = 0;
   
@@ -44,6 +44,12 @@ public:
         codec_ctx_->gop_size = config_.gop_size;
         codec_ctx_->max_b_frames = config_.max_b_frames;
         codec_ctx_->pix_fmt = AV_PIX_FMT_YUV420P;
+        if (config_.colorspace >= 0) {
+            codec_ctx_->colorspace = static_cast<AVColorSpace>(config_.colorspace);
+        }
+        if (config_.color_range >= 0) {
+            codec_ctx_->color_range = static_cast<AVColorRange>(config_.color_range);
+        }
         codec_ctx_->refs = config_.refs;
         codec_ctx_->thread_count = config_.threads;
         codec_ctx_->slices = config_.slices;
@@ -64,9 +70,11 @@ public:
             av_opt_set(codec_ctx_->priv_data, "tune", config_.tune.c_str(), 0);
         }
         
-        // Rate control
+        // Rate control. Constant bitrate runs x264 in ABR mode with VBV capped
+        // at the target, the only mode whose bitrate can change while running.
         if (config_.constant_bitrate) {
-            av_opt_set(codec_ctx_->priv_data, "crf", "0", 0);
+            codec_ctx_->rc_max_rate = config_.bitrate;
+            codec_ctx_->rc_buffer_size = config_.bitrate;
             av_opt_set(codec_ctx_->priv_data, "tune", "zerolatency", 0);
         } else if (config_.qp >= 0) {
             char qp_str[8];
@@ -179,7 +187,7 @@ public:
         
         char scenecut_str[8];
         snprintf(scenecut_str, sizeof(scenecut_str), "%d", config_.scenecut_threshold);
-        av_opt_set(codec_ctx_->priv_data, "scenecut", scenecut_str, 0);
+        av_opt_set(codec_ctx_->priv_data, "sc_threshold", scenecut_str, 0);
         
         // Metadata
         av_opt_set(codec_ctx_->priv_data, "repeat-headers", config_.repeat_headers ? "1" : "0", 0);
@@ -217,6 +225,14 @@ public:
             return false;
         }
         
+        // Allocate the frame used to reference caller-owned planes
+        input_frame_ = av_frame_alloc();
+        if (!input_frame_) {
+            std::cerr << "Error: Could not allocate input frame" << std::endl;
+            Cleanup();
+            return false;
+        }
+        
         // Allocate packet
         packet_ = av_packet_alloc();
         if (!packet_) {
@@ -226,7 +242,7 @@ public:
         }
         
         initialized_ = true;
-        frame_count_ = 0;
+        clock_ = FrameClock(config_.framerate);
         
         return true;
     }
@@ -242,6 +258,11 @@ public:
             frame_ = nullptr;
         }
         
+        if (input_frame_) {
+            av_frame_free(&input_frame_);
+            input_frame_ = nullptr;
+        }
+        
         if (codec_ctx_) {
             avcodec_free_context(&codec_ctx_);
             codec_ctx_ = nullptr;
@@ -271,43 +292,81 @@ public:
             return false;
         }
         
-        // Make sure the frame is writable
-        int ret = av_frame_make_writable(frame_);
-        if (ret < 0) {
-            char errbuf[AV_ERROR_MAX_STRING_SIZE];
-            av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
-            std::cerr << "Error: Could not make frame writable: " << errbuf << std::endl;
+        return EncodeYUV420(
+            VideoFrameView::FromYUV420(yuv_data.data(), config_.width, config_.height),
+            output_frame);
+    }
+    
+    bool EncodeYUV420(const VideoFrameView& frame,
+                     std::vector<uint8_t>* output_frame) override {
+        if (!output_frame) {
+            std::cerr << "Error: Output buffer is null" << std::endl;
+            return false;
+        }
+        
+        std::vector<EncodedPacket> packets;
+        if (!EncodeYUV420(frame, &packets)) {
             return false;
         }
         
-        // Copy YUV data to frame
-        // Y plane
-        const uint8_t* y_src = yuv_data.data();
-        int y_stride = config_.width;
-        memcpy(frame_->data[0], y_src, y_stride * config_.height);
+        output_frame->clear();
+        AppendPackets(packets, output_frame);
+        return true;
+    }
+    
+    bool EncodeYUV420(const VideoFrameView& frame,
+                     std::vector<EncodedPacket>* packets) override {
+        if (!initialized_ && !Initialize()) {
+            return false;
+        }
         
-        // U plane
-        const uint8_t* u_src = y_src + (y_stride * config_.height);
-        int u_stride = config_.width / 2;
-        memcpy(frame_->data[1], u_src, u_stride * (config_.height / 2));
+        if (!packets) {
+            std::cerr << "Error: Output packet list is null" << std::endl;
+            return false;
+        }
         
-        // V plane
-        const uint8_t* v_src = u_src + (u_stride * (config_.height / 2));
-        int v_stride = config_.width / 2;
-        memcpy(frame_->data[2], v_src, v_stride * (config_.height / 2));
+        // Reference the caller planes directly or copy them into frame_
+        AVFrame* input = PrepareEncoderFrame(frame, frame_, input_frame_);
+        if (!input) {
+            return false;
+        }
         
         // Set presentation timestamp
-        frame_->pts = frame_count_++;
+        int64_t pts = clock_.Next();
+        input->pts = frame.pts >= 0 ? frame.pts : pts;
         
-        return EncodeFrame(frame_, output_frame);
+        bool result = EncodeFrame(input, packets);
+        av_frame_unref(input_frame_);
+        return result;
     }
     
     bool Flush(std::vector<uint8_t>* output_frame) override {
+        if (!output_frame) {
+            std::cerr << "Error: Output buffer is null" << std::endl;
+            return false;
+        }
+        
+        std::vector<EncodedPacket> packets;
+        if (!Flush(&packets)) {
+            return false;
+        }
+        
+        output_frame->clear();
+        AppendPackets(packets, output_frame);
+        return true;
+    }
+    
+    bool Flush(std::vector<EncodedPacket>* packets) override {
         if (!initialized_) {
             return false;
         }
         
-        return EncodeFrame(nullptr, output_frame);
+        if (!packets) {
+            std::cerr << "Error: Output packet list is null" << std::endl;
+            return false;
+        }
+        
+        return EncodeFrame(nullptr, packets);
     }
     
     bool Reconfigure(const H264EncoderConfig& config) override {
@@ -318,12 +377,65 @@ public:
         return Initialize();
     }
     
+    bool UpdateRateControl(int bitrate, int vbv_maxrate,
+                           int vbv_bufsize, int framerate) override {
+        if (!initialized_) {
+            std::cerr << "Error: Encoder not initialized" << std::endl;
+            return false;
+        }
+        
+        // libx264 only retargets the bitrate in ABR mode, and cannot turn VBV
+        // on after it was opened without it
+        if (bitrate > 0 && !config_.constant_bitrate) {
+            std::cerr << "Error: Bitrate cannot change in CRF or QP mode" << std::endl;
+            return false;
+        }
+        
+        if ((vbv_maxrate > 0 || vbv_bufsize > 0) &&
+            (codec_ctx_->rc_max_rate <= 0 || codec_ctx_->rc_buffer_size <= 0)) {
+            std::cerr << "Error: VBV was not enabled when the encoder was opened" << std::endl;
+            return false;
+        }
+        
+        if (framerate > 0 && !clock_.SetFramerate(framerate)) {
+            std::cerr << "Error: Frame rate " << framerate
+                      << " exceeds the rate the encoder was opened with" << std::endl;
+            return false;
+        }
+        
+        // libx264 compares these against its running parameters on every
+        // frame and applies changes through x264_encoder_reconfig()
+        if (bitrate > 0) {
+            codec_ctx_->bit_rate = bitrate;
+            config_.bitrate = bitrate;
+            // A VBV cap that was derived from the bitrate follows it
+            if (config_.vbv_maxrate <= 0 && vbv_maxrate <= 0) {
+                codec_ctx_->rc_max_rate = bitrate;
+            }
+            if (config_.vbv_bufsize <= 0 && vbv_bufsize <= 0) {
+                codec_ctx_->rc_buffer_size = bitrate;
+            }
+        }
+        
+        if (vbv_maxrate > 0) {
+            codec_ctx_->rc_max_rate = vbv_maxrate;
+            config_.vbv_maxrate = vbv_maxrate;
+        }
+        
+        if (vbv_bufsize > 0) {
+            codec_ctx_->rc_buffer_size = vbv_bufsize;
+            config_.vbv_bufsize = vbv_bufsize;
+        }
+        
+        return true;
+    }
+    
     H264EncoderConfig GetConfig() const override {
         return config_;
     }
     
 private:
-    bool EncodeFrame(AVFrame* frame, std::vector<uint8_t>* output_frame) {
+    bool EncodeFrame(AVFrame* frame, std::vector<EncodedPacket>* packets) {
         int ret = avcodec_send_frame(codec_ctx_, frame);
         if (ret < 0) {
             char errbuf[AV_ERROR_MAX_STRING_SIZE];
@@ -332,7 +444,7 @@ private:
             return false;
         }
         
-        output_frame->clear();
+        packets->clear();
         
         while (ret >= 0) {
             ret = avcodec_receive_packet(codec_ctx_, packet_);
@@ -346,12 +458,8 @@ private:
                 return false;
             }
             
-            // Append packet data to output
-            size_t current_size = output_frame->size();
-            output_frame->resize(current_size + packet_->size);
-            memcpy(output_frame->data() + current_size, packet_->data, packet_->size);
-            
-            av_packet_unref(packet_);
+            // Hand the packet buffer to the caller without copying it
+            packets->push_back(EncodedPacket::TakeFrom(packet_));
         }
         
         return true;
@@ -359,11 +467,12 @@ private:
     
     H264EncoderConfig config_;
     bool initialized_;
-    int frame_count_;
+    FrameClock clock_;  // Timestamps in the time base the codec was opened with
     
     const AVCodec* codec_ = nullptr;
     AVCodecContext* codec_ctx_ = nullptr;
     AVFrame* frame_ = nullptr;
+    AVFrame* input_frame_ = nullptr;  // References caller planes, never owns them
     AVPacket* packet_ = nullptr;
 };
 
@@ -12,6 +12,9 @@ extern "C" {
 #include <string>
 #include <vector>
 
+#include "media_encoded_packet.h"
+#include "media_video_frame.h"
+
 namespace media {
 
 struct H264EncoderConfig {
@@ -37,7 +40,7 @@ struct H264EncoderConfig {
     bool repeat_headers = false;    // Repeat SPS/PPS headers
     
     // Rate control
-    bool constant_bitrate = false;  // Use CBR instead of VBR
+    bool constant_bitrate = false;  // ABR capped by VBV at the bitrate instead of CRF/QP
     int crf = 23;                   // Constant Rate Factor (0-51, lower is better quality)
     int qp = -1;                    // Constant QP (0-51, -1 to disable)
     int rc_lookahead = 40;          // Rate control lookahead
@@ -92,6 +95,10 @@ struct H264EncoderConfig {
     // Compatibility
     bool force_cfr = false;         // Force constant framerate
     bool bluray_compat = false;     // Enable Blu-ray compatibility
+    
+    // Color signalling in the VUI (AVColorSpace / AVColorRange, -1 = unspecified)
+    int colorspace = -1;
+    int color_range = -1;
 };
 
 class H264Encoder {
@@ -106,12 +113,33 @@ public:
     virtual bool EncodeYUV420(const std::vector<uint8_t>& yuv_data, 
                              std::vector<uint8_t>* output_frame) = 0;
     
+    // Encodes a YUV420 frame described by plane pointers and strides.
+    // Planes are read in place when their layout allows it, otherwise they
+    // are copied once, row by row, into the encoder's frame.
+    virtual bool EncodeYUV420(const VideoFrameView& frame,
+                             std::vector<uint8_t>* output_frame) = 0;
+    
+    // Encodes a frame and returns every packet the encoder produced for it.
+    // Packets reference the encoder's buffers directly and keep packet
+    // boundaries, timestamps and the keyframe flag.
+    virtual bool EncodeYUV420(const VideoFrameView& frame,
+                             std::vector<EncodedPacket>* packets) = 0;
+    
     // Flush any remaining frames (call when encoding is finished)
     virtual bool Flush(std::vector<uint8_t>* output_frame) = 0;
+    virtual bool Flush(std::vector<EncodedPacket>* packets) = 0;
     
     // Reset the encoder with new configuration
     virtual bool Reconfigure(const H264EncoderConfig& config) = 0;
     
+    // Change rate control targets on the running encoder without reopening
+    // it; x264 picks them up before the next frame. Zero leaves a value
+    // unchanged. Returns false for a bitrate unless |constant_bitrate| is set,
+    // for VBV values unless VBV was on at open, and for a |framerate| above
+    // the rate the encoder opened with.
+    virtual bool UpdateRateControl(int bitrate, int vbv_maxrate,
+                                   int vbv_bufsize, int framerate) = 0;
+    
     // Get current configuration
     virtual H264EncoderConfig GetConfig() const = 0;
 };
@@ -8,9 +8,12 @@ extern "C" {
 }
 
 #include <cstring>
+#include <deque>
 #include <iostream>
 #include <sstream>
 
+#include "media_stream_parser.h"
+
 namespace media {
 
 namespace {
@@ -26,6 +29,13 @@ class HEVCDecoderImpl : public HEVCDecoder {
   // Implementation of HEVCDecoder interface
   int DecodeToYUV420(std::vector<uint8_t>* yuv_frame,
                     const std::vector<uint8_t>* hevc_frame) override;
+  int Decode(DecodedFrame* frame,
+             const std::vector<uint8_t>* hevc_frame) override;
+  int DecodeStream(const uint8_t* data, size_t size,
+                   std::vector<DecodedFrame>* frames) override;
+  int ReceiveFrames(std::vector<DecodedFrame>* frames) override;
+  int Flush(std::vector<DecodedFrame>* frames) override;
+  int GetDelay() const override;
   int GetWidth() const override;
   int GetHeight() const override;
   void Flush() override;
@@ -40,6 +50,20 @@ class HEVCDecoderImpl : public HEVCDecoder {
   // Apply config to codec context
   bool ApplyConfig();
 
+  // Take the next ready picture from the decoder; 1 if there was one
+  int ReceiveFrame(DecodedFrame* frame);
+
+  // Hand out the oldest picture, queued ones first; 1 if there was one
+  int NextFrame(DecodedFrame* frame);
+
+  // Send a packet (nullptr to drain). On EAGAIN the ready pictures move to
+  // pending_ and the packet is sent again instead of being lost.
+  int SendPacket(const AVPacket* packet);
+
+  // Send the end of stream, queue every picture left and reset the decoder
+  // for the next stream
+  void Drain();
+
   // FFmpeg structures
   const AVCodec* codec_ = nullptr;
   AVCodecContext* codec_ctx_ = nullptr;
@@ -49,6 +73,12 @@ class HEVCDecoderImpl : public HEVCDecoder {
   // Configuration parameters
   HEVCDecoderConfig config_;
 
+  // Splits streamed input into access units
+  StreamParser stream_parser_{CodecType::HEVC};
+
+  // Pictures taken out of the decoder ahead of the caller, oldest first
+  std::deque<DecodedFrame> pending_;
+
   // Flag to track if decoder is initialized
   bool initialized_ = false;
 };
@@ -103,12 +133,8 @@ bool HEVCDecoderImpl::ApplyConfig() {
   
   codec_ctx_->skip_frame = static_cast<AVDiscard>(config_.skip_frame);
 
-  // Output format options
-  if (config_.output_10bit) {
-    codec_ctx_->pix_fmt = AV_PIX_FMT_YUV420P10LE;
-  } else {
-    codec_ctx_->pix_fmt = AV_PIX_FMT_YUV420P;
-  }
+  // The output format follows the stream; output_10bit is applied to each
+  // decoded picture in Decode()
   
   if (!config_.output_crop) {
     codec_ctx_->flags |= AV_CODEC_FLAG_UNALIGNED;
@@ -151,6 +177,19 @@ bool HEVCDecoderImpl::Initialize() {
     return false;
   }
 
+  // Parameter sets passed out of band (hvcC or Annex B VPS/SPS/PPS)
+  if (!config_.extradata.empty()) {
+    codec_ctx_->extradata = static_cast<uint8_t*>(
+        av_mallocz(config_.extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+    if (!codec_ctx_->extradata) {
+      std::cerr << "Failed to allocate extradata" << std::endl;
+      Cleanup();
+      return false;
+    }
+    std::memcpy(codec_ctx_->extradata, config_.extradata.data(), config_.extradata.size());
+    codec_ctx_->extradata_size = static_cast<int>(config_.extradata.size());
+  }
+
   // Apply configuration to codec context
   if (!ApplyConfig()) {
     std::cerr << "Failed to apply configuration" << std::endl;
@@ -186,57 +225,156 @@ bool HEVCDecoderImpl::Initialize() {
 
 int HEVCDecoderImpl::DecodeToYUV420(std::vector<uint8_t>* yuv_frame,
                                    const std::vector<uint8_t>* hevc_frame) {
-  if (!initialized_ || !yuv_frame || !hevc_frame) {
+  if (!yuv_frame) {
+    return 0;  // Error
+  }
+
+  DecodedFrame frame;
+  if (Decode(&frame, hevc_frame) <= 0) {
+    return 0;  // Error or need more data
+  }
+
+  // Pack the planes into the output buffer without row padding, converting
+  // to the requested layout on the way
+  if (!frame.CopyTo(yuv_frame, config_.pixel_format)) {
     return 0;  // Error
   }
 
+  return 1;  // Success
+}
+
+int HEVCDecoderImpl::Decode(DecodedFrame* frame,
+                           const std::vector<uint8_t>* hevc_frame) {
+  if (!initialized_ || !frame || !hevc_frame) {
+    return -1;  // Error
+  }
+
+  // End of stream: queue what the decoder still holds
+  if (hevc_frame->empty()) {
+    Drain();
+    return NextFrame(frame);
+  }
+
   // Fill packet with input data
   av_packet_unref(av_packet_);
   av_packet_->data = const_cast<uint8_t*>(hevc_frame->data());
   av_packet_->size = static_cast<int>(hevc_frame->size());
 
   // Send packet to decoder
-  int send_result = avcodec_send_packet(codec_ctx_, av_packet_);
+  int send_result = SendPacket(av_packet_);
   if (send_result < 0) {
     std::cerr << "Error sending packet for decoding: " << send_result << std::endl;
-    return 0;  // Error
+    return send_result;  // Error
+  }
+
+  return NextFrame(frame);
+}
+
+int HEVCDecoderImpl::DecodeStream(const uint8_t* data, size_t size,
+                                  std::vector<DecodedFrame>* frames) {
+  if (!initialized_ || !frames) {
+    return -1;  // Error
+  }
+
+  int count = 0;
+  stream_parser_.Feed(data, size);
+  while (stream_parser_.Next(codec_ctx_, av_packet_)) {
+    int send_result = SendPacket(av_packet_);
+    if (send_result < 0) {
+      // A damaged access unit should not end the stream
+      std::cerr << "Error sending access unit for decoding: " << send_result << std::endl;
+      continue;
+    }
+    count += ReceiveFrames(frames);
   }
 
+  // End of stream: drain the pictures held for reordering
+  if (!data || size == 0) {
+    count += Flush(frames);
+  }
+
+  return count;
+}
+
+int HEVCDecoderImpl::ReceiveFrame(DecodedFrame* frame) {
   // Receive frame
   int receive_result = avcodec_receive_frame(codec_ctx_, av_frame_);
   if (receive_result < 0) {
-    if (receive_result != AVERROR(EAGAIN) && receive_result != AVERROR_EOF) {
-      std::cerr << "Error during decoding: " << receive_result << std::endl;
+    if (receive_result == AVERROR(EAGAIN) || receive_result == AVERROR_EOF) {
+      return 0;  // Need more data
     }
-    return 0;  // Error or need more data
+    std::cerr << "Error during decoding: " << receive_result << std::endl;
+    return receive_result;  // Error
   }
 
-  // Check frame format
-  if (av_frame_->format != AV_PIX_FMT_YUV420P && 
-      av_frame_->format != AV_PIX_FMT_YUV420P10LE) {
-    std::cerr << "Unexpected pixel format: " << av_frame_->format << std::endl;
-    return 0;  // Error
+  // High bit depth pictures stay native only when the caller asked for them
+  if (!config_.output_10bit && !ReduceTo8Bit(av_frame_)) {
+    av_frame_unref(av_frame_);
+    return -1;  // Error
   }
 
-  // Calculate required buffer size
-  int y_size = av_frame_->linesize[0] * av_frame_->height;
-  int u_size = av_frame_->linesize[1] * av_frame_->height / 2;
-  int v_size = av_frame_->linesize[2] * av_frame_->height / 2;
-  int total_size = y_size + u_size + v_size;
+  // Hand the decoder's buffers to the caller without copying them
+  *frame = DecodedFrame::TakeFrom(av_frame_);
 
-  // Resize output buffer
-  yuv_frame->resize(total_size);
+  return 1;  // Success
+}
 
-  // Copy Y plane
-  std::memcpy(yuv_frame->data(), av_frame_->data[0], y_size);
-  
-  // Copy U plane
-  std::memcpy(yuv_frame->data() + y_size, av_frame_->data[1], u_size);
-  
-  // Copy V plane
-  std::memcpy(yuv_frame->data() + y_size + u_size, av_frame_->data[2], v_size);
+int HEVCDecoderImpl::NextFrame(DecodedFrame* frame) {
+  if (pending_.empty()) {
+    return ReceiveFrame(frame);
+  }
+  *frame = pending_.front();
+  pending_.pop_front();
+  return 1;
+}
 
-  return 1;  // Success
+int HEVCDecoderImpl::SendPacket(const AVPacket* packet) {
+  int result = avcodec_send_packet(codec_ctx_, packet);
+  if (result == AVERROR(EAGAIN)) {
+    DecodedFrame frame;
+    while (ReceiveFrame(&frame) > 0) {
+      pending_.push_back(frame);
+    }
+    result = avcodec_send_packet(codec_ctx_, packet);
+  }
+  return result;
+}
+
+void HEVCDecoderImpl::Drain() {
+  if (SendPacket(nullptr) >= 0) {
+    DecodedFrame frame;
+    while (ReceiveFrame(&frame) > 0) {
+      pending_.push_back(frame);
+    }
+  }
+  avcodec_flush_buffers(codec_ctx_);
+}
+
+int HEVCDecoderImpl::ReceiveFrames(std::vector<DecodedFrame>* frames) {
+  if (!initialized_ || !frames) {
+    return 0;
+  }
+
+  int count = 0;
+  DecodedFrame frame;
+  while (NextFrame(&frame) > 0) {
+    frames->push_back(frame);
+    count++;
+  }
+  return count;
+}
+
+int HEVCDecoderImpl::Flush(std::vector<DecodedFrame>* frames) {
+  if (!initialized_ || !frames) {
+    return 0;
+  }
+
+  Drain();
+  return ReceiveFrames(frames);
+}
+
+int HEVCDecoderImpl::GetDelay() const {
+  return initialized_ ? DecoderDelay(codec_ctx_) : 0;
 }
 
 int HEVCDecoderImpl::GetWidth() const {
@@ -248,12 +386,16 @@ int HEVCDecoderImpl::GetHeight() const {
 }
 
 void HEVCDecoderImpl::Flush() {
+  stream_parser_.Reset();
+  pending_.clear();
   if (initialized_) {
     avcodec_flush_buffers(codec_ctx_);
   }
 }
 
 void HEVCDecoderImpl::Reset() {
+  stream_parser_.Reset();
+  pending_.clear();
   Cleanup();
   initialized_ = Initialize();
 }
@@ -1,11 +1,14 @@
 #ifndef MEDIA_HEVC_DECODER_H_
 #define MEDIA_HEVC_DECODER_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "media_decoded_frame.h"
+
 namespace media {
 
 enum class DeinterlaceMode {
@@ -35,7 +38,8 @@ struct HEVCDecoderConfig {
   int skip_frame = 0;  // 0-none, 1-default, 2-noref, 3-bidir, 4-nonintra, 5-all
   
   // Output format options
-  bool output_10bit = false;  // Output in 10-bit format if available
+  bool output_10bit = false;  // Hand out Main10 pictures as YUV420P10 instead of rounding to 8 bits
+  int pixel_format = -1;  // DecodeToYUV420 layout: AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12 or -1 (decoder's own)
   bool output_crop = true;  // Apply cropping information from bitstream
   bool preserve_alpha = false;  // Preserve alpha channel if present
   
@@ -61,6 +65,9 @@ struct HEVCDecoderConfig {
   
   // Bitstream filter
   std::string bitstream_filters = "";  // Comma-separated list of bitstream filters
+
+  // Out-of-band parameter sets (hvcC or Annex B VPS/SPS/PPS), empty if in-band
+  std::vector<uint8_t> extradata;
 };
 
 class HEVCDecoder {
@@ -70,20 +77,52 @@ class HEVCDecoder {
 
   virtual ~HEVCDecoder() = default;
 
-  // Decode a HEVC frame to YUV420 format
+  // Decode a HEVC frame to YUV420 format. With output_10bit, Main10 frames
+  // are written as YUV420P10 (two bytes per sample).
   // Returns 0 on error, positive value on success
   virtual int DecodeToYUV420(std::vector<uint8_t>* yuv_frame,
                             const std::vector<uint8_t>* hevc_frame) = 0;
 
+  // Decode a HEVC frame without copying the picture. |frame| references the
+  // decoder's buffers and stays valid across later calls.
+  // An empty packet ends the stream; each such call then hands out one of
+  // the remaining pictures until 0 is returned.
+  // Returns 1 if a frame was output, 0 if more data is needed, negative value on error
+  virtual int Decode(DecodedFrame* frame,
+                     const std::vector<uint8_t>* hevc_frame) = 0;
+
+  // Streaming input: |data| is any slice of an Annex B stream, such as one
+  // socket read. Access units are split off with av_parser_parse2 without
+  // copying the chunk, and every frame they complete is appended to
+  // |frames|. An empty chunk ends the stream and drains the decoder.
+  // Returns the number of frames appended, negative value on error
+  virtual int DecodeStream(const uint8_t* data, size_t size,
+                           std::vector<DecodedFrame>* frames) = 0;
+
+  // Decode() returns at most one frame per packet. With frame threading a
+  // packet can release several, so call this after each Decode() to
+  // collect the rest; they are appended to |frames| in output order.
+  // Returns the number of frames appended
+  virtual int ReceiveFrames(std::vector<DecodedFrame>* frames) = 0;
+
+  // Frames the decoder holds back before output (reorder buffer plus frame
+  // threads), i.e. how far output lags input
+  virtual int GetDelay() const = 0;
+
   // Get frame width
   virtual int GetWidth() const = 0;
 
   // Get frame height
   virtual int GetHeight() const = 0;
 
-  // Flush the decoder
+  // Discard the pictures still buffered, e.g. before seeking
   virtual void Flush() = 0;
 
+  // Ends the stream: appends every picture still buffered to |frames| and
+  // leaves the decoder ready for a new stream.
+  // Returns the number of frames appended
+  virtual int Flush(std::vector<DecodedFrame>* frames) = 0;
+
   // Reset the decoder
   virtual void Reset() = 0;
   
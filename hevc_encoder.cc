@@ -53,7 +53,8 @@ const std::map<HEVCTune, const char*> kTuneMap = {
 class HEVCEncoderImpl : public HEVCEncoder {
 public:
     HEVCEncoderImpl() 
-        : codec_(nullptr), codec_context_(nullptr), frame_(nullptr), packet_(nullptr),
+        : codec_(nullptr), codec_context_(nullptr), frame_(nullptr), input_frame_(nullptr),
+          packet_(nullptr),
           frames_encoded_(0), total_bytes_(0), total_bits_(0) {}
 
     ~HEVCEncoderImpl() override {
@@ -63,6 +64,9 @@ public:
         if (frame_) {
             av_frame_free(&frame_);
         }
+        if (input_frame_) {
+            av_frame_free(&input_frame_);
+        }
         if (packet_) {
             av_packet_free(&packet_);
         }
@@ -93,7 +97,11 @@ public:
         codec_context_->framerate = AVRational{config.framerate, 1};
         codec_context_->gop_size = config.keyint_max;
         codec_context_->max_b_frames = config.bframes;
-        codec_context_->pix_fmt = AV_PIX_FMT_YUV420P;
+        // 10-bit input comes as samples little-endian in 16-bit words; the
+        // profile alone does not say what the caller feeds
+        codec_context_->pix_fmt = config.bit_depth == 10
+                                      ? AV_PIX_FMT_YUV420P10LE
+                                      : AV_PIX_FMT_YUV420P;
         codec_context_->thread_count = config.threads;
         codec_context_->slices = config.slice_max_count;
 
@@ -161,11 +169,15 @@ public:
         if (config.keyint_min > 0) {
             av_opt_set_int(codec_context_->priv_data, "keyint_min", config.keyint_min, 0);
         }
+        // libx265 only takes these through its parameter string, which has to
+        // be set once since a second x265-params replaces the first
+        std::string x265_params = std::string("open-gop=") + (config.open_gop ? "1" : "0") +
+                                  ":b-pyramid=" + (config.b_pyramid ? "1" : "0");
         if (config.scenecut >= 0) {
-            av_opt_set_int(codec_context_->priv_data, "scenecut", config.scenecut, 0);
+            x265_params += ":scenecut=" + std::to_string(config.scenecut);
         }
-        av_opt_set_int(codec_context_->priv_data, "open-gop", config.open_gop ? 1 : 0, 0);
-        av_opt_set_int(codec_context_->priv_data, "b-pyramid", config.b_pyramid ? 1 : 0, 0);
+        av_opt_set(codec_context_->priv_data, "x265-params", x265_params.c_str(), 0);
+        av_opt_set_int(codec_context_->priv_data, "forced-idr", config.forced_idr ? 1 : 0, 0);
         
         // Quality settings
         av_opt_set_int(codec_context_->priv_data, "aq-mode", config.aq_mode ? 1 : 0, 0);
@@ -220,6 +232,9 @@ public:
         // VUI parameters
         if (config.vui_parameters) {
             codec_context_->color_range = config.fullrange ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+            if (config.colorspace >= 0) {
+                codec_context_->colorspace = static_cast<AVColorSpace>(config.colorspace);
+            }
         }
 
         // Open the codec
@@ -248,6 +263,13 @@ public:
             return false;
         }
 
+        // Allocate the frame used to reference caller-owned planes
+        input_frame_ = av_frame_alloc();
+        if (!input_frame_) {
+            std::cerr << "Could not allocate input frame" << std::endl;
+            return false;
+        }
+
         // Allocate packet
         packet_ = av_packet_alloc();
         if (!packet_) {
@@ -255,7 +277,7 @@ public:
             return false;
         }
 
-        frame_count_ = 0;
+        clock_ = FrameClock(config.framerate);
         frames_encoded_ = 0;
         total_bytes_ = 0;
         total_bits_ = 0;
@@ -269,49 +291,78 @@ public:
             return 0;
         }
 
-        // Make sure the frame is writable
-        int ret = av_frame_make_writable(frame_);
-        if (ret < 0) {
-            std::cerr << "Could not make frame writable" << std::endl;
+        // Verify input size; Main10 input has two bytes per sample
+        const int bit_depth = av_pix_fmt_desc_get(codec_context_->pix_fmt)->comp[0].depth;
+        if (yuv_data.size() < YUV420BufferSize(codec_context_->width,
+                                               codec_context_->height, bit_depth)) {
+            std::cerr << "Input data size is too small" << std::endl;
             return 0;
         }
 
-        // Calculate plane sizes
-        int y_size = codec_context_->width * codec_context_->height;
-        int u_size = (codec_context_->width / 2) * (codec_context_->height / 2);
-        int v_size = u_size;
+        return EncodeYUV420(VideoFrameView::FromYUV420(yuv_data.data(),
+                                                       codec_context_->width,
+                                                       codec_context_->height,
+                                                       bit_depth),
+                            encoded_frame);
+    }
 
-        // Verify input size
-        if (yuv_data.size() < y_size + u_size + v_size) {
-            std::cerr << "Input data size is too small" << std::endl;
+    int EncodeYUV420(const VideoFrameView& frame,
+                    std::vector<uint8_t>* encoded_frame) override {
+        std::vector<EncodedPacket> packets;
+        if (!EncodeYUV420(frame, &packets)) {
             return 0;
         }
 
-        // Fill frame data
-        std::memcpy(frame_->data[0], yuv_data.data(), y_size);
-        std::memcpy(frame_->data[1], yuv_data.data() + y_size, u_size);
-        std::memcpy(frame_->data[2], yuv_data.data() + y_size + u_size, v_size);
+        encoded_frame->clear();
+        AppendPackets(packets, encoded_frame);
+        return 1;
+    }
 
-        frame_->pts = frame_count_++;
+    int EncodeYUV420(const VideoFrameView& frame,
+                    std::vector<EncodedPacket>* packets) override {
+        if (!codec_context_ || !frame_ || !input_frame_ || !packet_) {
+            return 0;
+        }
+
+        // Reference the caller planes directly or copy them into frame_
+        AVFrame* input = PrepareEncoderFrame(frame, frame_, input_frame_);
+        if (!input) {
+            return 0;
+        }
+
+        int64_t pts = clock_.Next();
+        input->pts = frame.pts >= 0 ? frame.pts : pts;
 
         // Encode the frame
-        ret = avcodec_send_frame(codec_context_, frame_);
+        int ret = avcodec_send_frame(codec_context_, input);
+        av_frame_unref(input_frame_);
         if (ret < 0) {
             std::cerr << "Error sending frame for encoding" << std::endl;
             return 0;
         }
 
-        return ReceivePacket(encoded_frame);
+        return ReceivePackets(packets);
     }
 
     int Flush(std::vector<uint8_t>* encoded_frame) override {
+        std::vector<EncodedPacket> packets;
+        if (!Flush(&packets)) {
+            return 0;
+        }
+
+        encoded_frame->clear();
+        AppendPackets(packets, encoded_frame);
+        return 1;
+    }
+
+    int Flush(std::vector<EncodedPacket>* packets) override {
         int ret = avcodec_send_frame(codec_context_, nullptr);
         if (ret < 0) {
             std::cerr << "Error flushing encoder" << std::endl;
             return 0;
         }
 
-        return ReceivePacket(encoded_frame);
+        return ReceivePackets(packets);
     }
     
     void GetStats(int* frames_encoded, double* avg_bitrate) const override {
@@ -326,49 +377,53 @@ public:
     }
     
     bool UpdateParams(int new_bitrate, int new_framerate) override {
-        if (new_bitrate > 0) {
-            av_opt_set_int(codec_context_->priv_data, "bitrate", new_bitrate, 0);
-            config_.bitrate = new_bitrate;
-        }
-        
-        if (new_framerate > 0) {
-            codec_context_->time_base = AVRational{1, new_framerate};
-            codec_context_->framerate = AVRational{new_framerate, 1};
-            config_.framerate = new_framerate;
+        return UpdateRateControl(new_bitrate, 0, 0, new_framerate);
+    }
+    
+    bool UpdateRateControl(int bitrate, int vbv_maxrate,
+                           int vbv_bufsize, int framerate) override {
+        if (!codec_context_) {
+            return false;
         }
         
-        return true;
+        // libx265 reads bitrate, VBV and fps once when it is opened and
+        // FFmpeg never reconfigures it, so changing the context here would
+        // be ignored
+        std::cerr << "Rate control updates are not supported by the running HEVC encoder"
+                  << std::endl;
+        return false;
     }
 
 private:
-    int ReceivePacket(std::vector<uint8_t>* encoded_frame) {
-        int ret = avcodec_receive_packet(codec_context_, packet_);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            // Need more input or end of stream
-            return 1;
-        } else if (ret < 0) {
-            std::cerr << "Error receiving packet from encoder" << std::endl;
-            return 0;
+    int ReceivePackets(std::vector<EncodedPacket>* packets) {
+        packets->clear();
+
+        while (true) {
+            int ret = avcodec_receive_packet(codec_context_, packet_);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                // Need more input or end of stream
+                return 1;
+            } else if (ret < 0) {
+                std::cerr << "Error receiving packet from encoder" << std::endl;
+                return 0;
+            }
+
+            // Update stats
+            frames_encoded_++;
+            total_bytes_ += packet_->size;
+            total_bits_ += packet_->size * 8;
+
+            // Hand the packet buffer to the caller without copying it
+            packets->push_back(EncodedPacket::TakeFrom(packet_));
         }
-
-        // Copy packet data to output vector
-        encoded_frame->resize(packet_->size);
-        std::memcpy(encoded_frame->data(), packet_->data, packet_->size);
-        
-        // Update stats
-        frames_encoded_++;
-        total_bytes_ += packet_->size;
-        total_bits_ += packet_->size * 8;
-
-        av_packet_unref(packet_);
-        return 1;
     }
 
     const AVCodec* codec_;
     AVCodecContext* codec_context_;
     AVFrame* frame_;
+    AVFrame* input_frame_;  // References caller planes, never owns them
     AVPacket* packet_;
-    int64_t frame_count_;
+    FrameClock clock_;  // Timestamps in the time base the codec was opened with
     HEVCEncoderConfig config_;
     
     // Stats
@@ -7,6 +7,9 @@
 #include <cstring>
 #include <string>
 
+#include "media_encoded_packet.h"
+#include "media_video_frame.h"
+
 namespace media {
 
 // Enum for HEVC encoder presets
@@ -71,6 +74,10 @@ struct HEVCEncoderConfig {
     HEVCTier tier = HEVCTier::MAIN;
     float level = 0.0;  // 1.0, 2.0, 2.1, 3.0, 3.1, 4.0, 4.1, 5.0, 5.1, 5.2, 6.0, 6.1, 6.2
     
+    // Input bit depth: 8, or 10 for YUV420P10 input (needs the Main10 profile).
+    // Main10 may also be used with 8-bit input.
+    int bit_depth = 8;
+    
     // Rate control settings
     RateControlMode rc_mode = RateControlMode::ABR;
     int crf = 23;         // Constant rate factor (0-51, lower means better quality)
@@ -85,6 +92,7 @@ struct HEVCEncoderConfig {
     int keyint_min = 25;    // Minimum GOP size
     int scenecut = 40;      // Scene cut threshold
     bool open_gop = false;  // Open GOP configuration
+    bool forced_idr = false;  // Code forced keyframes as IDR instead of CRA pictures
     int bframes = 4;        // Number of B-frames between I and P
     bool b_pyramid = true;  // Use B-frames as references
     
@@ -129,6 +137,7 @@ struct HEVCEncoderConfig {
     // VUI (Video Usability Information) settings
     bool vui_parameters = true;          // Include VUI parameters
     bool fullrange = false;              // Use full range (vs. limited range)
+    int colorspace = -1;                 // Matrix coefficients (AVColorSpace, -1 = unspecified)
     
     // Frames to encode
     int frames = 0;                     // Number of frames to encode (0 = all)
@@ -150,14 +159,34 @@ public:
     virtual int EncodeYUV420(const std::vector<uint8_t>& yuv_data, 
                             std::vector<uint8_t>* encoded_frame) = 0;
 
+    // Encodes a YUV420 frame described by plane pointers and strides.
+    // Planes are read in place when their layout allows it, otherwise they
+    // are copied once, row by row, into the encoder's frame.
+    // Returns: 1 on success, 0 on failure
+    virtual int EncodeYUV420(const VideoFrameView& frame,
+                            std::vector<uint8_t>* encoded_frame) = 0;
+
+    // Encodes a frame and returns every packet the encoder produced for it.
+    // Packets reference the encoder's buffers directly and keep packet
+    // boundaries, timestamps and the keyframe flag.
+    // Returns: 1 on success, 0 on failure
+    virtual int EncodeYUV420(const VideoFrameView& frame,
+                            std::vector<EncodedPacket>* packets) = 0;
+
     // Flush any buffered frames
     virtual int Flush(std::vector<uint8_t>* encoded_frame) = 0;
+    virtual int Flush(std::vector<EncodedPacket>* packets) = 0;
     
     // Get current encoding stats
     virtual void GetStats(int* frames_encoded, double* avg_bitrate) const = 0;
     
     // Update encoder parameters mid-stream (only some parameters can be changed)
     virtual bool UpdateParams(int new_bitrate, int new_framerate) = 0;
+    
+    // Change rate control targets on the running encoder. libx265 takes
+    // them only when it is opened, so this always returns false.
+    virtual bool UpdateRateControl(int bitrate, int vbv_maxrate,
+                                   int vbv_bufsize, int framerate) = 0;
 };
 
 }  // namespace media
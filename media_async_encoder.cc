@@ -0,0 +1,388 @@
+#include "media_async_encoder.h"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "media_color_convert.h"
+
+namespace media {
+
+namespace {
+
+// Pooled planes are aligned so encoders can read them in place
+const int kPlaneAlignment = 32;
+
+int AlignUp(int value) {
+  return (value + kPlaneAlignment - 1) & ~(kPlaneAlignment - 1);
+}
+
+// One unit of work travelling through the pipeline
+struct WorkItem {
+  enum class Type { kFrame, kFlush };
+
+  Type type = Type::kFrame;
+  VideoFrameView view;                              // Planes to encode
+  AsyncVideoEncoder::ReleaseCallback on_released;   // Set for caller-owned planes
+  std::vector<uint8_t> buffer;                      // Storage behind |view| once owned
+  bool owned = false;                               // |view| already points into |buffer|
+  bool p010 = false;                                // |buffer| holds P010 still to unpack
+  std::shared_ptr<std::promise<bool>> flushed;      // Set for flush markers
+};
+
+// Unbounded FIFO handing work from one stage to the next. Backpressure is
+// applied once, at submission, so the stages never block each other.
+class WorkQueue {
+ public:
+  void Push(WorkItem item) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      items_.push_back(std::move(item));
+    }
+    cond_.notify_one();
+  }
+
+  // Blocks until an item is available; returns false once closed and empty
+  bool Pop(WorkItem* item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return false;
+    }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    return true;
+  }
+
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    cond_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<WorkItem> items_;
+  bool closed_ = false;
+};
+
+class AsyncVideoEncoderImpl : public AsyncVideoEncoder {
+ public:
+  AsyncVideoEncoderImpl(std::unique_ptr<VideoEncoder> encoder,
+                        const AsyncEncoderConfig& async_config)
+      : encoder_(std::move(encoder)),
+        async_config_(async_config) {
+    if (async_config_.queue_depth == 0) {
+      async_config_.queue_depth = 1;
+    }
+    copy_thread_ = std::thread(&AsyncVideoEncoderImpl::CopyLoop, this);
+    encode_thread_ = std::thread(&AsyncVideoEncoderImpl::EncodeLoop, this);
+  }
+
+  ~AsyncVideoEncoderImpl() override {
+    // Closing the first queue lets both stages drain and exit in order
+    copy_queue_.Close();
+    copy_thread_.join();
+    encode_thread_.join();
+  }
+
+  void SetPacketCallback(PacketCallback callback) override {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    callback_ = std::move(callback);
+  }
+
+  bool SubmitFrame(const VideoFrameView& frame, ReleaseCallback on_released) override {
+    if (!AcquireSlot()) {
+      return false;
+    }
+
+    WorkItem item;
+    item.view = frame;
+    item.on_released = std::move(on_released);
+    copy_queue_.Push(std::move(item));
+    return true;
+  }
+
+  bool SubmitFrame(std::vector<uint8_t>&& yuv_data, int64_t pts) override {
+    const VideoEncoderConfig config = encoder_->GetConfig();
+    const int bit_depth = InputBitDepth(config.input_format);
+    if (yuv_data.size() < YUV420BufferSize(config.width, config.height, bit_depth)) {
+      std::cerr << "Input YUV data is too small" << std::endl;
+      return false;
+    }
+
+    if (!AcquireSlot()) {
+      return false;
+    }
+
+    WorkItem item;
+    item.buffer = std::move(yuv_data);
+    item.view = VideoFrameView::FromYUV420(item.buffer.data(), config.width, config.height,
+                                           bit_depth);
+    item.view.pts = pts;
+    // P010 is semi-planar with MSB-aligned samples; the copy stage unpacks it
+    item.p010 = config.input_format == PixelFormat::P010;
+    item.owned = !item.p010;
+    copy_queue_.Push(std::move(item));
+    return true;
+  }
+
+  bool PollPackets(std::vector<EncodedPacket>* packets) override {
+    if (!packets) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    packets->clear();
+    packets->swap(output_);
+    return !packets->empty();
+  }
+
+  bool Flush() override {
+    WorkItem item;
+    item.type = WorkItem::Type::kFlush;
+    item.flushed = std::make_shared<std::promise<bool>>();
+    std::future<bool> done = item.flushed->get_future();
+
+    copy_queue_.Push(std::move(item));
+    return done.get();
+  }
+
+  size_t GetQueueDepth() const override {
+    std::lock_guard<std::mutex> lock(slot_mutex_);
+    return in_flight_;
+  }
+
+  uint64_t GetDroppedFrames() const override {
+    return dropped_frames_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetFailedFrames() const override {
+    return failed_frames_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Reserves room for one frame, blocking or dropping when the pipeline is full
+  bool AcquireSlot() {
+    std::unique_lock<std::mutex> lock(slot_mutex_);
+    if (in_flight_ >= async_config_.queue_depth) {
+      if (!async_config_.block_when_full) {
+        dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      slot_cond_.wait(lock, [this] { return in_flight_ < async_config_.queue_depth; });
+    }
+    in_flight_++;
+    return true;
+  }
+
+  void ReleaseSlot() {
+    {
+      std::lock_guard<std::mutex> lock(slot_mutex_);
+      in_flight_--;
+    }
+    slot_cond_.notify_one();
+  }
+
+  // Copy stage: moves caller planes into pooled, aligned buffers
+  void CopyLoop() {
+    WorkItem item;
+    while (copy_queue_.Pop(&item)) {
+      if (item.type == WorkItem::Type::kFrame && item.p010) {
+        UnpackP010(&item);
+      } else if (item.type == WorkItem::Type::kFrame && !item.owned) {
+        CopyToPooledBuffer(&item);
+        if (item.on_released) {
+          item.on_released();
+          item.on_released = nullptr;
+        }
+      }
+      encode_queue_.Push(std::move(item));
+    }
+    encode_queue_.Close();
+  }
+
+  // Encode stage: the only thread that touches |encoder_|
+  void EncodeLoop() {
+    WorkItem item;
+    std::vector<EncodedPacket> packets;
+    while (encode_queue_.Pop(&item)) {
+      if (item.type == WorkItem::Type::kFlush) {
+        bool result = encoder_->Flush(&packets);
+        Deliver(&packets);
+        item.flushed->set_value(result);
+        continue;
+      }
+
+      if (encoder_->EncodeYUV420(item.view, &packets)) {
+        Deliver(&packets);
+      } else {
+        failed_frames_.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "Asynchronous encode failed" << std::endl;
+      }
+
+      RecycleBuffer(std::move(item.buffer));
+      ReleaseSlot();
+    }
+  }
+
+  void CopyToPooledBuffer(WorkItem* item) {
+    const VideoFrameView src = item->view;
+    const int bytes_per_sample = src.bit_depth > 8 ? 2 : 1;
+    const int chroma_width = (src.width + 1) / 2;
+    const int chroma_height = (src.height + 1) / 2;
+
+    uint8_t* planes[3];
+    AllocatePooledPlanes(item, planes);
+    for (int i = 0; i < 3; i++) {
+      const int width = i == 0 ? src.width : chroma_width;
+      const int height = i == 0 ? src.height : chroma_height;
+      av_image_copy_plane(planes[i], item->view.stride[i], src.data[i], src.stride[i],
+                          width * bytes_per_sample, height);
+    }
+  }
+
+  // Converts an owned, tightly packed P010 buffer into pooled YUV420P10
+  // planes, the same way InputConverter handles P010 for EncodeNV12
+  void UnpackP010(WorkItem* item) {
+    std::vector<uint8_t> packed = std::move(item->buffer);
+    const int width = item->view.width;
+    const int height = item->view.height;
+    const size_t luma_size = static_cast<size_t>(width) * height * 2;
+
+    uint8_t* planes[3];
+    AllocatePooledPlanes(item, planes);
+    color::P010ToYUV420P10(packed.data(), width * 2,
+                           packed.data() + luma_size, (width + 1) / 2 * 4,
+                           width, height,
+                           planes[0], item->view.stride[0],
+                           planes[1], item->view.stride[1],
+                           planes[2], item->view.stride[2]);
+    item->p010 = false;
+    RecycleBuffer(std::move(packed));
+  }
+
+  // Points |item->view| at aligned planes in a pooled |item->buffer|, keeping
+  // its size, timestamp and bit depth
+  void AllocatePooledPlanes(WorkItem* item, uint8_t* planes[3]) {
+    VideoFrameView& view = item->view;
+    const int bytes_per_sample = view.bit_depth > 8 ? 2 : 1;
+    const int chroma_width = (view.width + 1) / 2;
+    const int chroma_height = (view.height + 1) / 2;
+    const int y_stride = AlignUp(view.width * bytes_per_sample);
+    const int c_stride = AlignUp(chroma_width * bytes_per_sample);
+    const size_t y_size = static_cast<size_t>(y_stride) * view.height;
+    const size_t c_size = static_cast<size_t>(c_stride) * chroma_height;
+
+    item->buffer = TakeBuffer();
+    item->buffer.resize(y_size + 2 * c_size + kPlaneAlignment);
+
+    // Start the planes on an aligned address inside the buffer
+    uint8_t* base = item->buffer.data();
+    base += (kPlaneAlignment - reinterpret_cast<uintptr_t>(base) % kPlaneAlignment) %
+            kPlaneAlignment;
+
+    planes[0] = base;
+    planes[1] = base + y_size;
+    planes[2] = base + y_size + c_size;
+    const int strides[3] = {y_stride, c_stride, c_stride};
+    for (int i = 0; i < 3; i++) {
+      view.data[i] = planes[i];
+      view.stride[i] = strides[i];
+    }
+  }
+
+  std::vector<uint8_t> TakeBuffer() {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (free_buffers_.empty()) {
+      return std::vector<uint8_t>();
+    }
+    std::vector<uint8_t> buffer = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+    return buffer;
+  }
+
+  void RecycleBuffer(std::vector<uint8_t> buffer) {
+    if (buffer.capacity() == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (free_buffers_.size() < async_config_.queue_depth) {
+      free_buffers_.push_back(std::move(buffer));
+    }
+  }
+
+  void Deliver(std::vector<EncodedPacket>* packets) {
+    if (packets->empty()) {
+      return;
+    }
+
+    // The callback runs unlocked, so it may poll or set a new callback
+    // without deadlocking, and PollPackets() callers never wait on it
+    PacketCallback callback;
+    {
+      std::lock_guard<std::mutex> lock(output_mutex_);
+      if (!callback_) {
+        output_.insert(output_.end(), packets->begin(), packets->end());
+        packets->clear();
+        return;
+      }
+      callback = callback_;
+    }
+    callback(*packets);
+    packets->clear();
+  }
+
+  std::unique_ptr<VideoEncoder> encoder_;
+  AsyncEncoderConfig async_config_;
+
+  // Stage hand-off
+  WorkQueue copy_queue_;
+  WorkQueue encode_queue_;
+  std::thread copy_thread_;
+  std::thread encode_thread_;
+
+  // Backpressure
+  mutable std::mutex slot_mutex_;
+  std::condition_variable slot_cond_;
+  size_t in_flight_ = 0;
+  std::atomic<uint64_t> dropped_frames_{0};
+  std::atomic<uint64_t> failed_frames_{0};
+
+  // Reusable copy-stage buffers
+  std::mutex pool_mutex_;
+  std::vector<std::vector<uint8_t>> free_buffers_;
+
+  // Output
+  std::mutex output_mutex_;
+  PacketCallback callback_;
+  std::vector<EncodedPacket> output_;
+};
+
+}  // namespace
+
+std::unique_ptr<AsyncVideoEncoder> AsyncVideoEncoder::Create(
+    const VideoEncoderConfig& config,
+    const AsyncEncoderConfig& async_config) {
+  std::unique_ptr<VideoEncoder> encoder = VideoEncoder::Create(config);
+  if (!encoder) {
+    return nullptr;
+  }
+
+  return std::unique_ptr<AsyncVideoEncoder>(
+      new AsyncVideoEncoderImpl(std::move(encoder), async_config));
+}
+
+} // namespace media
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef MEDIA_ASYNC_ENCODER_H_
+#define MEDIA_ASYNC_ENCODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "media_encoded_packet.h"
+#include "media_video_encoder.h"
+#include "media_video_frame.h"
+
+namespace media {
+
+// Pipeline options for AsyncVideoEncoder
+struct AsyncEncoderConfig {
+  // Maximum number of frames submitted but not yet encoded
+  size_t queue_depth = 4;
+
+  // When the pipeline is full, SubmitFrame() blocks if true and drops the
+  // frame (returning false) if false
+  bool block_when_full = true;
+};
+
+// Runs a VideoEncoder on a two-stage pipeline: a copy stage that moves the
+// caller's planes into pooled, encoder-aligned buffers, and an encode stage
+// that feeds them to the codec. SubmitFrame() returns as soon as the frame is
+// queued; packets are delivered through a callback or PollPackets().
+class AsyncVideoEncoder {
+ public:
+  // Called on the encode thread with the packets produced for one frame
+  using PacketCallback = std::function<void(const std::vector<EncodedPacket>& packets)>;
+
+  // Called on the copy thread once the planes of a submitted view have been
+  // copied and the caller may reuse them
+  using ReleaseCallback = std::function<void()>;
+
+  // Factory method to create an async encoder instance
+  static std::unique_ptr<AsyncVideoEncoder> Create(const VideoEncoderConfig& config,
+                                                   const AsyncEncoderConfig& async_config);
+
+  // Stops both stages after the queued frames have been encoded
+  virtual ~AsyncVideoEncoder() = default;
+
+  // Deliver packets to |callback| instead of the poll queue. Must be set
+  // before the first SubmitFrame() call.
+  virtual void SetPacketCallback(PacketCallback callback) = 0;
+
+  // Queue a frame given as plane pointers and strides. The planes must stay
+  // valid until |on_released| runs; it may be empty if the caller waits on
+  // Flush() instead.
+  virtual bool SubmitFrame(const VideoFrameView& frame, ReleaseCallback on_released) = 0;
+
+  // Queue a tightly packed YUV420 frame, taking ownership of the buffer.
+  // With a YUV420P10 input_format it holds 16-bit planar samples; with P010
+  // it holds the P010 layout (Y, then interleaved UV), unpacked before encoding.
+  virtual bool SubmitFrame(std::vector<uint8_t>&& yuv_data, int64_t pts = -1) = 0;
+
+  // Move all packets produced so far into |packets| without blocking.
+  // Returns false if nothing was ready.
+  virtual bool PollPackets(std::vector<EncodedPacket>* packets) = 0;
+
+  // Wait until every submitted frame is encoded, then drain the encoder.
+  // Remaining packets go to the callback or the poll queue.
+  virtual bool Flush() = 0;
+
+  // Number of frames submitted but not yet encoded
+  virtual size_t GetQueueDepth() const = 0;
+
+  // Number of frames rejected because the pipeline was full
+  virtual uint64_t GetDroppedFrames() const = 0;
+
+  // Number of frames the encoder failed to encode; no packets were
+  // delivered for them
+  virtual uint64_t GetFailedFrames() const = 0;
+};
+
+} // namespace media
+
+#endif  // MEDIA_ASYNC_ENCODER_H_
\ No newline at end of file
@@ -0,0 +1,718 @@
+#include "media_color_convert.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MEDIA_COLOR_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit SSE4.1/AVX2 instructions inside functions marked
+// for them, which keeps the rest of the library buildable for baseline x86.
+#if defined(MEDIA_COLOR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MEDIA_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define MEDIA_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MEDIA_TARGET_SSE41
+#define MEDIA_TARGET_AVX2
+#endif
+
+namespace media {
+namespace color {
+
+namespace {
+
+constexpr int kLumaShift = 14;
+constexpr int kChromaShift = kLumaShift + 2;
+
+// Byte offsets of the components within one pixel
+struct Layout {
+  int r;
+  int g;
+  int b;
+  int bpp;
+};
+
+template <PackedFormat F>
+struct LayoutOf;
+
+template <>
+struct LayoutOf<PackedFormat::kRGB24> {
+  static constexpr Layout value = {0, 1, 2, 3};
+};
+
+template <>
+struct LayoutOf<PackedFormat::kRGBA> {
+  static constexpr Layout value = {0, 1, 2, 4};
+};
+
+template <>
+struct LayoutOf<PackedFormat::kBGRA> {
+  static constexpr Layout value = {2, 1, 0, 4};
+};
+
+template <>
+struct LayoutOf<PackedFormat::kBGR24> {
+  static constexpr Layout value = {2, 1, 0, 3};
+};
+
+constexpr Layout LayoutOf<PackedFormat::kRGB24>::value;
+constexpr Layout LayoutOf<PackedFormat::kRGBA>::value;
+constexpr Layout LayoutOf<PackedFormat::kBGRA>::value;
+constexpr Layout LayoutOf<PackedFormat::kBGR24>::value;
+
+inline uint8_t Clamp255(int32_t value) {
+  return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Converts a pair of source rows starting at pixel |x| (even). |y1| is null
+// when the pair is the last, unpaired row of an odd-height image; |v| is null
+// for NV12, where |u| is the interleaved UV row.
+using RowsFn = void (*)(const uint8_t* row0, const uint8_t* row1, int width,
+                        uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                        const Coefficients& c);
+
+template <PackedFormat F, bool kNV12>
+void ScalarRows(const uint8_t* row0, const uint8_t* row1, int x, int width,
+                uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                const Coefficients& c) {
+  constexpr Layout l = LayoutOf<F>::value;
+  auto luma = [&](const uint8_t* p) {
+    return Clamp255((c.yr * p[l.r] + c.yg * p[l.g] + c.yb * p[l.b] + c.y_bias) >> kLumaShift);
+  };
+
+  for (; x < width; x += 2) {
+    const bool pair = x + 1 < width;
+    const uint8_t* p00 = row0 + x * l.bpp;
+    const uint8_t* p01 = pair ? p00 + l.bpp : p00;
+    const uint8_t* p10 = row1 + x * l.bpp;
+    const uint8_t* p11 = pair ? p10 + l.bpp : p10;
+
+    y0[x] = luma(p00);
+    if (pair) y0[x + 1] = luma(p01);
+    if (y1) {
+      y1[x] = luma(p10);
+      if (pair) y1[x + 1] = luma(p11);
+    }
+
+    const int32_t r = p00[l.r] + p01[l.r] + p10[l.r] + p11[l.r];
+    const int32_t g = p00[l.g] + p01[l.g] + p10[l.g] + p11[l.g];
+    const int32_t b = p00[l.b] + p01[l.b] + p10[l.b] + p11[l.b];
+    const uint8_t cu = Clamp255((c.ur * r + c.ug * g + c.ub * b + c.c_bias) >> kChromaShift);
+    const uint8_t cv = Clamp255((c.vr * r + c.vg * g + c.vb * b + c.c_bias) >> kChromaShift);
+    if (kNV12) {
+      u[x] = cu;
+      u[x + 1] = cv;
+    } else {
+      u[x / 2] = cu;
+      v[x / 2] = cv;
+    }
+  }
+}
+
+// Splits |width| interleaved UV pairs of one row into separate U and V rows
+using SplitRowFn = void (*)(const uint8_t* uv, int width, uint8_t* u, uint8_t* v);
+
+void SplitUVScalar(const uint8_t* uv, int width, uint8_t* u, uint8_t* v) {
+  for (int x = 0; x < width; x++) {
+    u[x] = uv[2 * x];
+    v[x] = uv[2 * x + 1];
+  }
+}
+
+// Interleaves |width| samples of one U row and one V row into a UV row
+using MergeRowFn = void (*)(const uint8_t* u, const uint8_t* v, int width, uint8_t* uv);
+
+void MergeUVScalar(const uint8_t* u, const uint8_t* v, int width, uint8_t* uv) {
+  for (int x = 0; x < width; x++) {
+    uv[2 * x] = u[x];
+    uv[2 * x + 1] = v[x];
+  }
+}
+
+template <PackedFormat F, bool kNV12>
+void ScalarKernel(const uint8_t* row0, const uint8_t* row1, int width,
+                  uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                  const Coefficients& c) {
+  ScalarRows<F, kNV12>(row0, row1, 0, width, y0, y1, u, v, c);
+}
+
+#if defined(MEDIA_COLOR_X86)
+
+// The SIMD kernels work on 32-bit lanes, one pixel each, laid out as
+// (R | G << 16) and (B) so that pmaddwd applies two weights at once. Four
+// pixels are gathered from any 16 bytes with pshufb, so the same masks serve
+// all three packed layouts. The arithmetic matches ScalarRows exactly.
+
+inline int32_t PackWeights(int32_t low, int32_t high) {
+  return static_cast<int32_t>((static_cast<uint32_t>(low) & 0xFFFF) |
+                              (static_cast<uint32_t>(high) << 16));
+}
+
+template <PackedFormat F>
+MEDIA_TARGET_SSE41 inline __m128i RedGreenMask() {
+  constexpr Layout l = LayoutOf<F>::value;
+  return _mm_setr_epi8(l.r, -1, l.g, -1,
+                       l.r + l.bpp, -1, l.g + l.bpp, -1,
+                       l.r + 2 * l.bpp, -1, l.g + 2 * l.bpp, -1,
+                       l.r + 3 * l.bpp, -1, l.g + 3 * l.bpp, -1);
+}
+
+template <PackedFormat F>
+MEDIA_TARGET_SSE41 inline __m128i BlueMask() {
+  constexpr Layout l = LayoutOf<F>::value;
+  return _mm_setr_epi8(l.b, -1, -1, -1,
+                       l.b + l.bpp, -1, -1, -1,
+                       l.b + 2 * l.bpp, -1, -1, -1,
+                       l.b + 3 * l.bpp, -1, -1, -1);
+}
+
+MEDIA_TARGET_SSE41 inline __m128i Weigh128(__m128i rg, __m128i b, __m128i w_rg,
+                                           __m128i w_b, __m128i bias, int shift) {
+  __m128i sum = _mm_add_epi32(_mm_madd_epi16(rg, w_rg), _mm_madd_epi16(b, w_b));
+  return _mm_sra_epi32(_mm_add_epi32(sum, bias), _mm_cvtsi32_si128(shift));
+}
+
+template <PackedFormat F, bool kNV12>
+MEDIA_TARGET_SSE41 void Sse41Kernel(const uint8_t* row0, const uint8_t* row1, int width,
+                                    uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                    const Coefficients& c) {
+  constexpr Layout l = LayoutOf<F>::value;
+  const __m128i rg_mask = RedGreenMask<F>();
+  const __m128i b_mask = BlueMask<F>();
+  const __m128i y_rg = _mm_set1_epi32(PackWeights(c.yr, c.yg));
+  const __m128i y_b = _mm_set1_epi32(PackWeights(c.yb, 0));
+  const __m128i u_rg = _mm_set1_epi32(PackWeights(c.ur, c.ug));
+  const __m128i u_b = _mm_set1_epi32(PackWeights(c.ub, 0));
+  const __m128i v_rg = _mm_set1_epi32(PackWeights(c.vr, c.vg));
+  const __m128i v_b = _mm_set1_epi32(PackWeights(c.vb, 0));
+  const __m128i y_bias = _mm_set1_epi32(c.y_bias);
+  const __m128i c_bias = _mm_set1_epi32(c.c_bias);
+
+  // 16 pixels per step; the last 16-byte load must stay inside the row
+  int x = 0;
+  for (; x + 16 <= width && (x + 12) * l.bpp + 16 <= width * l.bpp; x += 16) {
+    __m128i rg0[4], b0[4], rg1[4], b1[4];
+    for (int k = 0; k < 4; k++) {
+      const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + (x + 4 * k) * l.bpp));
+      const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + (x + 4 * k) * l.bpp));
+      rg0[k] = _mm_shuffle_epi8(p0, rg_mask);
+      b0[k] = _mm_shuffle_epi8(p0, b_mask);
+      rg1[k] = _mm_shuffle_epi8(p1, rg_mask);
+      b1[k] = _mm_shuffle_epi8(p1, b_mask);
+    }
+
+    __m128i luma[4];
+    for (int k = 0; k < 4; k++) {
+      luma[k] = Weigh128(rg0[k], b0[k], y_rg, y_b, y_bias, kLumaShift);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y0 + x),
+                     _mm_packus_epi16(_mm_packs_epi32(luma[0], luma[1]),
+                                      _mm_packs_epi32(luma[2], luma[3])));
+    if (y1) {
+      for (int k = 0; k < 4; k++) {
+        luma[k] = Weigh128(rg1[k], b1[k], y_rg, y_b, y_bias, kLumaShift);
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(y1 + x),
+                       _mm_packus_epi16(_mm_packs_epi32(luma[0], luma[1]),
+                                        _mm_packs_epi32(luma[2], luma[3])));
+    }
+
+    // 2x2 sums: add the rows, then adjacent pixels. Each 16-bit half stays
+    // below 1024, so the 32-bit adds never carry between R and G.
+    __m128i rg_sum[2], b_sum[2];
+    for (int k = 0; k < 2; k++) {
+      rg_sum[k] = _mm_hadd_epi32(_mm_add_epi32(rg0[2 * k], rg1[2 * k]),
+                                 _mm_add_epi32(rg0[2 * k + 1], rg1[2 * k + 1]));
+      b_sum[k] = _mm_hadd_epi32(_mm_add_epi32(b0[2 * k], b1[2 * k]),
+                                _mm_add_epi32(b0[2 * k + 1], b1[2 * k + 1]));
+    }
+    const __m128i cu = _mm_packs_epi32(
+        Weigh128(rg_sum[0], b_sum[0], u_rg, u_b, c_bias, kChromaShift),
+        Weigh128(rg_sum[1], b_sum[1], u_rg, u_b, c_bias, kChromaShift));
+    const __m128i cv = _mm_packs_epi32(
+        Weigh128(rg_sum[0], b_sum[0], v_rg, v_b, c_bias, kChromaShift),
+        Weigh128(rg_sum[1], b_sum[1], v_rg, v_b, c_bias, kChromaShift));
+    const __m128i chroma = _mm_packus_epi16(cu, cv);  // 8 U then 8 V
+    if (kNV12) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(u + x),
+                       _mm_unpacklo_epi8(chroma, _mm_srli_si128(chroma, 8)));
+    } else {
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x / 2), chroma);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(v + x / 2), _mm_srli_si128(chroma, 8));
+    }
+  }
+
+  ScalarRows<F, kNV12>(row0, row1, x, width, y0, y1, u, v, c);
+}
+
+MEDIA_TARGET_AVX2 inline __m256i Load8Pixels(const uint8_t* p, int bpp) {
+  // Four pixels per 128-bit lane so the pshufb masks stay lane-local
+  return _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4 * bpp)), 1);
+}
+
+MEDIA_TARGET_AVX2 inline __m256i Weigh256(__m256i rg, __m256i b, __m256i w_rg,
+                                          __m256i w_b, __m256i bias, int shift) {
+  __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(rg, w_rg), _mm256_madd_epi16(b, w_b));
+  return _mm256_sra_epi32(_mm256_add_epi32(sum, bias), _mm_cvtsi32_si128(shift));
+}
+
+template <PackedFormat F, bool kNV12>
+MEDIA_TARGET_AVX2 void Avx2Kernel(const uint8_t* row0, const uint8_t* row1, int width,
+                                  uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                  const Coefficients& c) {
+  constexpr Layout l = LayoutOf<F>::value;
+  const __m256i rg_mask = _mm256_broadcastsi128_si256(RedGreenMask<F>());
+  const __m256i b_mask = _mm256_broadcastsi128_si256(BlueMask<F>());
+  const __m256i y_rg = _mm256_set1_epi32(PackWeights(c.yr, c.yg));
+  const __m256i y_b = _mm256_set1_epi32(PackWeights(c.yb, 0));
+  const __m256i u_rg = _mm256_set1_epi32(PackWeights(c.ur, c.ug));
+  const __m256i u_b = _mm256_set1_epi32(PackWeights(c.ub, 0));
+  const __m256i v_rg = _mm256_set1_epi32(PackWeights(c.vr, c.vg));
+  const __m256i v_b = _mm256_set1_epi32(PackWeights(c.vb, 0));
+  const __m256i y_bias = _mm256_set1_epi32(c.y_bias);
+  const __m256i c_bias = _mm256_set1_epi32(c.c_bias);
+  // Packs work per 128-bit lane; this restores pixel order afterwards
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+  // 32 pixels per step; the last 16-byte load must stay inside the row
+  int x = 0;
+  for (; x + 32 <= width && (x + 28) * l.bpp + 16 <= width * l.bpp; x += 32) {
+    __m256i rg0[4], b0[4], rg1[4], b1[4];
+    for (int k = 0; k < 4; k++) {
+      const __m256i p0 = Load8Pixels(row0 + (x + 8 * k) * l.bpp, l.bpp);
+      const __m256i p1 = Load8Pixels(row1 + (x + 8 * k) * l.bpp, l.bpp);
+      rg0[k] = _mm256_shuffle_epi8(p0, rg_mask);
+      b0[k] = _mm256_shuffle_epi8(p0, b_mask);
+      rg1[k] = _mm256_shuffle_epi8(p1, rg_mask);
+      b1[k] = _mm256_shuffle_epi8(p1, b_mask);
+    }
+
+    __m256i luma[4];
+    for (int k = 0; k < 4; k++) {
+      luma[k] = Weigh256(rg0[k], b0[k], y_rg, y_b, y_bias, kLumaShift);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(y0 + x),
+                        _mm256_permutevar8x32_epi32(
+                            _mm256_packus_epi16(_mm256_packs_epi32(luma[0], luma[1]),
+                                                _mm256_packs_epi32(luma[2], luma[3])),
+                            order));
+    if (y1) {
+      for (int k = 0; k < 4; k++) {
+        luma[k] = Weigh256(rg1[k], b1[k], y_rg, y_b, y_bias, kLumaShift);
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(y1 + x),
+                          _mm256_permutevar8x32_epi32(
+                              _mm256_packus_epi16(_mm256_packs_epi32(luma[0], luma[1]),
+                                                  _mm256_packs_epi32(luma[2], luma[3])),
+                              order));
+    }
+
+    __m256i rg_sum[2], b_sum[2];
+    for (int k = 0; k < 2; k++) {
+      rg_sum[k] = _mm256_hadd_epi32(_mm256_add_epi32(rg0[2 * k], rg1[2 * k]),
+                                    _mm256_add_epi32(rg0[2 * k + 1], rg1[2 * k + 1]));
+      b_sum[k] = _mm256_hadd_epi32(_mm256_add_epi32(b0[2 * k], b1[2 * k]),
+                                   _mm256_add_epi32(b0[2 * k + 1], b1[2 * k + 1]));
+    }
+    const __m256i cu = _mm256_permutevar8x32_epi32(_mm256_packs_epi32(
+        Weigh256(rg_sum[0], b_sum[0], u_rg, u_b, c_bias, kChromaShift),
+        Weigh256(rg_sum[1], b_sum[1], u_rg, u_b, c_bias, kChromaShift)), order);
+    const __m256i cv = _mm256_permutevar8x32_epi32(_mm256_packs_epi32(
+        Weigh256(rg_sum[0], b_sum[0], v_rg, v_b, c_bias, kChromaShift),
+        Weigh256(rg_sum[1], b_sum[1], v_rg, v_b, c_bias, kChromaShift)), order);
+    // 16 U in the low half, 16 V in the high half
+    const __m256i chroma = _mm256_permute4x64_epi64(_mm256_packus_epi16(cu, cv), 0xD8);
+    const __m128i chroma_u = _mm256_castsi256_si128(chroma);
+    const __m128i chroma_v = _mm256_extracti128_si256(chroma, 1);
+    if (kNV12) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(u + x), _mm_unpacklo_epi8(chroma_u, chroma_v));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(u + x + 16), _mm_unpackhi_epi8(chroma_u, chroma_v));
+    } else {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(u + x / 2), chroma_u);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(v + x / 2), chroma_v);
+    }
+  }
+
+  ScalarRows<F, kNV12>(row0, row1, x, width, y0, y1, u, v, c);
+}
+
+// 16 pairs per step: even bytes are U, odd bytes V
+MEDIA_TARGET_SSE41 void SplitUVSse41(const uint8_t* uv, int width, uint8_t* u, uint8_t* v) {
+  const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + 2 * x));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + 2 * x + 16));
+    const __m128i us = _mm_packus_epi16(_mm_and_si128(a, low_bytes), _mm_and_si128(b, low_bytes));
+    const __m128i vs = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(u + x), us);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(v + x), vs);
+  }
+  SplitUVScalar(uv + 2 * x, width - x, u + x, v + x);
+}
+
+// 32 pairs per step; packus works per 128-bit lane, so the quadwords are
+// put back in order afterwards
+MEDIA_TARGET_AVX2 void SplitUVAvx2(const uint8_t* uv, int width, uint8_t* u, uint8_t* v) {
+  const __m256i low_bytes = _mm256_set1_epi16(0x00FF);
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + 2 * x));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + 2 * x + 32));
+    const __m256i us = _mm256_packus_epi16(_mm256_and_si256(a, low_bytes),
+                                           _mm256_and_si256(b, low_bytes));
+    const __m256i vs = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(u + x), _mm256_permute4x64_epi64(us, 0xD8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(v + x), _mm256_permute4x64_epi64(vs, 0xD8));
+  }
+  SplitUVSse41(uv + 2 * x, width - x, u + x, v + x);
+}
+
+// 16 pairs per step
+MEDIA_TARGET_SSE41 void MergeUVSse41(const uint8_t* u, const uint8_t* v, int width, uint8_t* uv) {
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const __m128i us = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + x));
+    const __m128i vs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + x));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * x), _mm_unpacklo_epi8(us, vs));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * x + 16), _mm_unpackhi_epi8(us, vs));
+  }
+  MergeUVScalar(u + x, v + x, width - x, uv + 2 * x);
+}
+
+// 32 pairs per step; unpack works per 128-bit lane, so the quadwords are
+// spread out first to come back in order
+MEDIA_TARGET_AVX2 void MergeUVAvx2(const uint8_t* u, const uint8_t* v, int width, uint8_t* uv) {
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    const __m256i us = _mm256_permute4x64_epi64(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + x)), 0xD8);
+    const __m256i vs = _mm256_permute4x64_epi64(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + x)), 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + 2 * x), _mm256_unpacklo_epi8(us, vs));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + 2 * x + 32), _mm256_unpackhi_epi8(us, vs));
+  }
+  MergeUVSse41(u + x, v + x, width - x, uv + 2 * x);
+}
+
+#endif  // MEDIA_COLOR_X86
+
+enum class CpuLevel {
+  kScalar,
+  kSse41,
+  kAvx2
+};
+
+CpuLevel DetectCpuLevel() {
+#if defined(MEDIA_COLOR_X86)
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  const int max_leaf = info[0];
+  __cpuid(info, 1);
+  const bool sse41 = (info[2] >> 19) & 1;
+  const bool os_saves_ymm = ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1) &&
+                            (_xgetbv(0) & 6) == 6;
+  bool avx2 = false;
+  if (max_leaf >= 7 && os_saves_ymm) {
+    __cpuidex(info, 7, 0);
+    avx2 = (info[1] >> 5) & 1;
+  }
+#else
+  __builtin_cpu_init();
+  const bool sse41 = __builtin_cpu_supports("sse4.1");
+  const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+  if (avx2) return CpuLevel::kAvx2;
+  if (sse41) return CpuLevel::kSse41;
+#endif
+  return CpuLevel::kScalar;
+}
+
+// Row kernels indexed by PackedFormat
+struct KernelTable {
+  const char* name;
+  RowsFn i420[4];
+  RowsFn nv12[4];
+  SplitRowFn split_uv;
+  MergeRowFn merge_uv;
+};
+
+#define MEDIA_KERNEL_ROW(kernel, nv12)                 \
+  {kernel<PackedFormat::kRGB24, nv12>,                 \
+   kernel<PackedFormat::kRGBA, nv12>,                  \
+   kernel<PackedFormat::kBGRA, nv12>,                  \
+   kernel<PackedFormat::kBGR24, nv12>}
+
+KernelTable MakeKernelTable(CpuLevel level) {
+  switch (level) {
+#if defined(MEDIA_COLOR_X86)
+    case CpuLevel::kAvx2:
+      return {"avx2", MEDIA_KERNEL_ROW(Avx2Kernel, false), MEDIA_KERNEL_ROW(Avx2Kernel, true),
+              SplitUVAvx2, MergeUVAvx2};
+    case CpuLevel::kSse41:
+      return {"sse4.1", MEDIA_KERNEL_ROW(Sse41Kernel, false), MEDIA_KERNEL_ROW(Sse41Kernel, true),
+              SplitUVSse41, MergeUVSse41};
+#endif
+    default:
+      return {"scalar", MEDIA_KERNEL_ROW(ScalarKernel, false), MEDIA_KERNEL_ROW(ScalarKernel, true),
+              SplitUVScalar, MergeUVScalar};
+  }
+}
+
+#undef MEDIA_KERNEL_ROW
+
+const KernelTable& Kernels() {
+  static const KernelTable table = MakeKernelTable(DetectCpuLevel());
+  return table;
+}
+
+void ConvertRows(RowsFn rows,
+                 const uint8_t* src, int src_stride,
+                 int width, int height,
+                 uint8_t* dst_y, int dst_stride_y,
+                 uint8_t* dst_u, int dst_stride_u,
+                 uint8_t* dst_v, int dst_stride_v,
+                 const Coefficients& coefficients) {
+  for (int row = 0; row < height; row += 2) {
+    const bool pair = row + 1 < height;
+    const uint8_t* row0 = src + static_cast<ptrdiff_t>(row) * src_stride;
+    const uint8_t* row1 = pair ? row0 + src_stride : row0;
+    uint8_t* y0 = dst_y + static_cast<ptrdiff_t>(row) * dst_stride_y;
+    uint8_t* y1 = pair ? y0 + dst_stride_y : nullptr;
+    uint8_t* u = dst_u + static_cast<ptrdiff_t>(row / 2) * dst_stride_u;
+    uint8_t* v = dst_v ? dst_v + static_cast<ptrdiff_t>(row / 2) * dst_stride_v : nullptr;
+    rows(row0, row1, width, y0, y1, u, v, coefficients);
+  }
+}
+
+
+// 10-bit sample stored in the top of a little-endian 16-bit word, rounded
+// to 8 bits
+inline uint8_t P010To8(const uint8_t* p) {
+  const int value = (p[0] | (p[1] << 8)) + 0x80;
+  return static_cast<uint8_t>(value > 0xFFFF ? 255 : value >> 8);
+}
+
+// Moves a P010 sample from the top to the bottom 10 bits of its word
+inline void P010ToLow10(const uint8_t* src, uint8_t* dst) {
+  const int value = (src[0] | (src[1] << 8)) >> 6;
+  dst[0] = static_cast<uint8_t>(value & 0xFF);
+  dst[1] = static_cast<uint8_t>(value >> 8);
+}
+
+inline void StoreChroma(uint8_t* u, uint8_t* v, int x, uint8_t cu, uint8_t cv) {
+  if (v) {
+    u[x] = cu;
+    v[x] = cv;
+  } else {
+    u[2 * x] = cu;
+    u[2 * x + 1] = cv;
+  }
+}
+
+// Writes the luma of one source row
+void RepackLumaRow(YUVFormat format, const uint8_t* src, int width, uint8_t* y) {
+  switch (format) {
+    case YUVFormat::kYUYV:
+      for (int x = 0; x < width; x++) y[x] = src[2 * x];
+      break;
+    case YUVFormat::kUYVY:
+      for (int x = 0; x < width; x++) y[x] = src[2 * x + 1];
+      break;
+    case YUVFormat::kP010:
+      for (int x = 0; x < width; x++) y[x] = P010To8(src + 2 * x);
+      break;
+    default:
+      std::memcpy(y, src, width);
+      break;
+  }
+}
+
+}  // namespace
+
+Coefficients MakeCoefficients(ColorMatrix matrix, ColorRange range) {
+  const double kr = matrix == ColorMatrix::BT709 ? 0.2126 : 0.299;
+  const double kb = matrix == ColorMatrix::BT709 ? 0.0722 : 0.114;
+  const bool full = range == ColorRange::FULL;
+  const double y_scale = (full ? 255.0 : 219.0) / 255.0;
+  const double c_scale = (full ? 255.0 : 224.0) / 255.0;
+  const double one = 1 << kLumaShift;
+
+  // Each row is rounded so luma weights sum to the scale and chroma weights
+  // to zero; grey input then maps to exactly neutral chroma.
+  Coefficients c;
+  c.yr = static_cast<int32_t>(std::lround(kr * y_scale * one));
+  c.yb = static_cast<int32_t>(std::lround(kb * y_scale * one));
+  c.yg = static_cast<int32_t>(std::lround(y_scale * one)) - c.yr - c.yb;
+
+  // Cb = (B - Y) / (2 (1 - kb)), Cr = (R - Y) / (2 (1 - kr))
+  c.ub = static_cast<int32_t>(std::lround(0.5 * c_scale * one));
+  c.ur = static_cast<int32_t>(std::lround(-0.5 * c_scale * kr / (1.0 - kb) * one));
+  c.ug = -c.ub - c.ur;
+  c.vr = static_cast<int32_t>(std::lround(0.5 * c_scale * one));
+  c.vb = static_cast<int32_t>(std::lround(-0.5 * c_scale * kb / (1.0 - kr) * one));
+  c.vg = -c.vr - c.vb;
+
+  c.y_bias = ((full ? 0 : 16) << kLumaShift) + (1 << (kLumaShift - 1));
+  c.c_bias = (128 << kChromaShift) + (1 << (kChromaShift - 1));
+  return c;
+}
+
+void PackedToI420(PackedFormat format,
+                  const uint8_t* src, int src_stride,
+                  int width, int height,
+                  uint8_t* dst_y, int dst_stride_y,
+                  uint8_t* dst_u, int dst_stride_u,
+                  uint8_t* dst_v, int dst_stride_v,
+                  const Coefficients& coefficients) {
+  ConvertRows(Kernels().i420[static_cast<int>(format)], src, src_stride, width, height,
+              dst_y, dst_stride_y, dst_u, dst_stride_u, dst_v, dst_stride_v, coefficients);
+}
+
+void PackedToNV12(PackedFormat format,
+                  const uint8_t* src, int src_stride,
+                  int width, int height,
+                  uint8_t* dst_y, int dst_stride_y,
+                  uint8_t* dst_uv, int dst_stride_uv,
+                  const Coefficients& coefficients) {
+  ConvertRows(Kernels().nv12[static_cast<int>(format)], src, src_stride, width, height,
+              dst_y, dst_stride_y, dst_uv, dst_stride_uv, nullptr, 0, coefficients);
+}
+
+void RepackYUV(YUVFormat format,
+               const uint8_t* const src[3], const int src_stride[3],
+               int width, int height,
+               uint8_t* dst_y, int dst_stride_y,
+               uint8_t* dst_u, int dst_stride_u,
+               uint8_t* dst_v, int dst_stride_v) {
+  const int chroma_width = (width + 1) / 2;
+  for (int row = 0; row < height; row += 2) {
+    const int next = row + 1 < height ? row + 1 : row;
+    uint8_t* u = dst_u + static_cast<ptrdiff_t>(row / 2) * dst_stride_u;
+    uint8_t* v = dst_v ? dst_v + static_cast<ptrdiff_t>(row / 2) * dst_stride_v : nullptr;
+
+    const uint8_t* y0 = src[0] + static_cast<ptrdiff_t>(row) * src_stride[0];
+    const uint8_t* y1 = src[0] + static_cast<ptrdiff_t>(next) * src_stride[0];
+    RepackLumaRow(format, y0, width, dst_y + static_cast<ptrdiff_t>(row) * dst_stride_y);
+    if (next != row) {
+      RepackLumaRow(format, y1, width, dst_y + static_cast<ptrdiff_t>(next) * dst_stride_y);
+    }
+
+    switch (format) {
+      case YUVFormat::kYUYV:
+      case YUVFormat::kUYVY: {
+        // Chroma sits in every macropixel of both rows; average vertically
+        const int u_offset = format == YUVFormat::kYUYV ? 1 : 0;
+        for (int x = 0; x < chroma_width; x++) {
+          const uint8_t* p0 = y0 + 4 * x + u_offset;
+          const uint8_t* p1 = y1 + 4 * x + u_offset;
+          StoreChroma(u, v, x,
+                      static_cast<uint8_t>((p0[0] + p1[0] + 1) >> 1),
+                      static_cast<uint8_t>((p0[2] + p1[2] + 1) >> 1));
+        }
+        break;
+      }
+      case YUVFormat::kI422: {
+        const uint8_t* u0 = src[1] + static_cast<ptrdiff_t>(row) * src_stride[1];
+        const uint8_t* u1 = src[1] + static_cast<ptrdiff_t>(next) * src_stride[1];
+        const uint8_t* v0 = src[2] + static_cast<ptrdiff_t>(row) * src_stride[2];
+        const uint8_t* v1 = src[2] + static_cast<ptrdiff_t>(next) * src_stride[2];
+        for (int x = 0; x < chroma_width; x++) {
+          StoreChroma(u, v, x,
+                      static_cast<uint8_t>((u0[x] + u1[x] + 1) >> 1),
+                      static_cast<uint8_t>((v0[x] + v1[x] + 1) >> 1));
+        }
+        break;
+      }
+      case YUVFormat::kI444: {
+        const uint8_t* u0 = src[1] + static_cast<ptrdiff_t>(row) * src_stride[1];
+        const uint8_t* u1 = src[1] + static_cast<ptrdiff_t>(next) * src_stride[1];
+        const uint8_t* v0 = src[2] + static_cast<ptrdiff_t>(row) * src_stride[2];
+        const uint8_t* v1 = src[2] + static_cast<ptrdiff_t>(next) * src_stride[2];
+        for (int x = 0; x < chroma_width; x++) {
+          const int a = 2 * x;
+          const int b = a + 1 < width ? a + 1 : a;
+          StoreChroma(u, v, x,
+                      static_cast<uint8_t>((u0[a] + u0[b] + u1[a] + u1[b] + 2) >> 2),
+                      static_cast<uint8_t>((v0[a] + v0[b] + v1[a] + v1[b] + 2) >> 2));
+        }
+        break;
+      }
+      case YUVFormat::kP010: {
+        // Already 4:2:0; only the sample size changes
+        const uint8_t* uv = src[1] + static_cast<ptrdiff_t>(row / 2) * src_stride[1];
+        for (int x = 0; x < chroma_width; x++) {
+          StoreChroma(u, v, x, P010To8(uv + 4 * x), P010To8(uv + 4 * x + 2));
+        }
+        break;
+      }
+    }
+  }
+}
+
+void SplitUV(const uint8_t* src_uv, int src_stride_uv,
+             int width, int height,
+             uint8_t* dst_u, int dst_stride_u,
+             uint8_t* dst_v, int dst_stride_v) {
+  const SplitRowFn split = Kernels().split_uv;
+  for (int row = 0; row < height; row++) {
+    split(src_uv + static_cast<ptrdiff_t>(row) * src_stride_uv, width,
+          dst_u + static_cast<ptrdiff_t>(row) * dst_stride_u,
+          dst_v + static_cast<ptrdiff_t>(row) * dst_stride_v);
+  }
+}
+
+void MergeUV(const uint8_t* src_u, int src_stride_u,
+             const uint8_t* src_v, int src_stride_v,
+             int width, int height,
+             uint8_t* dst_uv, int dst_stride_uv) {
+  const MergeRowFn merge = Kernels().merge_uv;
+  for (int row = 0; row < height; row++) {
+    merge(src_u + static_cast<ptrdiff_t>(row) * src_stride_u,
+          src_v + static_cast<ptrdiff_t>(row) * src_stride_v, width,
+          dst_uv + static_cast<ptrdiff_t>(row) * dst_stride_uv);
+  }
+}
+
+void P010ToYUV420P10(const uint8_t* src_y, int src_stride_y,
+                     const uint8_t* src_uv, int src_stride_uv,
+                     int width, int height,
+                     uint8_t* dst_y, int dst_stride_y,
+                     uint8_t* dst_u, int dst_stride_u,
+                     uint8_t* dst_v, int dst_stride_v) {
+  for (int row = 0; row < height; row++) {
+    const uint8_t* src = src_y + static_cast<ptrdiff_t>(row) * src_stride_y;
+    uint8_t* dst = dst_y + static_cast<ptrdiff_t>(row) * dst_stride_y;
+    for (int x = 0; x < width; x++) {
+      P010ToLow10(src + 2 * x, dst + 2 * x);
+    }
+  }
+
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  for (int row = 0; row < chroma_height; row++) {
+    const uint8_t* uv = src_uv + static_cast<ptrdiff_t>(row) * src_stride_uv;
+    uint8_t* u = dst_u + static_cast<ptrdiff_t>(row) * dst_stride_u;
+    uint8_t* v = dst_v + static_cast<ptrdiff_t>(row) * dst_stride_v;
+    for (int x = 0; x < chroma_width; x++) {
+      P010ToLow10(uv + 4 * x, u + 2 * x);
+      P010ToLow10(uv + 4 * x + 2, v + 2 * x);
+    }
+  }
+}
+
+const char* KernelName() {
+  return Kernels().name;
+}
+
+}  // namespace color
+}  // namespace media
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef MEDIA_COLOR_CONVERT_H_
+#define MEDIA_COLOR_CONVERT_H_
+
+#include <cstdint>
+
+#include "media_image_utils.h"
+
+namespace media {
+namespace color {
+
+// Byte order of a packed RGB pixel
+enum class PackedFormat {
+  kRGB24,  // R, G, B
+  kRGBA,   // R, G, B, A
+  kBGRA,   // B, G, R, A
+  kBGR24   // B, G, R
+};
+
+// YUV layouts that RepackYUV brings to 4:2:0
+enum class YUVFormat {
+  kYUYV,  // Packed 4:2:2: Y0 U Y1 V
+  kUYVY,  // Packed 4:2:2: U Y0 V Y1
+  kI422,  // Planar 4:2:2
+  kI444,  // Planar 4:4:4
+  kP010   // 4:2:0 Y and interleaved UV, 10 bits in the top of 16-bit LE words
+};
+
+// Fixed-point RGB to YUV weights. Luma uses 14 fractional bits; chroma is
+// computed from the sum of a 2x2 block, so it is shifted by two more.
+struct Coefficients {
+  int32_t yr, yg, yb;
+  int32_t ur, ug, ub;
+  int32_t vr, vg, vb;
+  int32_t y_bias;  // Offset and rounding for luma
+  int32_t c_bias;  // Offset and rounding for chroma
+};
+
+Coefficients MakeCoefficients(ColorMatrix matrix, ColorRange range);
+
+// Converts packed RGB rows into I420 planes. Chroma is the average of each
+// 2x2 block; odd widths and heights replicate the last column or row. The
+// SIMD kernels produce exactly the same bytes as the scalar code.
+void PackedToI420(PackedFormat format,
+                  const uint8_t* src, int src_stride,
+                  int width, int height,
+                  uint8_t* dst_y, int dst_stride_y,
+                  uint8_t* dst_u, int dst_stride_u,
+                  uint8_t* dst_v, int dst_stride_v,
+                  const Coefficients& coefficients);
+
+// Same as PackedToI420 with interleaved UV output
+void PackedToNV12(PackedFormat format,
+                  const uint8_t* src, int src_stride,
+                  int width, int height,
+                  uint8_t* dst_y, int dst_stride_y,
+                  uint8_t* dst_uv, int dst_stride_uv,
+                  const Coefficients& coefficients);
+
+// Converts YUV input to I420, or to NV12 when |dst_v| is null (|dst_u| is
+// then the UV plane). Chroma is averaged down to 4:2:0 with rounding and
+// P010 samples are rounded to 8 bits. Source planes follow the layout of
+// |format|; packed formats use plane 0 only.
+void RepackYUV(YUVFormat format,
+               const uint8_t* const src[3], const int src_stride[3],
+               int width, int height,
+               uint8_t* dst_y, int dst_stride_y,
+               uint8_t* dst_u, int dst_stride_u,
+               uint8_t* dst_v, int dst_stride_v);
+
+// Splits an interleaved UV plane of |width| x |height| pairs into U and V
+// planes, e.g. the chroma of NV12 into I420
+void SplitUV(const uint8_t* src_uv, int src_stride_uv,
+             int width, int height,
+             uint8_t* dst_u, int dst_stride_u,
+             uint8_t* dst_v, int dst_stride_v);
+
+// The reverse of SplitUV: interleaves U and V planes of |width| x |height|
+// samples into one UV plane, e.g. the chroma of I420 into NV12
+void MergeUV(const uint8_t* src_u, int src_stride_u,
+             const uint8_t* src_v, int src_stride_v,
+             int width, int height,
+             uint8_t* dst_uv, int dst_stride_uv);
+
+// Converts P010 into planar 4:2:0 with the 10 bits in the low end of each
+// little-endian 16-bit word (YUV420P10), as 10-bit encoders take it
+void P010ToYUV420P10(const uint8_t* src_y, int src_stride_y,
+                     const uint8_t* src_uv, int src_stride_uv,
+                     int width, int height,
+                     uint8_t* dst_y, int dst_stride_y,
+                     uint8_t* dst_u, int dst_stride_u,
+                     uint8_t* dst_v, int dst_stride_v);
+
+// Name of the kernel set picked for this CPU: "avx2", "sse4.1" or "scalar"
+const char* KernelName();
+
+}  // namespace color
+}  // namespace media
+
+#endif  // MEDIA_COLOR_CONVERT_H_
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "media_conversion_engine.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <utility>
+
+namespace media {
+
+namespace {
+
+constexpr int kFormatCount = static_cast<int>(ImageFormat::PNG) + 1;
+
+// Lock-free counters of one format pair
+struct PairCounters {
+  std::atomic<uint64_t> conversions{0};
+  std::atomic<uint64_t> failures{0};
+  std::atomic<uint64_t> total_ns{0};
+};
+
+class ConversionEngineImpl : public ConversionEngine {
+ public:
+  explicit ConversionEngineImpl(const ConversionEngineConfig& config)
+      : config_(config), start_ns_(NowNs()) {
+    if (config_.threads_per_call < 1) {
+      config_.threads_per_call = 1;
+    }
+  }
+
+  bool Convert(const ImageView& src, const MutableImageView& dst) override {
+    return Run(src.format, dst.format, [&](ImageUtils& utils) {
+      return utils.Convert(src, dst);
+    });
+  }
+
+  bool ConvertAndScale(const ImageView& src,
+                       const MutableImageView& dst,
+                       ScaleFilter filter) override {
+    return Run(src.format, dst.format, [&](ImageUtils& utils) {
+      return utils.ConvertAndScale(src, dst, filter);
+    });
+  }
+
+  ConversionEngineStats GetStats() const override {
+    ConversionEngineStats stats;
+    const double seconds = (NowNs() - start_ns_.load(std::memory_order_relaxed)) / 1e9;
+
+    for (int s = 0; s < kFormatCount; s++) {
+      for (int d = 0; d < kFormatCount; d++) {
+        const PairCounters& counters = counters_[s][d];
+        ConversionPairStats pair;
+        pair.conversions = counters.conversions.load(std::memory_order_relaxed);
+        pair.failures = counters.failures.load(std::memory_order_relaxed);
+        if (pair.conversions == 0 && pair.failures == 0) {
+          continue;
+        }
+        pair.src_format = static_cast<ImageFormat>(s);
+        pair.dst_format = static_cast<ImageFormat>(d);
+        pair.total_ms = counters.total_ns.load(std::memory_order_relaxed) / 1e6;
+        pair.average_ms = pair.conversions > 0 ? pair.total_ms / pair.conversions : 0.0;
+        pair.per_second = seconds > 0.0 ? pair.conversions / seconds : 0.0;
+
+        stats.conversions += pair.conversions;
+        stats.failures += pair.failures;
+        stats.pairs.push_back(pair);
+      }
+    }
+    stats.per_second = seconds > 0.0 ? stats.conversions / seconds : 0.0;
+
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    stats.pooled_converters = created_;
+    return stats;
+  }
+
+  void ResetStats() override {
+    for (auto& row : counters_) {
+      for (PairCounters& counters : row) {
+        counters.conversions.store(0, std::memory_order_relaxed);
+        counters.failures.store(0, std::memory_order_relaxed);
+        counters.total_ns.store(0, std::memory_order_relaxed);
+      }
+    }
+    start_ns_.store(NowNs(), std::memory_order_relaxed);
+  }
+
+ private:
+  static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  template <typename Job>
+  bool Run(ImageFormat src_format, ImageFormat dst_format, Job job) {
+    std::unique_ptr<ImageUtils> utils = Acquire();
+    if (!utils) {
+      return false;
+    }
+
+    const int64_t start = NowNs();
+    const bool ok = job(*utils);
+    const int64_t elapsed = NowNs() - start;
+    Release(std::move(utils));
+
+    const int s = static_cast<int>(src_format);
+    const int d = static_cast<int>(dst_format);
+    if (s >= 0 && s < kFormatCount && d >= 0 && d < kFormatCount) {
+      PairCounters& counters = counters_[s][d];
+      if (ok) {
+        counters.conversions.fetch_add(1, std::memory_order_relaxed);
+        counters.total_ns.fetch_add(static_cast<uint64_t>(elapsed), std::memory_order_relaxed);
+      } else {
+        counters.failures.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    return ok;
+  }
+
+  // Takes the most recently returned converter, or makes a new one when
+  // every converter is busy
+  std::unique_ptr<ImageUtils> Acquire() {
+    {
+      std::lock_guard<std::mutex> lock(pool_mutex_);
+      if (!idle_.empty()) {
+        std::unique_ptr<ImageUtils> utils = std::move(idle_.back());
+        idle_.pop_back();
+        return utils;
+      }
+    }
+
+    std::unique_ptr<ImageUtils> utils(new ImageUtils());
+    if (!*utils) {
+      std::cerr << "Failed to create converter for conversion engine" << std::endl;
+      return nullptr;
+    }
+    utils->SetThreads(config_.threads_per_call);
+    utils->SetContextCacheSize(config_.context_cache_size);
+    utils->SetColorSpace(config_.color_matrix, config_.color_range);
+
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    created_++;
+    return utils;
+  }
+
+  void Release(std::unique_ptr<ImageUtils> utils) {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    idle_.push_back(std::move(utils));
+  }
+
+  ConversionEngineConfig config_;
+  std::atomic<int64_t> start_ns_;
+  PairCounters counters_[kFormatCount][kFormatCount];
+
+  mutable std::mutex pool_mutex_;
+  std::vector<std::unique_ptr<ImageUtils>> idle_;
+  size_t created_ = 0;
+};
+
+}  // namespace
+
+std::unique_ptr<ConversionEngine> ConversionEngine::Create(const ConversionEngineConfig& config) {
+  return std::unique_ptr<ConversionEngine>(new ConversionEngineImpl(config));
+}
+
+} // namespace media
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef MEDIA_CONVERSION_ENGINE_H_
+#define MEDIA_CONVERSION_ENGINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "media_image_utils.h"
+
+namespace media {
+
+// Settings applied to every converter in a ConversionEngine pool
+struct ConversionEngineConfig {
+  // Band threads used by each call (1 = the calling thread only). Calls
+  // from different threads always run in parallel regardless.
+  int threads_per_call = 1;
+
+  // Scaling contexts each pooled converter keeps per band
+  size_t context_cache_size = 8;
+
+  ColorMatrix color_matrix = ColorMatrix::BT601;
+  ColorRange color_range = ColorRange::LIMITED;
+};
+
+// Counters for one source/destination format pair
+struct ConversionPairStats {
+  ImageFormat src_format = ImageFormat::UNKNOWN;
+  ImageFormat dst_format = ImageFormat::UNKNOWN;
+  uint64_t conversions = 0;    // Calls that succeeded
+  uint64_t failures = 0;       // Calls that returned false
+  double total_ms = 0.0;       // Time spent in successful calls
+  double average_ms = 0.0;     // total_ms / conversions
+  double per_second = 0.0;     // Conversions per second since the last reset
+};
+
+// Counters for the whole engine
+struct ConversionEngineStats {
+  uint64_t conversions = 0;
+  uint64_t failures = 0;
+  double per_second = 0.0;
+  size_t pooled_converters = 0;             // Converters created so far
+  std::vector<ConversionPairStats> pairs;   // Only pairs that were used
+};
+
+// Image conversion that can be shared by every session of a process and
+// called from any number of threads at once. Each call borrows an
+// ImageUtils from a pool, so a converter and its cached scaling contexts are
+// only ever used by one thread at a time. The pool grows to the highest
+// number of concurrent calls and is reused most-recently-returned first,
+// which keeps a steady caller on the same warm contexts.
+class ConversionEngine {
+ public:
+  // Factory method to create an engine
+  static std::unique_ptr<ConversionEngine> Create(const ConversionEngineConfig& config = ConversionEngineConfig());
+
+  virtual ~ConversionEngine() = default;
+
+  // Same as ImageUtils::Convert
+  virtual bool Convert(const ImageView& src, const MutableImageView& dst) = 0;
+
+  // Same as ImageUtils::ConvertAndScale
+  virtual bool ConvertAndScale(const ImageView& src,
+                               const MutableImageView& dst,
+                               ScaleFilter filter = ScaleFilter::BILINEAR) = 0;
+
+  // Snapshot of the counters
+  virtual ConversionEngineStats GetStats() const = 0;
+
+  // Zero the counters and restart the rate clock
+  virtual void ResetStats() = 0;
+};
+
+}  // namespace media
+
+#endif  // MEDIA_CONVERSION_ENGINE_H_
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include "media_decoded_frame.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include <algorithm>
+#include <iostream>
+
+#include "media_color_convert.h"
+
+namespace media {
+
+namespace {
+
+void FreeFrame(AVFrame* frame) {
+  av_frame_free(&frame);
+}
+
+// 8-bit planar 4:2:0, whatever its range
+bool IsI420(int format) {
+  return format == AV_PIX_FMT_YUV420P || format == AV_PIX_FMT_YUVJ420P;
+}
+
+// Same subsampling at 8 bits per sample
+AVPixelFormat EightBitFormat(const AVPixFmtDescriptor* desc) {
+  if (desc->log2_chroma_w == 1 && desc->log2_chroma_h == 1) {
+    return AV_PIX_FMT_YUV420P;
+  }
+  if (desc->log2_chroma_w == 1 && desc->log2_chroma_h == 0) {
+    return AV_PIX_FMT_YUV422P;
+  }
+  if (desc->log2_chroma_w == 0 && desc->log2_chroma_h == 0) {
+    return AV_PIX_FMT_YUV444P;
+  }
+  return AV_PIX_FMT_NONE;
+}
+
+void ReducePlane(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride,
+                 int width, int height, int shift) {
+  const int round = 1 << (shift - 1);
+  for (int y = 0; y < height; y++) {
+    const uint16_t* in = reinterpret_cast<const uint16_t*>(src + y * src_stride);
+    uint8_t* out = dst + y * dst_stride;
+    for (int x = 0; x < width; x++) {
+      out[x] = static_cast<uint8_t>(std::min((in[x] + round) >> shift, 255));
+    }
+  }
+}
+
+}  // namespace
+
+DecodedFrame DecodedFrame::TakeFrom(AVFrame* frame) {
+  DecodedFrame result;
+  if (!frame) {
+    return result;
+  }
+
+  AVFrame* owned = av_frame_alloc();
+  if (!owned) {
+    std::cerr << "Failed to allocate frame" << std::endl;
+    av_frame_unref(frame);
+    return result;
+  }
+
+  av_frame_move_ref(owned, frame);
+  result.frame_.reset(owned, FreeFrame);
+  return result;
+}
+
+const uint8_t* DecodedFrame::data(int plane) const {
+  if (!frame_ || plane < 0 || plane >= AV_NUM_DATA_POINTERS) {
+    return nullptr;
+  }
+  return frame_->data[plane];
+}
+
+int DecodedFrame::stride(int plane) const {
+  if (!frame_ || plane < 0 || plane >= AV_NUM_DATA_POINTERS) {
+    return 0;
+  }
+  return frame_->linesize[plane];
+}
+
+int DecodedFrame::width() const {
+  return frame_ ? frame_->width : 0;
+}
+
+int DecodedFrame::height() const {
+  return frame_ ? frame_->height : 0;
+}
+
+int DecodedFrame::pixel_format() const {
+  return frame_ ? frame_->format : -1;
+}
+
+int DecodedFrame::bit_depth() const {
+  if (!frame_) {
+    return 0;
+  }
+  const AVPixFmtDescriptor* desc =
+      av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame_->format));
+  return desc ? desc->comp[0].depth : 8;
+}
+
+int64_t DecodedFrame::pts() const {
+  if (!frame_) {
+    return AV_NOPTS_VALUE;
+  }
+  return frame_->pts != AV_NOPTS_VALUE ? frame_->pts
+                                       : frame_->best_effort_timestamp;
+}
+
+bool DecodedFrame::keyframe() const {
+  if (!frame_) {
+    return false;
+  }
+#ifdef AV_FRAME_FLAG_KEY
+  return (frame_->flags & AV_FRAME_FLAG_KEY) != 0;
+#else
+  return frame_->key_frame != 0;
+#endif
+}
+
+FrameType DecodedFrame::frame_type() const {
+  return frame_ ? FrameTypeFromPictureType(frame_->pict_type)
+                : FrameType::kUnknown;
+}
+
+VideoFrameView DecodedFrame::view() const {
+  VideoFrameView view;
+  if (!frame_) {
+    return view;
+  }
+
+  view.width = frame_->width;
+  view.height = frame_->height;
+  view.pts = pts() != AV_NOPTS_VALUE ? pts() : -1;
+  view.bit_depth = bit_depth();
+  for (int i = 0; i < 3; i++) {
+    view.data[i] = frame_->data[i];
+    view.stride[i] = frame_->linesize[i];
+  }
+  return view;
+}
+
+bool DecodedFrame::CopyTo(std::vector<uint8_t>* buffer) const {
+  if (!frame_ || !buffer) {
+    return false;
+  }
+
+  AVPixelFormat format = static_cast<AVPixelFormat>(frame_->format);
+  int size = av_image_get_buffer_size(format, frame_->width, frame_->height, 1);
+  if (size < 0) {
+    std::cerr << "Unsupported pixel format: " << frame_->format << std::endl;
+    return false;
+  }
+
+  buffer->resize(size);
+  int ret = av_image_copy_to_buffer(buffer->data(), size, frame_->data,
+                                    frame_->linesize, format, frame_->width,
+                                    frame_->height, 1);
+  if (ret < 0) {
+    std::cerr << "Failed to copy decoded frame" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool DecodedFrame::CopyTo(std::vector<uint8_t>* buffer, int pixel_format) const {
+  if (!frame_ || !buffer) {
+    return false;
+  }
+
+  const int format = frame_->format;
+  if (pixel_format < 0 || pixel_format == format ||
+      (IsI420(pixel_format) && IsI420(format))) {
+    return CopyTo(buffer);
+  }
+
+  const bool to_nv12 = IsI420(format) && pixel_format == AV_PIX_FMT_NV12;
+  const bool to_i420 = format == AV_PIX_FMT_NV12 && IsI420(pixel_format);
+  if (!to_nv12 && !to_i420) {
+    std::cerr << "Cannot copy pixel format " << format << " as " << pixel_format << std::endl;
+    return false;
+  }
+
+  const int width = frame_->width;
+  const int height = frame_->height;
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  const size_t luma_size = static_cast<size_t>(width) * height;
+  const size_t chroma_size = static_cast<size_t>(chroma_width) * chroma_height;
+  buffer->resize(luma_size + 2 * chroma_size);
+
+  uint8_t* dst = buffer->data();
+  av_image_copy_plane(dst, width, frame_->data[0], frame_->linesize[0], width, height);
+  if (to_nv12) {
+    color::MergeUV(frame_->data[1], frame_->linesize[1],
+                   frame_->data[2], frame_->linesize[2],
+                   chroma_width, chroma_height,
+                   dst + luma_size, 2 * chroma_width);
+  } else {
+    color::SplitUV(frame_->data[1], frame_->linesize[1],
+                   chroma_width, chroma_height,
+                   dst + luma_size, chroma_width,
+                   dst + luma_size + chroma_size, chroma_width);
+  }
+  return true;
+}
+
+bool ReduceTo8Bit(AVFrame* frame) {
+  if (!frame) {
+    return false;
+  }
+
+  const AVPixFmtDescriptor* desc =
+      av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+  if (!desc) {
+    return false;
+  }
+  const int depth = desc->comp[0].depth;
+  if (depth <= 8) {
+    return true;
+  }
+
+  const AVPixelFormat format = EightBitFormat(desc);
+  if (format == AV_PIX_FMT_NONE || desc->nb_components != 3 ||
+      !(desc->flags & AV_PIX_FMT_FLAG_PLANAR) || (desc->flags & AV_PIX_FMT_FLAG_BE) ||
+      desc->comp[0].step != 2 || desc->comp[0].shift != 0) {
+    std::cerr << "Cannot reduce pixel format to 8 bits: " << desc->name << std::endl;
+    return false;
+  }
+
+  AVFrame* reduced = av_frame_alloc();
+  if (!reduced) {
+    std::cerr << "Failed to allocate frame" << std::endl;
+    return false;
+  }
+  reduced->format = format;
+  reduced->width = frame->width;
+  reduced->height = frame->height;
+  if (av_frame_get_buffer(reduced, 0) < 0 || av_frame_copy_props(reduced, frame) < 0) {
+    std::cerr << "Failed to allocate 8-bit frame" << std::endl;
+    av_frame_free(&reduced);
+    return false;
+  }
+
+  const int shift = depth - 8;
+  for (int i = 0; i < 3; i++) {
+    const int plane_width = i == 0 ? frame->width
+        : -((-frame->width) >> desc->log2_chroma_w);
+    const int plane_height = i == 0 ? frame->height
+        : -((-frame->height) >> desc->log2_chroma_h);
+    ReducePlane(frame->data[i], frame->linesize[i], reduced->data[i],
+                reduced->linesize[i], plane_width, plane_height, shift);
+  }
+
+  av_frame_unref(frame);
+  av_frame_move_ref(frame, reduced);
+  av_frame_free(&reduced);
+  return true;
+}
+
+int DecoderDelay(const AVCodecContext* context) {
+  if (!context) {
+    return 0;
+  }
+  int delay = context->has_b_frames;
+  if ((context->active_thread_type & FF_THREAD_FRAME) && context->thread_count > 1) {
+    delay += context->thread_count - 1;
+  }
+  return delay;
+}
+
+}  // namespace media
\ No newline at end of file
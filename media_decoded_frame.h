@@ -0,0 +1,84 @@
+#ifndef MEDIA_DECODED_FRAME_H_
+#define MEDIA_DECODED_FRAME_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "media_video_frame.h"
+
+// Forward declarations for FFmpeg structs
+extern "C" {
+struct AVCodecContext;
+struct AVFrame;
+}
+
+namespace media {
+
+// Reference-counted handle to a picture produced by a decoder. The handle
+// keeps the decoder's AVFrame buffers alive, so the planes are read in place
+// instead of being copied; copies of a DecodedFrame share the same picture.
+class DecodedFrame {
+ public:
+  DecodedFrame() = default;
+
+  // Takes over the buffer references held by |frame| and leaves it blank, so
+  // it can be handed straight back to avcodec_receive_frame()
+  static DecodedFrame TakeFrom(AVFrame* frame);
+
+  // Plane pointers and strides in bytes, valid while any copy is alive.
+  // Strides may be larger than the visible width.
+  const uint8_t* data(int plane) const;
+  int stride(int plane) const;
+
+  int width() const;
+  int height() const;
+
+  // AVPixelFormat of the planes (-1 if empty)
+  int pixel_format() const;
+
+  // Bits per sample: 8, or 10/12 for formats such as YUV420P10 whose samples
+  // are stored in 16 bits (0 if empty)
+  int bit_depth() const;
+
+  int64_t pts() const;
+  bool keyframe() const;
+  FrameType frame_type() const;
+
+  bool empty() const { return !frame_; }
+
+  // Returns the planes as a VideoFrameView, e.g. to feed them to an encoder
+  VideoFrameView view() const;
+
+  // Copies the picture into |buffer| as tightly packed planes in its own
+  // pixel format, so 16-bit samples take two bytes each. Returns false if
+  // the frame is empty.
+  bool CopyTo(std::vector<uint8_t>* buffer) const;
+
+  // Same, converting to |pixel_format| in the same pass. Besides the frame's
+  // own format (or -1 for it), 8-bit 4:2:0 frames can be written as
+  // AV_PIX_FMT_NV12 or AV_PIX_FMT_YUV420P; the chroma is interleaved or
+  // split with SIMD while it is copied. Returns false for other formats.
+  bool CopyTo(std::vector<uint8_t>* buffer, int pixel_format) const;
+
+  // Underlying frame for callers that use FFmpeg directly (nullptr if empty)
+  const AVFrame* av_frame() const { return frame_.get(); }
+
+ private:
+  std::shared_ptr<AVFrame> frame_;
+};
+
+// Rounds a planar YUV frame with more than 8 bits per sample down to the
+// 8-bit format with the same subsampling (YUV420P10 -> YUV420P), replacing
+// its buffers. 8-bit frames are left alone. Decoders call this when their
+// caller has not asked for high bit depth output.
+// Returns false if the format cannot be reduced or allocation fails.
+bool ReduceTo8Bit(AVFrame* frame);
+
+// Frames an open decoder holds before the first one comes out: its reorder
+// buffer plus one per extra frame thread
+int DecoderDelay(const AVCodecContext* context);
+
+}  // namespace media
+
+#endif  // MEDIA_DECODED_FRAME_H_
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "media_encoded_packet.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <cstring>
+#include <iostream>
+
+namespace media {
+
+namespace {
+
+void FreePacket(AVPacket* packet) {
+  av_packet_free(&packet);
+}
+
+// Encoders that export AV_PKT_DATA_QUALITY_STATS (x264, x265, libvpx, nvenc)
+// store the picture type in the fifth byte of the side data
+FrameType ReadFrameType(const AVPacket* packet) {
+  size_t size = 0;
+  const uint8_t* stats =
+      av_packet_get_side_data(packet, AV_PKT_DATA_QUALITY_STATS, &size);
+  if (stats && size >= 5) {
+    FrameType type = FrameTypeFromPictureType(stats[4]);
+    if (type != FrameType::kUnknown) {
+      return type;
+    }
+  }
+
+  return (packet->flags & AV_PKT_FLAG_KEY) ? FrameType::kI : FrameType::kUnknown;
+}
+
+// The first four bytes of the same side data hold the frame quality as a
+// little-endian lambda value
+int ReadQP(const AVPacket* packet) {
+  size_t size = 0;
+  const uint8_t* stats =
+      av_packet_get_side_data(packet, AV_PKT_DATA_QUALITY_STATS, &size);
+  if (!stats || size < 4) {
+    return -1;
+  }
+
+  const uint32_t quality = stats[0] | (stats[1] << 8) | (stats[2] << 16) |
+                           (static_cast<uint32_t>(stats[3]) << 24);
+  return static_cast<int>((quality + FF_QP2LAMBDA / 2) / FF_QP2LAMBDA);
+}
+
+}  // namespace
+
+EncodedPacket EncodedPacket::TakeFrom(AVPacket* packet) {
+  EncodedPacket result;
+  if (!packet) {
+    return result;
+  }
+
+  AVPacket* owned = av_packet_alloc();
+  if (!owned) {
+    std::cerr << "Failed to allocate packet" << std::endl;
+    av_packet_unref(packet);
+    return result;
+  }
+
+  av_packet_move_ref(owned, packet);
+
+  // Payloads that are not reference counted are copied once so the handle
+  // never points into memory owned by the encoder
+  if (!owned->buf && av_packet_make_refcounted(owned) < 0) {
+    std::cerr << "Failed to reference packet data" << std::endl;
+    av_packet_free(&owned);
+    return result;
+  }
+
+  result.packet_.reset(owned, FreePacket);
+  result.frame_type_ = ReadFrameType(owned);
+  result.qp_ = ReadQP(owned);
+  return result;
+}
+
+const uint8_t* EncodedPacket::data() const {
+  return packet_ ? packet_->data : nullptr;
+}
+
+size_t EncodedPacket::size() const {
+  return packet_ ? static_cast<size_t>(packet_->size) : 0;
+}
+
+int64_t EncodedPacket::pts() const {
+  return packet_ ? packet_->pts : AV_NOPTS_VALUE;
+}
+
+int64_t EncodedPacket::dts() const {
+  return packet_ ? packet_->dts : AV_NOPTS_VALUE;
+}
+
+bool EncodedPacket::keyframe() const {
+  return packet_ && (packet_->flags & AV_PKT_FLAG_KEY);
+}
+
+void AppendPackets(const std::vector<EncodedPacket>& packets,
+                   std::vector<uint8_t>* output) {
+  size_t total_size = output->size();
+  for (const EncodedPacket& packet : packets) {
+    total_size += packet.size();
+  }
+  output->reserve(total_size);
+
+  for (const EncodedPacket& packet : packets) {
+    output->insert(output->end(), packet.data(), packet.data() + packet.size());
+  }
+}
+
+}  // namespace media
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef MEDIA_ENCODED_PACKET_H_
+#define MEDIA_ENCODED_PACKET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "media_video_frame.h"
+
+// Forward declarations for FFmpeg structs
+extern "C" {
+struct AVPacket;
+}
+
+namespace media {
+
+// Reference-counted handle to one compressed packet produced by an encoder.
+// The payload is the encoder's own AVPacket buffer; copying an EncodedPacket
+// only adds a reference, the bytes are never duplicated.
+class EncodedPacket {
+ public:
+  EncodedPacket() = default;
+
+  // Takes over the buffer reference held by |packet| and leaves it blank, so
+  // it can be handed straight back to avcodec_receive_packet()
+  static EncodedPacket TakeFrom(AVPacket* packet);
+
+  // Payload bytes, valid for as long as any copy of this packet is alive
+  const uint8_t* data() const;
+  size_t size() const;
+
+  int64_t pts() const;
+  int64_t dts() const;
+  bool keyframe() const;
+  FrameType frame_type() const { return frame_type_; }
+
+  // Frame quantizer reported by the encoder, -1 if it reports none
+  int qp() const { return qp_; }
+
+  bool empty() const { return !packet_; }
+
+  // Underlying packet for callers that feed FFmpeg directly (nullptr if empty)
+  const AVPacket* av_packet() const { return packet_.get(); }
+
+ private:
+  std::shared_ptr<AVPacket> packet_;
+  FrameType frame_type_ = FrameType::kUnknown;
+  int qp_ = -1;
+};
+
+// Appends the payload of every packet to |output|, for the contiguous
+// buffer APIs
+void AppendPackets(const std::vector<EncodedPacket>& packets,
+                   std::vector<uint8_t>* output);
+
+}  // namespace media
+
+#endif  // MEDIA_ENCODED_PACKET_H_
\ No newline at end of file
@@ -0,0 +1,495 @@
+#include "media_encoder_farm.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+#include "media_color_convert.h"
+
+namespace media {
+
+namespace {
+
+// Overrides the codec thread count, keeping any other advanced parameters
+template <typename Params>
+void SetCodecThreads(VideoEncoderConfig* config, int threads) {
+  Params params;
+  if (config->codec_params && typeid(*config->codec_params) == typeid(Params)) {
+    params = *static_cast<const Params*>(config->codec_params.get());
+  }
+  params.threads = threads;
+  config->codec_params.reset(new Params(params));
+}
+
+void LimitCodecThreads(VideoEncoderConfig* config, int threads) {
+  switch (config->output_codec) {
+    case CodecType::H264:
+      SetCodecThreads<codec::H264Params>(config, threads);
+      break;
+    case CodecType::HEVC:
+      SetCodecThreads<codec::HEVCParams>(config, threads);
+      break;
+    case CodecType::VP8:
+      SetCodecThreads<codec::VP8Params>(config, threads);
+      break;
+    case CodecType::VP9:
+      SetCodecThreads<codec::VP9Params>(config, threads);
+      break;
+    case CodecType::AV1:
+      SetCodecThreads<codec::AV1Params>(config, threads);
+      break;
+  }
+}
+
+// One queued operation of a session: a frame to encode or a flush marker
+struct Job {
+  VideoFrameView view;
+  std::vector<uint8_t> buffer;                  // Storage behind |view| if owned
+  bool p010 = false;                            // |buffer| holds P010 still to unpack
+  EncoderFarm::ReleaseCallback on_released;     // Set for caller-owned planes
+  std::shared_ptr<std::promise<bool>> flushed;  // Set for flush markers
+};
+
+struct Session {
+  int id = -1;
+  std::unique_ptr<VideoEncoder> encoder;
+  EncoderFarm::PacketCallback callback;
+  std::chrono::steady_clock::time_point start_time;
+
+  std::mutex mutex;
+  std::condition_variable space_cond;  // Signalled when a frame leaves the queue
+  std::deque<Job> pending;
+  size_t queued_frames = 0;            // Frames in |pending| or being encoded
+  bool scheduled = false;              // In a run queue or running on a worker
+  bool closing = false;
+  std::vector<EncodedPacket> output;   // Packets for PollPackets()
+
+  // Only touched by the worker running the session. Encoders report an
+  // error when drained twice, so a flush right after another is skipped.
+  bool flushed = false;
+  std::vector<uint8_t> unpacked;       // YUV420P10 planes of the last P010 frame
+
+  std::atomic<uint64_t> frames_encoded{0};
+  std::atomic<uint64_t> bytes_out{0};
+  std::atomic<uint64_t> dropped_frames{0};
+  std::atomic<uint64_t> failed_frames{0};
+};
+
+// Sessions with pending work, owned by one worker and open to stealing
+struct RunQueue {
+  std::mutex mutex;
+  std::deque<std::shared_ptr<Session>> sessions;
+};
+
+class EncoderFarmImpl : public EncoderFarm {
+ public:
+  explicit EncoderFarmImpl(const EncoderFarmConfig& config) : config_(config) {
+    int workers = config_.worker_threads;
+    if (workers <= 0) {
+      workers = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    if (workers <= 0) {
+      workers = 1;
+    }
+    if (config_.session_queue_depth == 0) {
+      config_.session_queue_depth = 1;
+    }
+
+    run_queues_.reserve(workers);
+    for (int i = 0; i < workers; i++) {
+      run_queues_.emplace_back(new RunQueue());
+    }
+    for (int i = 0; i < workers; i++) {
+      workers_.emplace_back(&EncoderFarmImpl::WorkerLoop, this, i);
+    }
+  }
+
+  ~EncoderFarmImpl() override {
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      stopping_ = true;
+    }
+    wake_cond_.notify_all();
+
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  int AddSession(const VideoEncoderConfig& config, PacketCallback callback) override {
+    VideoEncoderConfig session_config = config;
+    if (!session_config.gpu_acceleration && config_.threads_per_session > 0) {
+      LimitCodecThreads(&session_config, config_.threads_per_session);
+    }
+
+    std::unique_ptr<VideoEncoder> encoder = VideoEncoder::Create(session_config);
+    if (!encoder) {
+      std::cerr << "Failed to create encoder for farm session" << std::endl;
+      return -1;
+    }
+
+    auto session = std::make_shared<Session>();
+    session->encoder = std::move(encoder);
+    session->callback = std::move(callback);
+    session->start_time = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    session->id = next_session_id_++;
+    sessions_[session->id] = session;
+    return session->id;
+  }
+
+  bool RemoveSession(int session_id,
+                     std::vector<EncodedPacket>* packets) override {
+    if (!Flush(session_id)) {
+      std::cerr << "Flush failed while removing session " << session_id << std::endl;
+    }
+
+    std::shared_ptr<Session> session;
+    {
+      std::lock_guard<std::mutex> lock(sessions_mutex_);
+      auto it = sessions_.find(session_id);
+      if (it == sessions_.end()) {
+        return false;
+      }
+      session = it->second;
+      sessions_.erase(it);
+    }
+
+    // Wake submitters blocked on a full queue
+    std::vector<EncodedPacket> remaining;
+    {
+      std::lock_guard<std::mutex> lock(session->mutex);
+      session->closing = true;
+      remaining.swap(session->output);
+    }
+    session->space_cond.notify_all();
+
+    if (packets) {
+      packets->swap(remaining);
+    } else if (!remaining.empty()) {
+      std::cerr << "Session " << session_id << " removed with " << remaining.size()
+                << " packets not polled" << std::endl;
+    }
+    return true;
+  }
+
+  bool SubmitFrame(int session_id, const VideoFrameView& frame,
+                   ReleaseCallback on_released) override {
+    Job job;
+    job.view = frame;
+    job.on_released = std::move(on_released);
+    return Submit(session_id, std::move(job), true);
+  }
+
+  bool SubmitFrame(int session_id, std::vector<uint8_t>&& yuv_data,
+                   int64_t pts) override {
+    std::shared_ptr<Session> session = FindSession(session_id);
+    if (!session) {
+      return false;
+    }
+
+    const VideoEncoderConfig config = session->encoder->GetConfig();
+    const int bit_depth = InputBitDepth(config.input_format);
+    if (yuv_data.size() < YUV420BufferSize(config.width, config.height, bit_depth)) {
+      std::cerr << "Input YUV data is too small" << std::endl;
+      return false;
+    }
+
+    Job job;
+    job.buffer = std::move(yuv_data);
+    job.view = VideoFrameView::FromYUV420(job.buffer.data(), config.width, config.height,
+                                          bit_depth);
+    job.view.pts = pts;
+    // P010 is semi-planar with MSB-aligned samples; the worker unpacks it
+    job.p010 = config.input_format == PixelFormat::P010;
+    return Submit(session_id, std::move(job), true);
+  }
+
+  bool PollPackets(int session_id, std::vector<EncodedPacket>* packets) override {
+    std::shared_ptr<Session> session = FindSession(session_id);
+    if (!session || !packets) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(session->mutex);
+    packets->clear();
+    packets->swap(session->output);
+    return !packets->empty();
+  }
+
+  bool Flush(int session_id) override {
+    Job job;
+    job.flushed = std::make_shared<std::promise<bool>>();
+    std::future<bool> done = job.flushed->get_future();
+
+    if (!Submit(session_id, std::move(job), false)) {
+      return false;
+    }
+    return done.get();
+  }
+
+  bool GetSessionStats(int session_id, EncoderSessionStats* stats) const override {
+    std::shared_ptr<Session> session = FindSession(session_id);
+    if (!session || !stats) {
+      return false;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(session->mutex);
+      stats->queue_depth = session->queued_frames;
+    }
+    stats->frames_encoded = session->frames_encoded.load(std::memory_order_relaxed);
+    stats->bytes_out = session->bytes_out.load(std::memory_order_relaxed);
+    stats->dropped_frames = session->dropped_frames.load(std::memory_order_relaxed);
+    stats->failed_frames = session->failed_frames.load(std::memory_order_relaxed);
+
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - session->start_time).count();
+    stats->fps = seconds > 0.0 ? stats->frames_encoded / seconds : 0.0;
+    return true;
+  }
+
+  int GetWorkerCount() const override {
+    return static_cast<int>(workers_.size());
+  }
+
+ private:
+  std::shared_ptr<Session> FindSession(int session_id) const {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    auto it = sessions_.find(session_id);
+    return it != sessions_.end() ? it->second : nullptr;
+  }
+
+  // Queues |job| on its session and schedules the session if it was idle.
+  // Frames count against the queue depth; flush markers do not.
+  bool Submit(int session_id, Job job, bool is_frame) {
+    std::shared_ptr<Session> session = FindSession(session_id);
+    if (!session) {
+      return false;
+    }
+
+    bool schedule = false;
+    {
+      std::unique_lock<std::mutex> lock(session->mutex);
+      if (is_frame && session->queued_frames >= config_.session_queue_depth) {
+        if (!config_.block_when_full) {
+          session->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        session->space_cond.wait(lock, [&] {
+          return session->closing ||
+                 session->queued_frames < config_.session_queue_depth;
+        });
+      }
+      if (session->closing) {
+        return false;
+      }
+
+      session->pending.push_back(std::move(job));
+      if (is_frame) {
+        session->queued_frames++;
+      }
+      if (!session->scheduled) {
+        session->scheduled = true;
+        schedule = true;
+      }
+    }
+
+    if (schedule) {
+      size_t worker = next_worker_.fetch_add(1, std::memory_order_relaxed);
+      Enqueue(session, worker % run_queues_.size());
+    }
+    return true;
+  }
+
+  void Enqueue(const std::shared_ptr<Session>& session, size_t worker) {
+    {
+      std::lock_guard<std::mutex> lock(run_queues_[worker]->mutex);
+      run_queues_[worker]->sessions.push_back(session);
+    }
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      runnable_++;
+    }
+    wake_cond_.notify_one();
+  }
+
+  // Pops from the worker's own queue first, then steals from the others.
+  // The caller has already claimed one runnable session, so one is present.
+  std::shared_ptr<Session> TakeSession(size_t worker) {
+    const size_t count = run_queues_.size();
+    while (true) {
+      {
+        RunQueue& own = *run_queues_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.sessions.empty()) {
+          std::shared_ptr<Session> session = std::move(own.sessions.front());
+          own.sessions.pop_front();
+          return session;
+        }
+      }
+
+      for (size_t i = 1; i < count; i++) {
+        RunQueue& victim = *run_queues_[(worker + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.sessions.empty()) {
+          std::shared_ptr<Session> session = std::move(victim.sessions.back());
+          victim.sessions.pop_back();
+          return session;
+        }
+      }
+
+      std::this_thread::yield();
+    }
+  }
+
+  void WorkerLoop(size_t worker) {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cond_.wait(lock, [this] { return stopping_ || runnable_ > 0; });
+        if (runnable_ == 0) {
+          return;
+        }
+        runnable_--;
+      }
+
+      RunOnce(TakeSession(worker), worker);
+    }
+  }
+
+  // Runs a single job, then sends the session to the back of this worker's
+  // queue if it still has work, giving the other sessions their turn
+  void RunOnce(const std::shared_ptr<Session>& session, size_t worker) {
+    Job job;
+    {
+      std::lock_guard<std::mutex> lock(session->mutex);
+      job = std::move(session->pending.front());
+      session->pending.pop_front();
+    }
+
+    std::vector<EncodedPacket> packets;
+    const bool is_frame = !job.flushed;
+    if (is_frame) {
+      session->flushed = false;
+      if (job.p010) {
+        UnpackP010(session.get(), &job.view);
+      }
+      if (session->encoder->EncodeYUV420(job.view, &packets)) {
+        session->frames_encoded.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        session->failed_frames.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "Encode failed for session " << session->id << std::endl;
+      }
+      if (job.on_released) {
+        job.on_released();
+      }
+      Deliver(session, &packets);
+    } else {
+      bool result = true;
+      if (!session->flushed) {
+        result = session->encoder->Flush(&packets);
+        session->flushed = true;
+      }
+      Deliver(session, &packets);
+      job.flushed->set_value(result);
+    }
+
+    bool requeue = false;
+    {
+      std::lock_guard<std::mutex> lock(session->mutex);
+      if (is_frame) {
+        session->queued_frames--;
+      }
+      if (!session->pending.empty()) {
+        requeue = true;
+      } else {
+        session->scheduled = false;
+      }
+    }
+    if (is_frame) {
+      session->space_cond.notify_one();
+    }
+
+    if (requeue) {
+      Enqueue(session, worker);
+    }
+  }
+
+  // Converts a tightly packed P010 frame into YUV420P10 in the session's
+  // scratch buffer, the same way InputConverter handles P010 for EncodeNV12
+  static void UnpackP010(Session* session, VideoFrameView* view) {
+    const int width = view->width;
+    const int height = view->height;
+    const int chroma_width = (width + 1) / 2;
+    const size_t luma_size = static_cast<size_t>(width) * height * 2;
+    const size_t chroma_size = static_cast<size_t>(chroma_width) * ((height + 1) / 2) * 2;
+    const uint8_t* packed = view->data[0];
+
+    session->unpacked.resize(YUV420BufferSize(width, height, 10));
+    uint8_t* y = session->unpacked.data();
+    color::P010ToYUV420P10(packed, width * 2, packed + luma_size, chroma_width * 4,
+                           width, height,
+                           y, width * 2, y + luma_size, chroma_width * 2,
+                           y + luma_size + chroma_size, chroma_width * 2);
+
+    VideoFrameView planar = VideoFrameView::FromYUV420(y, width, height, 10);
+    planar.pts = view->pts;
+    planar.force_keyframe = view->force_keyframe;
+    *view = planar;
+  }
+
+  void Deliver(const std::shared_ptr<Session>& session,
+               std::vector<EncodedPacket>* packets) {
+    if (packets->empty()) {
+      return;
+    }
+
+    uint64_t bytes = 0;
+    for (const EncodedPacket& packet : *packets) {
+      bytes += packet.size();
+    }
+    session->bytes_out.fetch_add(bytes, std::memory_order_relaxed);
+
+    if (session->callback) {
+      session->callback(session->id, *packets);
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(session->mutex);
+    session->output.insert(session->output.end(), packets->begin(), packets->end());
+  }
+
+  EncoderFarmConfig config_;
+
+  // Sessions
+  mutable std::mutex sessions_mutex_;
+  std::unordered_map<int, std::shared_ptr<Session>> sessions_;
+  int next_session_id_ = 0;
+
+  // Scheduling
+  std::vector<std::unique_ptr<RunQueue>> run_queues_;
+  std::atomic<size_t> next_worker_{0};
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cond_;
+  size_t runnable_ = 0;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace
+
+std::unique_ptr<EncoderFarm> EncoderFarm::Create(const EncoderFarmConfig& config) {
+  return std::unique_ptr<EncoderFarm>(new EncoderFarmImpl(config));
+}
+
+} // namespace media
\ No newline at end of file
@@ -0,0 +1,100 @@
+#ifndef MEDIA_ENCODER_FARM_H_
+#define MEDIA_ENCODER_FARM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "media_encoded_packet.h"
+#include "media_video_encoder.h"
+#include "media_video_frame.h"
+
+namespace media {
+
+// Worker pool options for EncoderFarm
+struct EncoderFarmConfig {
+  // Number of pool workers shared by all sessions (0 = one per CPU core)
+  int worker_threads = 0;
+
+  // Codec threads per session; keeps every x264/x265/libvpx/libaom context
+  // from spawning a full set of threads of its own
+  int threads_per_session = 1;
+
+  // Maximum number of frames queued per session
+  size_t session_queue_depth = 4;
+
+  // When a session queue is full, SubmitFrame() blocks if true and drops
+  // the frame (returning false) if false
+  bool block_when_full = true;
+};
+
+// Per-session counters reported by EncoderFarm
+struct EncoderSessionStats {
+  size_t queue_depth = 0;       // Frames submitted but not yet encoded
+  uint64_t frames_encoded = 0;  // Frames the encoder accepted
+  uint64_t bytes_out = 0;       // Total encoded payload size
+  uint64_t dropped_frames = 0;  // Frames rejected because the queue was full
+  uint64_t failed_frames = 0;   // Frames the encoder failed to encode; no packets were delivered
+  double fps = 0.0;             // Frames encoded per second since the session started
+};
+
+// Multiplexes many encoder sessions onto a fixed pool of worker threads.
+// Each worker owns a run queue of sessions with pending frames and steals
+// from the other workers when its own queue is empty. A worker encodes one
+// frame of a session and then moves that session to the back of its queue,
+// so busy sessions cannot starve the others. Frames of one session are
+// always encoded in submission order, one at a time.
+class EncoderFarm {
+ public:
+  // Called on a pool worker with the packets produced for one frame
+  using PacketCallback = std::function<void(int session_id, const std::vector<EncodedPacket>& packets)>;
+
+  // Called on a pool worker once the planes of a submitted view are no
+  // longer needed
+  using ReleaseCallback = std::function<void()>;
+
+  // Factory method to create a farm and start its workers
+  static std::unique_ptr<EncoderFarm> Create(const EncoderFarmConfig& config);
+
+  // Encodes the frames still queued, then stops the workers
+  virtual ~EncoderFarm() = default;
+
+  // Create a session. Packets go to |callback|, or to PollPackets() if it is
+  // empty. Returns the session id, or -1 if the encoder could not be created.
+  virtual int AddSession(const VideoEncoderConfig& config, PacketCallback callback) = 0;
+
+  // Flush and destroy a session once its queued frames are encoded. The
+  // encoder is only drained if no Flush() has run since the last frame.
+  // Without a callback, packets not yet polled are moved to |packets|.
+  virtual bool RemoveSession(int session_id,
+                             std::vector<EncodedPacket>* packets = nullptr) = 0;
+
+  // Queue a frame given as plane pointers and strides. The planes must stay
+  // valid until |on_released| runs.
+  virtual bool SubmitFrame(int session_id, const VideoFrameView& frame,
+                           ReleaseCallback on_released) = 0;
+
+  // Queue a tightly packed YUV420 frame, taking ownership of the buffer.
+  // With a YUV420P10 input_format it holds 16-bit planar samples; with P010
+  // it holds the P010 layout (Y, then interleaved UV), unpacked before encoding.
+  virtual bool SubmitFrame(int session_id, std::vector<uint8_t>&& yuv_data,
+                           int64_t pts = -1) = 0;
+
+  // Move the packets produced so far for a session without a callback
+  virtual bool PollPackets(int session_id, std::vector<EncodedPacket>* packets) = 0;
+
+  // Wait until the session queue is empty, then drain its encoder
+  virtual bool Flush(int session_id) = 0;
+
+  // Snapshot of the counters of one session
+  virtual bool GetSessionStats(int session_id, EncoderSessionStats* stats) const = 0;
+
+  // Number of pool workers
+  virtual int GetWorkerCount() const = 0;
+};
+
+} // namespace media
+
+#endif  // MEDIA_ENCODER_FARM_H_
\ No newline at end of file
@@ -0,0 +1,340 @@
+#include "media_image_decoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+namespace media {
+
+namespace {
+
+AVCodecID ToCodecId(ImageFormat format) {
+  switch (format) {
+    case ImageFormat::JPEG:
+      return AV_CODEC_ID_MJPEG;
+    case ImageFormat::PNG:
+      return AV_CODEC_ID_PNG;
+    default:
+      return AV_CODEC_ID_NONE;
+  }
+}
+
+ImageFormat SniffFormat(const uint8_t* data, size_t size) {
+  if (size >= 8 && data[0] == 0x89 && data[1] == 'P' && data[2] == 'N' && data[3] == 'G') {
+    return ImageFormat::PNG;
+  }
+  if (size >= 4 && data[0] == 0xFF && data[1] == 0xD8) {
+    return ImageFormat::JPEG;
+  }
+  return ImageFormat::UNKNOWN;
+}
+
+// Decoder output that ImageUtils can read directly. YUV is only taken as is
+// when its range already matches the output; |full_range| reports it.
+ImageFormat FromPixelFormat(int format, bool* full_range) {
+  *full_range = false;
+  switch (format) {
+    case AV_PIX_FMT_RGB24:
+      return ImageFormat::RGB;
+    case AV_PIX_FMT_BGR24:
+      return ImageFormat::BGR;
+    case AV_PIX_FMT_RGBA:
+      return ImageFormat::RGBA;
+    case AV_PIX_FMT_BGRA:
+      return ImageFormat::BGRA;
+    case AV_PIX_FMT_YUVJ420P:
+      *full_range = true;
+      return ImageFormat::YUV420P;
+    case AV_PIX_FMT_YUVJ422P:
+      *full_range = true;
+      return ImageFormat::YUV422P;
+    case AV_PIX_FMT_YUVJ444P:
+      *full_range = true;
+      return ImageFormat::YUV444P;
+    case AV_PIX_FMT_YUV420P:
+      return ImageFormat::YUV420P;
+    case AV_PIX_FMT_YUV422P:
+      return ImageFormat::YUV422P;
+    case AV_PIX_FMT_YUV444P:
+      return ImageFormat::YUV444P;
+    default:
+      return ImageFormat::UNKNOWN;
+  }
+}
+
+bool IsRGB(ImageFormat format) {
+  return format == ImageFormat::RGB || format == ImageFormat::BGR ||
+         format == ImageFormat::RGBA || format == ImageFormat::BGRA;
+}
+
+// One open decoder with its scratch state. Only one thread uses a slot at
+// a time.
+struct DecoderSlot {
+  ~DecoderSlot() {
+    sws_freeContext(sws);
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&context);
+  }
+
+  AVCodecContext* context = nullptr;
+  AVPacket* packet = nullptr;
+  AVFrame* frame = nullptr;
+  SwsContext* sws = nullptr;  // For outputs ImageUtils does not read
+  ImageUtils utils;
+};
+
+class ImageDecoderImpl : public ImageDecoder {
+ public:
+  explicit ImageDecoderImpl(const ImageDecoderConfig& config) : config_(config) {
+    if (config_.batch_threads <= 0) {
+      config_.batch_threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    if (config_.batch_threads <= 0) {
+      config_.batch_threads = 1;
+    }
+  }
+
+  bool Decode(const uint8_t* data, size_t size,
+              ImageFormat output_format,
+              DecodedImage* image,
+              int width, int height) override {
+    if (!image) {
+      return false;
+    }
+    *image = DecodedImage();
+    if (!data || size == 0 || size > static_cast<size_t>(INT32_MAX)) {
+      std::cerr << "Invalid image data" << std::endl;
+      return false;
+    }
+    if (output_format != ImageFormat::NV12 && output_format != ImageFormat::YUV420P) {
+      std::cerr << "Unsupported image decode output format" << std::endl;
+      return false;
+    }
+
+    const ImageFormat input_format = SniffFormat(data, size);
+    if (input_format == ImageFormat::UNKNOWN) {
+      std::cerr << "Input is neither JPEG nor PNG" << std::endl;
+      return false;
+    }
+
+    std::unique_ptr<DecoderSlot> slot = Acquire(input_format);
+    if (!slot) {
+      return false;
+    }
+    const bool ok = DecodeFrame(slot.get(), data, size) &&
+                    ConvertFrame(slot.get(), output_format, width, height, image);
+    av_frame_unref(slot->frame);
+    Release(input_format, std::move(slot));
+
+    image->ok = ok;
+    return ok;
+  }
+
+  bool DecodeBatch(const std::vector<EncodedImage>& images,
+                   ImageFormat output_format,
+                   std::vector<DecodedImage>* decoded,
+                   int width, int height) override {
+    if (!decoded) {
+      return false;
+    }
+    decoded->clear();
+    decoded->resize(images.size());
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> all_ok(true);
+    auto worker = [&]() {
+      for (size_t i = next++; i < images.size(); i = next++) {
+        if (!Decode(images[i].data, images[i].size, output_format,
+                    &(*decoded)[i], width, height)) {
+          all_ok = false;
+        }
+      }
+    };
+
+    // The caller decodes too, so a single image starts no thread
+    const size_t threads = std::min(images.size(), static_cast<size_t>(config_.batch_threads));
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++) {
+      workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers) {
+      thread.join();
+    }
+    return all_ok;
+  }
+
+ private:
+  // Takes an idle decoder for |format| or opens a new one
+  std::unique_ptr<DecoderSlot> Acquire(ImageFormat format) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto& idle = format == ImageFormat::JPEG ? idle_jpeg_ : idle_png_;
+      if (!idle.empty()) {
+        std::unique_ptr<DecoderSlot> slot = std::move(idle.back());
+        idle.pop_back();
+        return slot;
+      }
+    }
+
+    const AVCodec* codec = avcodec_find_decoder(ToCodecId(format));
+    if (!codec) {
+      std::cerr << "Image decoder not found" << std::endl;
+      return nullptr;
+    }
+
+    std::unique_ptr<DecoderSlot> slot(new DecoderSlot());
+    slot->context = avcodec_alloc_context3(codec);
+    slot->packet = av_packet_alloc();
+    slot->frame = av_frame_alloc();
+    if (!slot->context || !slot->packet || !slot->frame) {
+      std::cerr << "Failed to allocate image decoder" << std::endl;
+      return nullptr;
+    }
+
+    // Parallelism comes from decoding several images at once
+    slot->context->thread_count = 1;
+    if (avcodec_open2(slot->context, codec, nullptr) < 0) {
+      std::cerr << "Failed to open image decoder" << std::endl;
+      return nullptr;
+    }
+
+    slot->utils.SetColorSpace(config_.color_matrix, config_.color_range);
+    return slot;
+  }
+
+  void Release(ImageFormat format, std::unique_ptr<DecoderSlot> slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& idle = format == ImageFormat::JPEG ? idle_jpeg_ : idle_png_;
+    idle.push_back(std::move(slot));
+  }
+
+  bool DecodeFrame(DecoderSlot* slot, const uint8_t* data, size_t size) {
+    // The packet does not own |data|; send_packet copies it into a padded
+    // buffer of its own
+    av_packet_unref(slot->packet);
+    slot->packet->data = const_cast<uint8_t*>(data);
+    slot->packet->size = static_cast<int>(size);
+
+    int ret = avcodec_send_packet(slot->context, slot->packet);
+    slot->packet->data = nullptr;
+    slot->packet->size = 0;
+    if (ret < 0) {
+      std::cerr << "Error sending image to decoder" << std::endl;
+      avcodec_flush_buffers(slot->context);
+      return false;
+    }
+
+    ret = avcodec_receive_frame(slot->context, slot->frame);
+    if (ret == AVERROR(EAGAIN)) {
+      // The decoder holds the picture back; drain it and reset for reuse
+      avcodec_send_packet(slot->context, nullptr);
+      ret = avcodec_receive_frame(slot->context, slot->frame);
+      avcodec_flush_buffers(slot->context);
+    }
+    if (ret < 0) {
+      std::cerr << "Error decoding image" << std::endl;
+      avcodec_flush_buffers(slot->context);
+      return false;
+    }
+    return true;
+  }
+
+  bool ConvertFrame(DecoderSlot* slot, ImageFormat output_format,
+                    int width, int height, DecodedImage* image) {
+    const AVFrame* frame = slot->frame;
+    if (width <= 0 || height <= 0) {
+      width = frame->width;
+      height = frame->height;
+    }
+
+    const AVPixelFormat dst_pix_fmt =
+        output_format == ImageFormat::NV12 ? AV_PIX_FMT_NV12 : AV_PIX_FMT_YUV420P;
+    const int size = av_image_get_buffer_size(dst_pix_fmt, width, height, 1);
+    if (size <= 0) {
+      std::cerr << "Invalid decoded image size" << std::endl;
+      return false;
+    }
+    image->format = output_format;
+    image->width = width;
+    image->height = height;
+    image->data.resize(size);
+
+    uint8_t* dst_data[4];
+    int dst_stride[4];
+    av_image_fill_arrays(dst_data, dst_stride, image->data.data(), dst_pix_fmt, width, height, 1);
+
+    bool full_range = false;
+    const ImageFormat src_format = FromPixelFormat(frame->format, &full_range);
+    full_range = full_range || frame->color_range == AVCOL_RANGE_JPEG;
+    const bool range_matches = full_range == (config_.color_range == ColorRange::FULL);
+
+    // RGB and YUV of the right range take the ImageUtils fast paths
+    if (src_format != ImageFormat::UNKNOWN && (IsRGB(src_format) || range_matches)) {
+      ImageView src;
+      src.format = src_format;
+      src.width = frame->width;
+      src.height = frame->height;
+      MutableImageView dst;
+      dst.format = output_format;
+      dst.width = width;
+      dst.height = height;
+      for (int i = 0; i < 3; i++) {
+        src.data[i] = frame->data[i];
+        src.stride[i] = frame->linesize[i];
+        dst.data[i] = dst_data[i];
+        dst.stride[i] = dst_stride[i];
+      }
+      return slot->utils.ConvertAndScale(src, dst, ScaleFilter::BILINEAR);
+    }
+
+    // Grey, palette, 16-bit and range-changing YUV go through swscale
+    SwsContext* sws = sws_getCachedContext(slot->sws, frame->width, frame->height,
+                                           static_cast<AVPixelFormat>(frame->format),
+                                           width, height, dst_pix_fmt,
+                                           SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws) {
+      std::cerr << "Failed to create image scaling context" << std::endl;
+      return false;
+    }
+    slot->sws = sws;
+
+    const int colorspace = config_.color_matrix == ColorMatrix::BT709 ? SWS_CS_ITU709 : SWS_CS_ITU601;
+    const int* table = sws_getCoefficients(colorspace);
+    sws_setColorspaceDetails(sws, table, full_range ? 1 : 0,
+                             table, config_.color_range == ColorRange::FULL ? 1 : 0,
+                             0, 1 << 16, 1 << 16);
+
+    int ret = sws_scale(sws, frame->data, frame->linesize, 0, frame->height,
+                        dst_data, dst_stride);
+    if (ret <= 0) {
+      std::cerr << "Scaling failed" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  ImageDecoderConfig config_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<DecoderSlot>> idle_jpeg_;
+  std::vector<std::unique_ptr<DecoderSlot>> idle_png_;
+};
+
+}  // namespace
+
+std::unique_ptr<ImageDecoder> ImageDecoder::Create(const ImageDecoderConfig& config) {
+  return std::unique_ptr<ImageDecoder>(new ImageDecoderImpl(config));
+}
+
+}  // namespace media
\ No newline at end of file
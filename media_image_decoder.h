@@ -0,0 +1,68 @@
+#ifndef MEDIA_IMAGE_DECODER_H_
+#define MEDIA_IMAGE_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "media_image_utils.h"
+
+namespace media {
+
+// Options for ImageDecoder
+struct ImageDecoderConfig {
+  // Threads used by DecodeBatch(), including the caller (0 = one per CPU core)
+  int batch_threads = 0;
+
+  // Matrix and range of the YUV output. JPEG's full-range YUV is
+  // compressed to limited range unless FULL is asked for.
+  ColorMatrix color_matrix = ColorMatrix::BT601;
+  ColorRange color_range = ColorRange::LIMITED;
+};
+
+// A compressed JPEG or PNG image in caller-owned memory
+struct EncodedImage {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+};
+
+// A decoded picture, tightly packed in |data|
+struct DecodedImage {
+  bool ok = false;
+  ImageFormat format = ImageFormat::UNKNOWN;
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> data;
+};
+
+// Decodes JPEG and PNG images with libavcodec's mjpeg and png decoders
+// straight into NV12 or YUV420P, ready for VideoEncoder. Decoder contexts are
+// kept in a pool and reused, so a stream of camera snapshots does not open a
+// new codec per image. All methods may be called from several threads.
+class ImageDecoder {
+ public:
+  // Factory method to create a decoder
+  static std::unique_ptr<ImageDecoder> Create(const ImageDecoderConfig& config = ImageDecoderConfig());
+
+  virtual ~ImageDecoder() = default;
+
+  // Decode one image into |output_format| (NV12 or YUV420P). When |width|
+  // and |height| are both positive the picture is scaled to that size,
+  // otherwise it keeps its own.
+  virtual bool Decode(const uint8_t* data, size_t size,
+                      ImageFormat output_format,
+                      DecodedImage* image,
+                      int width = 0, int height = 0) = 0;
+
+  // Decode many images in parallel; |decoded| matches |images| in order.
+  // Returns true if every image decoded.
+  virtual bool DecodeBatch(const std::vector<EncodedImage>& images,
+                           ImageFormat output_format,
+                           std::vector<DecodedImage>* decoded,
+                           int width = 0, int height = 0) = 0;
+};
+
+}  // namespace media
+
+#endif  // MEDIA_IMAGE_DECODER_H_
\ No newline at end of file
@@ -1,31 +1,550 @@
-#include "image_utils.h"
+#include "media_image_utils.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <list>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "media_color_convert.h"
+#include "media_image_decoder.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
 }
 
 namespace media {
 
+namespace {
+
+AVPixelFormat ToPixelFormat(ImageFormat format) {
+  switch (format) {
+    case ImageFormat::RGB:
+      return AV_PIX_FMT_RGB24;
+    case ImageFormat::RGBA:
+      return AV_PIX_FMT_RGBA;
+    case ImageFormat::BGRA:
+      return AV_PIX_FMT_BGRA;
+    case ImageFormat::NV12:
+      return AV_PIX_FMT_NV12;
+    case ImageFormat::YUV420P:
+      return AV_PIX_FMT_YUV420P;
+    case ImageFormat::BGR:
+      return AV_PIX_FMT_BGR24;
+    case ImageFormat::YUYV:
+      return AV_PIX_FMT_YUYV422;
+    case ImageFormat::UYVY:
+      return AV_PIX_FMT_UYVY422;
+    case ImageFormat::YUV422P:
+      return AV_PIX_FMT_YUV422P;
+    case ImageFormat::YUV444P:
+      return AV_PIX_FMT_YUV444P;
+    case ImageFormat::P010:
+      return AV_PIX_FMT_P010LE;
+    default:
+      return AV_PIX_FMT_NONE;
+  }
+}
+
+int ToSwsFlags(ScaleFilter filter) {
+  switch (filter) {
+    case ScaleFilter::POINT:
+      return SWS_POINT;
+    case ScaleFilter::BICUBIC:
+      return SWS_BICUBIC;
+    case ScaleFilter::AREA:
+      return SWS_AREA;
+    case ScaleFilter::LANCZOS:
+      return SWS_LANCZOS;
+    default:
+      return SWS_BILINEAR;
+  }
+}
+
+bool IsPackedRGB(ImageFormat format) {
+  return format == ImageFormat::RGB || format == ImageFormat::RGBA ||
+         format == ImageFormat::BGRA || format == ImageFormat::BGR;
+}
+
+color::PackedFormat ToPackedFormat(ImageFormat format) {
+  switch (format) {
+    case ImageFormat::RGBA:
+      return color::PackedFormat::kRGBA;
+    case ImageFormat::BGRA:
+      return color::PackedFormat::kBGRA;
+    case ImageFormat::BGR:
+      return color::PackedFormat::kBGR24;
+    default:
+      return color::PackedFormat::kRGB24;
+  }
+}
+
+// YUV inputs that RepackYUV brings to 4:2:0 without swscale
+bool ToYUVFormat(ImageFormat format, color::YUVFormat* yuv) {
+  switch (format) {
+    case ImageFormat::YUYV:
+      *yuv = color::YUVFormat::kYUYV;
+      return true;
+    case ImageFormat::UYVY:
+      *yuv = color::YUVFormat::kUYVY;
+      return true;
+    case ImageFormat::YUV422P:
+      *yuv = color::YUVFormat::kI422;
+      return true;
+    case ImageFormat::YUV444P:
+      *yuv = color::YUVFormat::kI444;
+      return true;
+    case ImageFormat::P010:
+      *yuv = color::YUVFormat::kP010;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Checks that every plane the format uses has memory and a stride
+template <typename View>
+bool HasPlanes(const View& view) {
+  const AVPixelFormat pix_fmt = ToPixelFormat(view.format);
+  if (pix_fmt == AV_PIX_FMT_NONE || view.width <= 0 || view.height <= 0) {
+    return false;
+  }
+  const int planes = av_pix_fmt_count_planes(pix_fmt);
+  for (int i = 0; i < planes; i++) {
+    if (!view.data[i] || view.stride[i] == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Points |view| at the planes of a tightly packed picture in |buffer|
+template <typename View>
+bool FillPlanes(const uint8_t* buffer, ImageFormat format, int width, int height, View* view) {
+  uint8_t* data[4];
+  int linesize[4];
+  if (av_image_fill_arrays(data, linesize, buffer, ToPixelFormat(format),
+                           width, height, 1) < 0) {
+    return false;
+  }
+  view->format = format;
+  view->width = width;
+  view->height = height;
+  for (int i = 0; i < 3; i++) {
+    view->data[i] = data[i];
+    view->stride[i] = linesize[i];
+  }
+  return true;
+}
+
+// Frames shorter than this per band are not worth splitting
+constexpr int kMinBandRows = 64;
+
+// Persistent workers that run the bands of one conversion. The calling
+// thread runs band 0 itself and waits for the others.
+class BandPool {
+ public:
+  explicit BandPool(int threads) {
+    for (int i = 1; i < threads; i++) {
+      workers_.emplace_back(&BandPool::WorkerLoop, this, i);
+    }
+  }
+
+  ~BandPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    work_cond_.notify_all();
+
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  int size() const { return static_cast<int>(workers_.size()) + 1; }
+
+  // Runs job(band) for every band in [0, bands); bands <= size()
+  void Run(int bands, const std::function<void(int)>& job) {
+    if (bands <= 1) {
+      job(0);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &job;
+      bands_ = bands;
+      remaining_ = bands - 1;
+      generation_++;
+    }
+    work_cond_.notify_all();
+
+    job(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cond_.wait(lock, [this] { return remaining_ == 0; });
+    job_ = nullptr;
+  }
+
+ private:
+  void WorkerLoop(int index) {
+    uint64_t seen = 0;
+    while (true) {
+      const std::function<void(int)>* job = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_cond_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) {
+          return;
+        }
+        seen = generation_;
+        if (index >= bands_) {
+          continue;
+        }
+        job = job_;
+      }
+
+      (*job)(index);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--remaining_ == 0) {
+        done_cond_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_cond_;
+  std::condition_variable done_cond_;
+  const std::function<void(int)>* job_ = nullptr;
+  uint64_t generation_ = 0;
+  int bands_ = 0;
+  int remaining_ = 0;
+  bool stopping_ = false;
+};
+
+// Splits [0, height) into at most |count| bands starting on multiples of
+// |align|; returns the band edges
+std::vector<int> BandEdges(int height, int count, int align) {
+  std::vector<int> edges(1, 0);
+  for (int i = 1; i < count; i++) {
+    int edge = static_cast<int>(static_cast<int64_t>(height) * i / count);
+    edge -= edge % align;
+    if (edge > edges.back() && edge < height) {
+      edges.push_back(edge);
+    }
+  }
+  edges.push_back(height);
+  return edges;
+}
+
+#if LIBSWSCALE_VERSION_MAJOR >= 6
+// Points |frame| at caller planes. The buffer reference does not own the
+// memory; it only lets swscale take references to the frame.
+bool WrapPlanes(AVFrame* frame, AVPixelFormat format, int width, int height,
+                const uint8_t* const data[3], const int stride[3]) {
+  frame->format = format;
+  frame->width = width;
+  frame->height = height;
+  for (int i = 0; i < 3; i++) {
+    frame->data[i] = const_cast<uint8_t*>(data[i]);
+    frame->linesize[i] = stride[i];
+  }
+  frame->buf[0] = av_buffer_create(frame->data[0],
+                                   static_cast<size_t>(std::abs(stride[0])) * height,
+                                   [](void*, uint8_t*) {}, nullptr, 0);
+  return frame->buf[0] != nullptr;
+}
+#endif
+
+// Everything a scaling context is built from. |slot| separates the
+// contexts of concurrent bands, which cannot share one.
+struct ScaleKey {
+  int src_width;
+  int src_height;
+  AVPixelFormat src_format;
+  int dst_width;
+  int dst_height;
+  AVPixelFormat dst_format;
+  int flags;
+  ColorMatrix matrix;
+  ColorRange range;
+  int slot;
+
+  bool operator==(const ScaleKey& other) const {
+    return src_width == other.src_width && src_height == other.src_height &&
+           src_format == other.src_format && dst_width == other.dst_width &&
+           dst_height == other.dst_height && dst_format == other.dst_format &&
+           flags == other.flags && matrix == other.matrix &&
+           range == other.range && slot == other.slot;
+  }
+};
+
+SwsContext* CreateScaleContext(const ScaleKey& key) {
+  SwsContext* ctx = sws_getContext(key.src_width, key.src_height, key.src_format,
+                                   key.dst_width, key.dst_height, key.dst_format,
+                                   key.flags, nullptr, nullptr, nullptr);
+  if (!ctx) {
+    return nullptr;
+  }
+
+  // Between RGB and YUV, use the same matrix and range as the native kernels
+  const bool src_rgb = (av_pix_fmt_desc_get(key.src_format)->flags & AV_PIX_FMT_FLAG_RGB) != 0;
+  const bool dst_rgb = (av_pix_fmt_desc_get(key.dst_format)->flags & AV_PIX_FMT_FLAG_RGB) != 0;
+  if (src_rgb != dst_rgb) {
+    const int* table = sws_getCoefficients(
+        key.matrix == ColorMatrix::BT709 ? SWS_CS_ITU709 : SWS_CS_ITU601);
+    const int yuv_full = key.range == ColorRange::FULL ? 1 : 0;
+    sws_setColorspaceDetails(ctx, table, src_rgb ? 1 : yuv_full,
+                             table, dst_rgb ? 1 : yuv_full,
+                             0, 1 << 16, 1 << 16);
+  }
+  return ctx;
+}
+
+// Least recently used set of scaling contexts. Alternating between a few
+// sizes or format pairs reuses their contexts instead of rebuilding one.
+class ScaleContextCache {
+ public:
+  explicit ScaleContextCache(size_t capacity) : capacity_(capacity) {}
+
+  ~ScaleContextCache() { Clear(); }
+
+  SwsContext* Get(const ScaleKey& key) {
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->first == key) {
+        entries_.splice(entries_.begin(), entries_, it);
+        return it->second;
+      }
+    }
+
+    SwsContext* ctx = CreateScaleContext(key);
+    if (!ctx) {
+      return nullptr;
+    }
+    entries_.emplace_front(key, ctx);
+    Trim();
+    return ctx;
+  }
+
+  void SetCapacity(size_t capacity) {
+    capacity_ = std::max<size_t>(1, capacity);
+    Trim();
+  }
+
+  void Clear() {
+    for (auto& entry : entries_) {
+      sws_freeContext(entry.second);
+    }
+    entries_.clear();
+  }
+
+ private:
+  void Trim() {
+    while (entries_.size() > capacity_) {
+      sws_freeContext(entries_.back().second);
+      entries_.pop_back();
+    }
+  }
+
+  std::list<std::pair<ScaleKey, SwsContext*>> entries_;  // Most recent first
+  size_t capacity_;
+};
+
+}  // namespace
+
 class ImageUtils::Impl {
  public:
-  Impl() : ctx_(nullptr) {}
+  Impl()
+      : coefficients_(color::MakeCoefficients(ColorMatrix::BT601, ColorRange::LIMITED)),
+        contexts_(kDefaultCacheSize) {}
+
   ~Impl() {
-    if (ctx_) {
-      sws_freeContext(ctx_);
-      ctx_ = nullptr;
+    // Workers may still reference contexts until they are joined
+    pool_.reset();
+    contexts_.Clear();
+    av_frame_free(&src_frame_);
+    av_frame_free(&dst_frame_);
+  }
+
+  void SetThreads(int threads) {
+    pool_.reset();
+    if (threads > 1) {
+      pool_.reset(new BandPool(threads));
+    }
+    UpdateCacheCapacity();
+  }
+
+  void SetCacheSize(size_t size) {
+    cache_size_ = std::max<size_t>(1, size);
+    UpdateCacheCapacity();
+  }
+
+  void SetColorSpace(ColorMatrix matrix, ColorRange range) {
+    matrix_ = matrix;
+    range_ = range;
+    coefficients_ = color::MakeCoefficients(matrix, range);
+    image_decoder_.reset();
+  }
+
+  // Decoder for JPEG and PNG input, opened on first use
+  ImageDecoder* GetImageDecoder() {
+    if (!image_decoder_) {
+      ImageDecoderConfig config;
+      config.batch_threads = 1;
+      config.color_matrix = matrix_;
+      config.color_range = range_;
+      image_decoder_ = ImageDecoder::Create(config);
+    }
+    return image_decoder_.get();
+  }
+
+  // Number of bands worth running for a picture of |height| rows
+  int BandCount(int height) const {
+    if (!pool_) {
+      return 1;
+    }
+    return std::max(1, std::min(pool_->size(), height / kMinBandRows));
+  }
+
+  // Runs job(top, rows) over bands of [0, height) aligned to |align| rows
+  void RunBands(int height, int align, const std::function<void(int, int)>& job) {
+    const std::vector<int> edges = BandEdges(height, BandCount(height), align);
+    if (edges.size() == 2) {
+      job(0, height);
+      return;
+    }
+    pool_->Run(static_cast<int>(edges.size()) - 1, [&](int band) {
+      job(edges[band], edges[band + 1] - edges[band]);
+    });
+  }
+
+  // One swscale pass between caller planes, split into bands when threads
+  // are enabled
+  bool Scale(int src_width, int src_height, AVPixelFormat src_format,
+             const uint8_t* const src_data[3], const int src_stride[3],
+             int dst_width, int dst_height, AVPixelFormat dst_format,
+             uint8_t* const dst_data[3], const int dst_stride[3],
+             int flags) {
+    const ScaleKey key = {src_width, src_height, src_format,
+                          dst_width, dst_height, dst_format,
+                          flags, matrix_, range_, 0};
+    if (SlicedScale(key, src_data, src_stride, dst_data, dst_stride)) {
+      return true;
     }
+
+    SwsContext* ctx = contexts_.Get(key);
+    if (!ctx) {
+      std::cerr << "Failed to create scaling context" << std::endl;
+      return false;
+    }
+
+    int ret = sws_scale(ctx, src_data, src_stride, 0, src_height,
+                        dst_data, dst_stride);
+    if (ret <= 0) {
+      std::cerr << "Scaling failed" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  color::Coefficients coefficients_;
+
+ private:
+  static constexpr size_t kDefaultCacheSize = 8;
+
+  // Every band keeps its own contexts, so the cache grows with the bands
+  void UpdateCacheCapacity() {
+    contexts_.SetCapacity(cache_size_ * (pool_ ? pool_->size() : 1));
+  }
+
+  // Runs one swscale pass split into output bands, one context per band,
+  // all created with the full-frame geometry. Every band computes its rows
+  // exactly as a single full-frame sws_scale would. Returns false when
+  // slicing is not possible so the caller can run the whole frame instead.
+  bool SlicedScale(const ScaleKey& key,
+                   const uint8_t* const src_data[3], const int src_stride[3],
+                   uint8_t* const dst_data[3], const int dst_stride[3]) {
+#if LIBSWSCALE_VERSION_MAJOR >= 6
+    const int bands = BandCount(key.dst_height);
+    if (bands <= 1) {
+      return false;
+    }
+
+    std::vector<SwsContext*> band_contexts(bands);
+    for (int i = 0; i < bands; i++) {
+      ScaleKey band_key = key;
+      band_key.slot = i;
+      band_contexts[i] = contexts_.Get(band_key);
+      if (!band_contexts[i]) {
+        return false;
+      }
+    }
+
+    const int align = std::max<int>(2, sws_receive_slice_alignment(band_contexts[0]));
+    const std::vector<int> edges = BandEdges(key.dst_height, bands, align);
+    if (edges.size() == 2) {
+      return false;
+    }
+
+    if (!WrapPlanes(src_frame_, key.src_format, key.src_width, key.src_height,
+                    src_data, src_stride) ||
+        !WrapPlanes(dst_frame_, key.dst_format, key.dst_width, key.dst_height,
+                    const_cast<const uint8_t* const*>(dst_data), dst_stride)) {
+      av_frame_unref(src_frame_);
+      av_frame_unref(dst_frame_);
+      return false;
+    }
+
+    std::atomic<bool> ok(true);
+    pool_->Run(static_cast<int>(edges.size()) - 1, [&](int band) {
+      SwsContext* ctx = band_contexts[band];
+      int ret = sws_frame_start(ctx, dst_frame_, src_frame_);
+      if (ret >= 0) {
+        ret = sws_send_slice(ctx, 0, key.src_height);
+      }
+      if (ret >= 0) {
+        ret = sws_receive_slice(ctx, edges[band], edges[band + 1] - edges[band]);
+      }
+      sws_frame_end(ctx);
+      if (ret < 0) {
+        ok = false;
+      }
+    });
+
+    av_frame_unref(src_frame_);
+    av_frame_unref(dst_frame_);
+    return ok;
+#else
+    return false;
+#endif
   }
 
-  SwsContext* ctx_;
+  ColorMatrix matrix_ = ColorMatrix::BT601;
+  ColorRange range_ = ColorRange::LIMITED;
+  std::unique_ptr<BandPool> pool_;
+  size_t cache_size_ = kDefaultCacheSize;
+  ScaleContextCache contexts_;
+  AVFrame* src_frame_ = av_frame_alloc();  // Wrappers for the sliced API
+  AVFrame* dst_frame_ = av_frame_alloc();
+  std::unique_ptr<ImageDecoder> image_decoder_;
 };
 
+constexpr size_t ImageUtils::Impl::kDefaultCacheSize;
+
 ImageUtils::ImageUtils() : initialized_(false), impl_(std::make_unique<Impl>()) {
   // Initialize FFmpeg libraries if needed
   #if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
@@ -37,6 +556,18 @@ ImageUtils::ImageUtils() : initialized_(false), impl_(std::make_unique<Impl>())
 
 ImageUtils::~ImageUtils() = default;
 
+void ImageUtils::SetThreads(int threads) {
+  impl_->SetThreads(threads);
+}
+
+void ImageUtils::SetColorSpace(ColorMatrix matrix, ColorRange range) {
+  impl_->SetColorSpace(matrix, range);
+}
+
+void ImageUtils::SetContextCacheSize(size_t contexts) {
+  impl_->SetCacheSize(contexts);
+}
+
 ImageFormat ImageUtils::DetectFormat(const std::vector<uint8_t>& data, int width, int height) {
   if (data.empty()) {
     return ImageFormat::UNKNOWN;
@@ -49,12 +580,12 @@ ImageFormat ImageUtils::DetectFormat(const std::vector<uint8_t>& data, int width
   if (data.size() >= 8) {
     // PNG signature
     if (data[0] == 0x89 && data[1] == 'P' && data[2] == 'N' && data[3] == 'G') {
-      return ImageFormat::RGBA;  // PNG typically uses RGBA
+      return ImageFormat::PNG;
     }
     
     // JPEG signature
     if (data[0] == 0xFF && data[1] == 0xD8) {
-      return ImageFormat::RGB;  // JPEG typically uses RGB
+      return ImageFormat::JPEG;
     }
   }
   
@@ -95,6 +626,42 @@ ImageFormat ImageUtils::DetectFormat(const std::vector<uint8_t>& data, int width
   return ImageFormat::UNKNOWN;
 }
 
+bool ImageUtils::ScaleYUV420(const VideoFrameView& src,
+                             uint8_t* const dst_data[3],
+                             const int dst_stride[3],
+                             int dst_width, int dst_height) {
+  ImageView src_view;
+  src_view.format = ImageFormat::YUV420P;
+  src_view.width = src.width;
+  src_view.height = src.height;
+  MutableImageView dst_view;
+  dst_view.format = ImageFormat::YUV420P;
+  dst_view.width = dst_width;
+  dst_view.height = dst_height;
+  for (int i = 0; i < 3; i++) {
+    src_view.data[i] = src.data[i];
+    src_view.stride[i] = src.stride[i];
+    dst_view.data[i] = dst_data[i];
+    dst_view.stride[i] = dst_stride[i];
+  }
+  return ConvertAndScale(src_view, dst_view, ScaleFilter::BILINEAR);
+}
+
+bool ImageUtils::ConvertAndScale(const ImageView& src, const MutableImageView& dst,
+                                 ScaleFilter filter) {
+  if (!initialized_ || !HasPlanes(src) || !HasPlanes(dst)) {
+    std::cerr << "Invalid image planes" << std::endl;
+    return false;
+  }
+  if (src.width == dst.width && src.height == dst.height) {
+    return Convert(src, dst);
+  }
+
+  return impl_->Scale(src.width, src.height, ToPixelFormat(src.format), src.data, src.stride,
+                      dst.width, dst.height, ToPixelFormat(dst.format), dst.data, dst.stride,
+                      ToSwsFlags(filter));
+}
+
 bool ImageUtils::DetectDimensions(const std::vector<uint8_t>& data, ImageFormat format, 
                                 int& width, int& height) {
   // This is a simplified implementation - real-world code would need to parse
@@ -106,6 +673,9 @@ bool ImageUtils::DetectDimensions(const std::vector<uint8_t>& data, ImageFormat
     
     switch (format) {
       case ImageFormat::RGB:
+      case ImageFormat::BGR:
+      case ImageFormat::YUV444P:
+      case ImageFormat::P010:
         expected_size = width * height * 3;
         break;
       case ImageFormat::RGBA:
@@ -116,6 +686,11 @@ bool ImageUtils::DetectDimensions(const std::vector<uint8_t>& data, ImageFormat
       case ImageFormat::YUV420P:
         expected_size = width * height * 3 / 2;
         break;
+      case ImageFormat::YUYV:
+      case ImageFormat::UYVY:
+      case ImageFormat::YUV422P:
+        expected_size = width * height * 2;
+        break;
       default:
         return false;
     }
@@ -142,6 +717,11 @@ bool ImageUtils::ConvertFormat(const std::vector<uint8_t>& input_data,
     std::cerr << "Failed to detect input format" << std::endl;
     return false;
   }
+
+  // Compressed images carry their own dimensions
+  if (src_format == ImageFormat::JPEG || src_format == ImageFormat::PNG) {
+    return ConvertFormat(input_data, src_format, output_data, target_format, width, height);
+  }
   
   // Try to detect dimensions if not provided
   if (width <= 0 || height <= 0) {
@@ -150,42 +730,37 @@ bool ImageUtils::ConvertFormat(const std::vector<uint8_t>& input_data,
       return false;
     }
   }
-  
-  // Map formats to FFmpeg pixel formats
-  AVPixelFormat src_pix_fmt;
-  AVPixelFormat dst_pix_fmt;
-  
-  switch (src_format) {
-    case ImageFormat::RGB:
-      src_pix_fmt = AV_PIX_FMT_RGB24;
-      break;
-    case ImageFormat::RGBA:
-      src_pix_fmt = AV_PIX_FMT_RGBA;
-      break;
-    case ImageFormat::BGRA:
-      src_pix_fmt = AV_PIX_FMT_BGRA;
-      break;
-    case ImageFormat::NV12:
-      src_pix_fmt = AV_PIX_FMT_NV12;
-      break;
-    case ImageFormat::YUV420P:
-      src_pix_fmt = AV_PIX_FMT_YUV420P;
-      break;
-    default:
-      std::cerr << "Unsupported source format" << std::endl;
-      return false;
+
+  return ConvertFormat(input_data, src_format, output_data, target_format, width, height);
+}
+
+bool ImageUtils::ConvertFormat(const std::vector<uint8_t>& input_data,
+                               ImageFormat src_format,
+                               std::vector<uint8_t>& output_data,
+                               ImageFormat target_format,
+                               int width, int height) {
+  if (!initialized_ || input_data.empty()) {
+    return false;
   }
   
-  switch (target_format) {
-    case ImageFormat::NV12:
-      dst_pix_fmt = AV_PIX_FMT_NV12;
-      break;
-    case ImageFormat::YUV420P:
-      dst_pix_fmt = AV_PIX_FMT_YUV420P;
-      break;
-    default:
-      std::cerr << "Unsupported target format" << std::endl;
+  if (target_format != ImageFormat::NV12 && target_format != ImageFormat::YUV420P) {
+    std::cerr << "Unsupported target format" << std::endl;
+    return false;
+  }
+
+  if (src_format == ImageFormat::JPEG || src_format == ImageFormat::PNG) {
+    ImageDecoder* decoder = impl_->GetImageDecoder();
+    DecodedImage image;
+    if (!decoder || !decoder->Decode(input_data.data(), input_data.size(), target_format,
+                                     &image, width, height)) {
       return false;
+    }
+    output_data = std::move(image.data);
+    return true;
+  }
+
+  if (width <= 0 || height <= 0) {
+    return false;
   }
   
   // If formats are already the same, just copy the data
@@ -193,164 +768,101 @@ bool ImageUtils::ConvertFormat(const std::vector<uint8_t>& input_data,
     output_data = input_data;
     return true;
   }
-  
-  // Create scaling context
-  impl_->ctx_ = sws_getCachedContext(
-      impl_->ctx_,
-      width, height, src_pix_fmt,
-      width, height, dst_pix_fmt,
-      SWS_BILINEAR, nullptr, nullptr, nullptr);
-  
-  if (!impl_->ctx_) {
-    std::cerr << "Failed to create scaling context" << std::endl;
+
+  const int src_size = av_image_get_buffer_size(ToPixelFormat(src_format), width, height, 1);
+  const int dst_size = av_image_get_buffer_size(ToPixelFormat(target_format), width, height, 1);
+  if (src_size <= 0 || dst_size <= 0 ||
+      input_data.size() < static_cast<size_t>(src_size)) {
+    std::cerr << "Input size does not match dimensions" << std::endl;
     return false;
   }
-  
-  // Allocate frame buffers
-  AVFrame* src_frame = av_frame_alloc();
-  AVFrame* dst_frame = av_frame_alloc();
-  
-  if (!src_frame || !dst_frame) {
-    av_frame_free(&src_frame);
-    av_frame_free(&dst_frame);
-    std::cerr << "Failed to allocate frames" << std::endl;
+
+  // Wrap both buffers as planes and convert in place
+  output_data.resize(dst_size);
+  ImageView src;
+  MutableImageView dst;
+  if (!FillPlanes(input_data.data(), src_format, width, height, &src) ||
+      !FillPlanes(output_data.data(), target_format, width, height, &dst)) {
+    std::cerr << "Unsupported source format" << std::endl;
     return false;
   }
-  
-  // Set up source frame
-  src_frame->width = width;
-  src_frame->height = height;
-  src_frame->format = src_pix_fmt;
-  
-  int ret = av_image_alloc(
-      src_frame->data, src_frame->linesize,
-      width, height, src_pix_fmt, 1);
-  
-  if (ret < 0) {
-    av_frame_free(&src_frame);
-    av_frame_free(&dst_frame);
-    std::cerr << "Failed to allocate source image" << std::endl;
+  return Convert(src, dst);
+}
+
+bool ImageUtils::Convert(const ImageView& src, const MutableImageView& dst) {
+  if (!initialized_ || !HasPlanes(src) || !HasPlanes(dst)) {
+    std::cerr << "Invalid image planes" << std::endl;
     return false;
   }
-  
-  // Set up destination frame
-  dst_frame->width = width;
-  dst_frame->height = height;
-  dst_frame->format = dst_pix_fmt;
-  
-  ret = av_image_alloc(
-      dst_frame->data, dst_frame->linesize,
-      width, height, dst_pix_fmt, 1);
-  
-  if (ret < 0) {
-    av_freep(&src_frame->data[0]);
-    av_frame_free(&src_frame);
-    av_frame_free(&dst_frame);
-    std::cerr << "Failed to allocate destination image" << std::endl;
+  if (src.width != dst.width || src.height != dst.height) {
+    std::cerr << "Source and destination sizes differ" << std::endl;
     return false;
   }
-  
-  // Copy input data to source frame
-  // This is a simplified approach - proper handling would depend on the actual data layout
-  if (src_pix_fmt == AV_PIX_FMT_RGB24 || 
-      src_pix_fmt == AV_PIX_FMT_RGBA || 
-      src_pix_fmt == AV_PIX_FMT_BGRA) {
-    // For packed formats (RGB, RGBA, BGRA), data is contiguous
-    std::copy(input_data.begin(), input_data.end(), src_frame->data[0]);
-  } else {
-    // For planar formats (NV12, YUV420P), more careful copying is needed
-    const size_t y_plane_size = width * height;
-    
-    // Copy Y plane
-    std::copy(input_data.begin(), input_data.begin() + y_plane_size, src_frame->data[0]);
-    
-    if (src_pix_fmt == AV_PIX_FMT_NV12) {
-      // For NV12, UV is interleaved in the second plane
-      std::copy(input_data.begin() + y_plane_size, input_data.end(), src_frame->data[1]);
-    } else if (src_pix_fmt == AV_PIX_FMT_YUV420P) {
-      // For YUV420P, U and V are separate planes
-      const size_t uv_plane_size = y_plane_size / 4;
-      std::copy(input_data.begin() + y_plane_size, 
-                input_data.begin() + y_plane_size + uv_plane_size, 
-                src_frame->data[1]);  // U plane
-      std::copy(input_data.begin() + y_plane_size + uv_plane_size, 
-                input_data.end(), 
-                src_frame->data[2]);  // V plane
-    }
+
+  const int width = src.width;
+  const int height = src.height;
+  const AVPixelFormat src_pix_fmt = ToPixelFormat(src.format);
+  const AVPixelFormat dst_pix_fmt = ToPixelFormat(dst.format);
+
+  if (src.format == dst.format) {
+    av_image_copy(const_cast<uint8_t**>(dst.data), const_cast<int*>(dst.stride),
+                  const_cast<const uint8_t**>(src.data), src.stride,
+                  src_pix_fmt, width, height);
+    return true;
   }
-  
-  // Perform the conversion
-  ret = sws_scale(impl_->ctx_,
-                 src_frame->data, src_frame->linesize, 0, height,
-                 dst_frame->data, dst_frame->linesize);
-  
-  if (ret <= 0) {
-    av_freep(&src_frame->data[0]);
-    av_freep(&dst_frame->data[0]);
-    av_frame_free(&src_frame);
-    av_frame_free(&dst_frame);
-    std::cerr << "Scaling failed" << std::endl;
-    return false;
+
+  // Packed RGB goes through the SIMD kernels straight into the output planes
+  // Bands start on even rows, so each one owns whole chroma rows
+  if (IsPackedRGB(src.format) && dst.format == ImageFormat::NV12) {
+    impl_->RunBands(height, 2, [&](int top, int rows) {
+      color::PackedToNV12(ToPackedFormat(src.format),
+                          src.data[0] + static_cast<ptrdiff_t>(top) * src.stride[0], src.stride[0],
+                          width, rows,
+                          dst.data[0] + static_cast<ptrdiff_t>(top) * dst.stride[0], dst.stride[0],
+                          dst.data[1] + static_cast<ptrdiff_t>(top / 2) * dst.stride[1], dst.stride[1],
+                          impl_->coefficients_);
+    });
+    return true;
   }
-  
-  // Calculate output size and prepare output buffer
-  size_t output_size = 0;
-  if (dst_pix_fmt == AV_PIX_FMT_NV12 || dst_pix_fmt == AV_PIX_FMT_YUV420P) {
-    output_size = width * height * 3 / 2;  // Y + U/V at quarter size each
-  } else {
-    // This should not happen given our supported formats, but including for robustness
-    av_freep(&src_frame->data[0]);
-    av_freep(&dst_frame->data[0]);
-    av_frame_free(&src_frame);
-    av_frame_free(&dst_frame);
-    std::cerr << "Unsupported output format for size calculation" << std::endl;
-    return false;
+  if (IsPackedRGB(src.format) && dst.format == ImageFormat::YUV420P) {
+    impl_->RunBands(height, 2, [&](int top, int rows) {
+      color::PackedToI420(ToPackedFormat(src.format),
+                          src.data[0] + static_cast<ptrdiff_t>(top) * src.stride[0], src.stride[0],
+                          width, rows,
+                          dst.data[0] + static_cast<ptrdiff_t>(top) * dst.stride[0], dst.stride[0],
+                          dst.data[1] + static_cast<ptrdiff_t>(top / 2) * dst.stride[1], dst.stride[1],
+                          dst.data[2] + static_cast<ptrdiff_t>(top / 2) * dst.stride[2], dst.stride[2],
+                          impl_->coefficients_);
+    });
+    return true;
   }
-  
-  output_data.resize(output_size);
-  
-  // Copy from destination frame to output buffer
-  if (dst_pix_fmt == AV_PIX_FMT_NV12) {
-    // For NV12, copy Y plane and interleaved UV plane
-    const size_t y_plane_size = width * height;
-    
-    // Copy Y plane
-    std::copy(dst_frame->data[0], 
-              dst_frame->data[0] + y_plane_size, 
-              output_data.begin());
-    
-    // Copy UV plane
-    std::copy(dst_frame->data[1], 
-              dst_frame->data[1] + (y_plane_size / 2), 
-              output_data.begin() + y_plane_size);
-  } else if (dst_pix_fmt == AV_PIX_FMT_YUV420P) {
-    // For YUV420P, copy Y, U, and V planes separately
-    const size_t y_plane_size = width * height;
-    const size_t uv_plane_size = y_plane_size / 4;
-    
-    // Copy Y plane
-    std::copy(dst_frame->data[0], 
-              dst_frame->data[0] + y_plane_size, 
-              output_data.begin());
-    
-    // Copy U plane
-    std::copy(dst_frame->data[1], 
-              dst_frame->data[1] + uv_plane_size, 
-              output_data.begin() + y_plane_size);
-    
-    // Copy V plane
-    std::copy(dst_frame->data[2], 
-              dst_frame->data[2] + uv_plane_size, 
-              output_data.begin() + y_plane_size + uv_plane_size);
+
+  // Camera and planar YUV layouts are repacked to 4:2:0 directly
+  color::YUVFormat yuv_format;
+  if (ToYUVFormat(src.format, &yuv_format) &&
+      (dst.format == ImageFormat::NV12 || dst.format == ImageFormat::YUV420P)) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(src_pix_fmt);
+    const bool nv12 = dst.format == ImageFormat::NV12;
+    impl_->RunBands(height, 2, [&](int top, int rows) {
+      const uint8_t* src_data[3];
+      for (int i = 0; i < 3; i++) {
+        const int shift = i > 0 ? desc->log2_chroma_h : 0;
+        src_data[i] = src.data[i] ? src.data[i] + static_cast<ptrdiff_t>(top >> shift) * src.stride[i]
+                                  : nullptr;
+      }
+      color::RepackYUV(yuv_format, src_data, src.stride, width, rows,
+                       dst.data[0] + static_cast<ptrdiff_t>(top) * dst.stride[0], dst.stride[0],
+                       dst.data[1] + static_cast<ptrdiff_t>(top / 2) * dst.stride[1], dst.stride[1],
+                       nv12 ? nullptr : dst.data[2] + static_cast<ptrdiff_t>(top / 2) * dst.stride[2],
+                       nv12 ? 0 : dst.stride[2]);
+    });
+    return true;
   }
-  
-  // Clean up
-  av_freep(&src_frame->data[0]);
-  av_freep(&dst_frame->data[0]);
-  av_frame_free(&src_frame);
-  av_frame_free(&dst_frame);
-  
-  return true;
+
+  // Everything else is a same-size swscale pass
+  return impl_->Scale(width, height, src_pix_fmt, src.data, src.stride,
+                      width, height, dst_pix_fmt, dst.data, dst.stride,
+                      SWS_POINT);
 }
 
 bool ImageUtils::ConvertToNV12(const std::vector<uint8_t>& input_data, 
@@ -365,4 +877,18 @@ bool ImageUtils::ConvertToYUV420(const std::vector<uint8_t>& input_data,
   return ConvertFormat(input_data, output_yuv420, ImageFormat::YUV420P, width, height);
 }
 
+bool ImageUtils::ConvertToNV12(const std::vector<uint8_t>& input_data,
+                               ImageFormat input_format,
+                               std::vector<uint8_t>& output_nv12,
+                               int width, int height) {
+  return ConvertFormat(input_data, input_format, output_nv12, ImageFormat::NV12, width, height);
+}
+
+bool ImageUtils::ConvertToYUV420(const std::vector<uint8_t>& input_data,
+                                 ImageFormat input_format,
+                                 std::vector<uint8_t>& output_yuv420,
+                                 int width, int height) {
+  return ConvertFormat(input_data, input_format, output_yuv420, ImageFormat::YUV420P, width, height);
+}
+
 }  // namespace media
\ No newline at end of file
@@ -1,11 +1,14 @@
 #ifndef MEDIA_IMAGE_UTILS_H_
 #define MEDIA_IMAGE_UTILS_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "media_video_frame.h"
+
 namespace media {
 
 enum class ImageFormat {
@@ -14,7 +17,44 @@ enum class ImageFormat {
   RGBA,
   BGRA,
   NV12,
-  YUV420P
+  YUV420P,
+  BGR,      // Packed B, G, R
+  YUYV,     // Packed 4:2:2 Y0 U Y1 V, as most USB cameras deliver
+  UYVY,     // Packed 4:2:2 U Y0 V Y1
+  YUV422P,  // Planar 4:2:2 (I422)
+  YUV444P,  // Planar 4:4:4 (I444)
+  P010,     // 4:2:0 Y and interleaved UV, 10 bits in the top of 16-bit LE samples
+  JPEG,     // Compressed; decoded with libavcodec (input only)
+  PNG       // Compressed; decoded with libavcodec (input only)
+};
+
+// Resampling filter for ConvertAndScale
+enum class ScaleFilter {
+  POINT,     // Nearest neighbour
+  BILINEAR,
+  BICUBIC,
+  AREA,      // Box average, good for large downscales
+  LANCZOS
+};
+
+// A picture in caller-owned memory. Packed formats (RGB, BGR, RGBA, BGRA,
+// YUYV, UYVY) use plane 0, NV12 and P010 use planes 0 (Y) and 1 (UV), the
+// planar YUV formats use all three.
+struct ImageView {
+  ImageFormat format = ImageFormat::UNKNOWN;
+  int width = 0;
+  int height = 0;
+  const uint8_t* data[3] = {nullptr, nullptr, nullptr};
+  int stride[3] = {0, 0, 0};  // Bytes per row of each plane
+};
+
+// Writable counterpart of ImageView for conversion output
+struct MutableImageView {
+  ImageFormat format = ImageFormat::UNKNOWN;
+  int width = 0;
+  int height = 0;
+  uint8_t* data[3] = {nullptr, nullptr, nullptr};
+  int stride[3] = {0, 0, 0};
 };
 
 class ImageUtils {
@@ -37,6 +77,55 @@ class ImageUtils {
                        int width = 0, 
                        int height = 0);
 
+  // Same as above with the input format given by the caller, which skips
+  // detection. Every ImageFormat except UNKNOWN is accepted; RGB, BGR,
+  // RGBA, BGRA, YUYV, UYVY, YUV422P, YUV444P and P010 have native paths.
+  // JPEG and PNG input is decoded at its own size, or scaled to
+  // |width| x |height| when both are given; see ImageDecoder for batches.
+  bool ConvertToNV12(const std::vector<uint8_t>& input_data,
+                     ImageFormat input_format,
+                     std::vector<uint8_t>& output_nv12,
+                     int width,
+                     int height);
+
+  bool ConvertToYUV420(const std::vector<uint8_t>& input_data,
+                       ImageFormat input_format,
+                       std::vector<uint8_t>& output_yuv420,
+                       int width,
+                       int height);
+
+  // Converts |src| into |dst| of the same size, reading and writing the
+  // caller's planes directly. Nothing is allocated once the first call for a
+  // given format pair has set up its context.
+  bool Convert(const ImageView& src, const MutableImageView& dst);
+
+  // Splits large conversions and scales into horizontal bands run on
+  // |threads| threads (1 = calling thread only). The output is identical
+  // for every thread count.
+  void SetThreads(int threads);
+
+  // Selects the matrix and range used for RGB, BGR, RGBA and BGRA input
+  // (default BT.601 limited range, as swscale uses)
+  void SetColorSpace(ColorMatrix matrix, ColorRange range);
+
+  // Converts and resizes |src| into |dst|; formats and sizes may both
+  // differ. Scaling contexts are kept in a small LRU cache keyed by formats,
+  // sizes and filter, so alternating between a few output sizes does not
+  // reinitialize swscale.
+  bool ConvertAndScale(const ImageView& src,
+                       const MutableImageView& dst,
+                       ScaleFilter filter = ScaleFilter::BILINEAR);
+
+  // Scales a YUV420P picture into caller-provided planes (bilinear)
+  bool ScaleYUV420(const VideoFrameView& src,
+                   uint8_t* const dst_data[3],
+                   const int dst_stride[3],
+                   int dst_width,
+                   int dst_height);
+
+  // Number of scaling contexts kept per band (default 8)
+  void SetContextCacheSize(size_t contexts);
+
   // Detects the image format of input data
   ImageFormat DetectFormat(const std::vector<uint8_t>& data, 
                            int width = 0, 
@@ -56,6 +145,13 @@ class ImageUtils {
                      int width = 0,
                      int height = 0);
 
+  bool ConvertFormat(const std::vector<uint8_t>& input_data,
+                     ImageFormat src_format,
+                     std::vector<uint8_t>& output_data,
+                     ImageFormat target_format,
+                     int width,
+                     int height);
+
   bool initialized_;
   class Impl;
   std::unique_ptr<Impl> impl_;
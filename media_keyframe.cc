@@ -0,0 +1,298 @@
+#include "media_keyframe.h"
+
+namespace media {
+
+namespace {
+
+// What a unit of the bitstream says about its packet
+enum class Verdict {
+  kUnknown,  // Not a picture, look further
+  kKey,
+  kNonKey
+};
+
+// MSB-first bit reader. With |unescape|, the emulation prevention bytes of
+// H264/HEVC NAL units (00 00 03) are skipped.
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, size_t size, bool unescape)
+      : data_(data), size_(size), unescape_(unescape) {}
+
+  bool Read(int bits, uint32_t* value) {
+    uint32_t result = 0;
+    for (int i = 0; i < bits; i++) {
+      if (bits_left_ == 0) {
+        if (!NextByte()) {
+          return false;
+        }
+      }
+      bits_left_--;
+      result = (result << 1) | ((current_ >> bits_left_) & 1);
+    }
+    *value = result;
+    return true;
+  }
+
+  // Unsigned Exp-Golomb code
+  bool ReadUe(uint32_t* value) {
+    int zeros = 0;
+    uint32_t bit = 0;
+    while (Read(1, &bit) && bit == 0) {
+      if (++zeros > 31) {
+        return false;
+      }
+    }
+    if (bit != 1) {
+      return false;
+    }
+    uint32_t suffix = 0;
+    if (!Read(zeros, &suffix)) {
+      return false;
+    }
+    *value = ((1u << zeros) - 1) + suffix;
+    return true;
+  }
+
+ private:
+  bool NextByte() {
+    if (pos_ >= size_) {
+      return false;
+    }
+    if (unescape_ && zeros_ >= 2 && data_[pos_] == 0x03) {
+      zeros_ = 0;
+      if (++pos_ >= size_) {
+        return false;
+      }
+    }
+    current_ = data_[pos_++];
+    zeros_ = current_ == 0 ? zeros_ + 1 : 0;
+    bits_left_ = 8;
+    return true;
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+  bool unescape_;
+  size_t pos_ = 0;
+  int zeros_ = 0;
+  uint8_t current_ = 0;
+  int bits_left_ = 0;
+};
+
+// Walks the NAL units of an Annex B or 4-byte length-prefixed packet
+class NalReader {
+ public:
+  NalReader(const uint8_t* data, size_t size) : data_(data), size_(size) {
+    annex_b_ = size >= 3 && data[0] == 0 && data[1] == 0 &&
+               (data[2] == 1 || (size >= 4 && data[2] == 0 && data[3] == 1));
+  }
+
+  bool Next(const uint8_t** nal, size_t* nal_size) {
+    return annex_b_ ? NextAnnexB(nal, nal_size) : NextLengthPrefixed(nal, nal_size);
+  }
+
+ private:
+  // Position just past the next start code at or after |from|, or size_
+  size_t SkipStartCode(size_t from) const {
+    for (size_t i = from; i + 2 < size_; i++) {
+      if (data_[i] == 0 && data_[i + 1] == 0 && data_[i + 2] == 1) {
+        return i + 3;
+      }
+    }
+    return size_;
+  }
+
+  bool NextAnnexB(const uint8_t** nal, size_t* nal_size) {
+    const size_t start = SkipStartCode(pos_);
+    if (start >= size_) {
+      return false;
+    }
+    size_t end = SkipStartCode(start);
+    if (end < size_) {
+      end -= 3;
+      // A four-byte start code leaves a zero behind
+      while (end > start && data_[end - 1] == 0) {
+        end--;
+      }
+    }
+    pos_ = end;
+    *nal = data_ + start;
+    *nal_size = end - start;
+    return *nal_size > 0 || Next(nal, nal_size);
+  }
+
+  bool NextLengthPrefixed(const uint8_t** nal, size_t* nal_size) {
+    if (pos_ + 4 > size_) {
+      return false;
+    }
+    const size_t length = (static_cast<size_t>(data_[pos_]) << 24) |
+                          (static_cast<size_t>(data_[pos_ + 1]) << 16) |
+                          (static_cast<size_t>(data_[pos_ + 2]) << 8) |
+                          data_[pos_ + 3];
+    pos_ += 4;
+    if (length == 0 || length > size_ - pos_) {
+      return false;
+    }
+    *nal = data_ + pos_;
+    *nal_size = length;
+    pos_ += length;
+    return true;
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+  bool annex_b_ = false;
+  size_t pos_ = 0;
+};
+
+Verdict H264Nal(const uint8_t* nal, size_t size) {
+  switch (nal[0] & 0x1F) {
+    case 5:  // IDR slice
+      return Verdict::kKey;
+    case 1: {  // Non-IDR slice; I and SI slices are kept too
+      BitReader reader(nal + 1, size - 1, true);
+      uint32_t first_mb = 0;
+      uint32_t slice_type = 0;
+      if (!reader.ReadUe(&first_mb) || !reader.ReadUe(&slice_type)) {
+        return Verdict::kKey;
+      }
+      return slice_type % 5 == 2 || slice_type % 5 == 4 ? Verdict::kKey : Verdict::kNonKey;
+    }
+    case 6:  // SEI; a recovery point makes the next picture a random access point
+      return size > 1 && nal[1] == 6 ? Verdict::kKey : Verdict::kUnknown;
+    default:
+      return Verdict::kUnknown;
+  }
+}
+
+Verdict HEVCNal(const uint8_t* nal, size_t /*size*/) {
+  const int type = (nal[0] >> 1) & 0x3F;
+  if (type >= 16 && type <= 21) {  // BLA, IDR and CRA
+    return Verdict::kKey;
+  }
+  if (type <= 9) {  // Other VCL NAL units
+    return Verdict::kNonKey;
+  }
+  return Verdict::kUnknown;
+}
+
+template <typename Fn>
+bool ScanNals(const uint8_t* data, size_t size, Fn classify) {
+  NalReader reader(data, size);
+  const uint8_t* nal = nullptr;
+  size_t nal_size = 0;
+  while (reader.Next(&nal, &nal_size)) {
+    const Verdict verdict = classify(nal, nal_size);
+    if (verdict != Verdict::kUnknown) {
+      return verdict == Verdict::kKey;
+    }
+  }
+  return true;
+}
+
+bool IsVP9Key(const uint8_t* data, size_t size) {
+  BitReader reader(data, size, false);
+  uint32_t marker = 0;
+  uint32_t profile_low = 0;
+  uint32_t profile_high = 0;
+  if (!reader.Read(2, &marker) || marker != 2 ||
+      !reader.Read(1, &profile_low) || !reader.Read(1, &profile_high)) {
+    return true;
+  }
+  uint32_t bit = 0;
+  if (profile_high == 1 && profile_low == 1 && !reader.Read(1, &bit)) {
+    return true;
+  }
+  uint32_t show_existing_frame = 0;
+  uint32_t frame_type = 0;
+  if (!reader.Read(1, &show_existing_frame)) {
+    return true;
+  }
+  if (show_existing_frame) {
+    return false;
+  }
+  return !reader.Read(1, &frame_type) || frame_type == 0;
+}
+
+bool ReadLeb128(const uint8_t* data, size_t size, size_t* pos, uint64_t* value) {
+  *value = 0;
+  for (int i = 0; i < 8; i++) {
+    if (*pos >= size) {
+      return false;
+    }
+    const uint8_t byte = data[(*pos)++];
+    *value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IsAV1Key(const uint8_t* data, size_t size) {
+  bool reduced_still_picture = false;
+  size_t pos = 0;
+  while (pos < size) {
+    const uint8_t header = data[pos++];
+    const int type = (header >> 3) & 0x0F;
+    if (header & 0x04) {  // Extension header
+      pos++;
+    }
+    uint64_t obu_size = size > pos ? size - pos : 0;
+    if ((header & 0x02) && !ReadLeb128(data, size, &pos, &obu_size)) {
+      return true;
+    }
+    if (pos > size || obu_size > size - pos) {
+      return true;
+    }
+
+    BitReader reader(data + pos, static_cast<size_t>(obu_size), false);
+    uint32_t bits = 0;
+    if (type == 1) {  // Sequence header: seq_profile, still_picture, reduced_still_picture_header
+      if (reader.Read(5, &bits)) {
+        reduced_still_picture = (bits & 1) != 0;
+      }
+    } else if (type == 3 || type == 6) {  // Frame header or frame
+      if (reduced_still_picture) {
+        return true;
+      }
+      uint32_t show_existing_frame = 0;
+      if (!reader.Read(1, &show_existing_frame)) {
+        return true;
+      }
+      if (show_existing_frame) {
+        return false;
+      }
+      return !reader.Read(2, &bits) || bits == 0;  // KEY_FRAME
+    }
+    pos += static_cast<size_t>(obu_size);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool IsKeyframePacket(CodecType codec, const uint8_t* data, size_t size) {
+  if (!data || size == 0) {
+    return true;
+  }
+
+  switch (codec) {
+    case CodecType::H264:
+      return ScanNals(data, size, H264Nal);
+    case CodecType::HEVC:
+      return ScanNals(data, size, [](const uint8_t* nal, size_t nal_size) {
+        return nal_size >= 2 ? HEVCNal(nal, nal_size) : Verdict::kUnknown;
+      });
+    case CodecType::VP8:
+      return (data[0] & 0x01) == 0;
+    case CodecType::VP9:
+      return IsVP9Key(data, size);
+    case CodecType::AV1:
+      return IsAV1Key(data, size);
+    default:
+      return true;
+  }
+}
+
+}  // namespace media
\ No newline at end of file
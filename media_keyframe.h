@@ -0,0 +1,22 @@
+#ifndef MEDIA_KEYFRAME_H_
+#define MEDIA_KEYFRAME_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "media_video_frame.h"
+
+namespace media {
+
+// Reads just enough of a compressed packet to tell whether the decoder
+// would keep it with skip_frame = AVDISCARD_NONKEY, so packets that would
+// be discarded anyway can be dropped before they reach the decoder:
+// - H264: IDR slices and I/SI slices (Annex B or 4-byte length prefixes)
+// - HEVC: IRAP pictures (BLA, IDR, CRA)
+// - VP8, VP9 and AV1: key frames
+// Returns true when the packet cannot be parsed, so nothing is lost.
+bool IsKeyframePacket(CodecType codec, const uint8_t* data, size_t size);
+
+}  // namespace media
+
+#endif  // MEDIA_KEYFRAME_H_
\ No newline at end of file
@@ -0,0 +1,394 @@
+#include "media_ladder_encoder.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <typeinfo>
+#include <utility>
+
+#include "media_image_utils.h"
+
+namespace media {
+
+namespace {
+
+// Pyramid planes are aligned so encoders can read them in place
+const int kPlaneAlignment = 32;
+
+int AlignUp(int value) {
+  return (value + kPlaneAlignment - 1) & ~(kPlaneAlignment - 1);
+}
+
+// Applies the shared GOP length, keeping any other advanced parameters
+template <typename Params>
+void SetLadderGop(VideoEncoderConfig* config, int keyframe_interval) {
+  Params params;
+  if (config->codec_params && typeid(*config->codec_params) == typeid(Params)) {
+    params = *static_cast<const Params*>(config->codec_params.get());
+  }
+  params.keyframe_interval = keyframe_interval;
+  config->codec_params.reset(new Params(params));
+}
+
+// Scene cuts are decided by the ladder, so the encoder must not add its own
+template <typename Params>
+void SetLadderGopWithoutSceneCut(VideoEncoderConfig* config, int keyframe_interval) {
+  SetLadderGop<Params>(config, keyframe_interval);
+  static_cast<Params*>(config->codec_params.get())->scenecut = 0;
+}
+
+// Same for libvpx and libaom, which have no scene cut threshold
+template <typename Params>
+void SetLadderGopWithoutAutoKeyframes(VideoEncoderConfig* config, int keyframe_interval) {
+  SetLadderGop<Params>(config, keyframe_interval);
+  static_cast<Params*>(config->codec_params.get())->auto_keyframes = false;
+}
+
+void ApplyLadderGop(VideoEncoderConfig* config, int keyframe_interval) {
+  switch (config->output_codec) {
+    case CodecType::H264:
+      SetLadderGopWithoutSceneCut<codec::H264Params>(config, keyframe_interval);
+      break;
+    case CodecType::HEVC:
+      // Forced keyframes must be IDR pictures, or CRA leading pictures
+      // would reference the previous segment
+      SetLadderGopWithoutSceneCut<codec::HEVCParams>(config, keyframe_interval);
+      static_cast<codec::HEVCParams*>(config->codec_params.get())->forced_idr = true;
+      break;
+    case CodecType::VP8:
+      SetLadderGopWithoutAutoKeyframes<codec::VP8Params>(config, keyframe_interval);
+      break;
+    case CodecType::VP9:
+      SetLadderGopWithoutAutoKeyframes<codec::VP9Params>(config, keyframe_interval);
+      break;
+    case CodecType::AV1:
+      SetLadderGopWithoutAutoKeyframes<codec::AV1Params>(config, keyframe_interval);
+      break;
+  }
+}
+
+// One rendition: its encoder and the pyramid level it is fed from
+struct Rung {
+  std::unique_ptr<VideoEncoder> encoder;
+  int width = 0;
+  int height = 0;
+  int parent = -1;                   // Rung this level is scaled from (-1 = source)
+  bool same_as_source = false;       // Encoded straight from the source planes
+  std::vector<uint8_t> buffer;       // Storage behind |planes|
+  uint8_t* planes[3] = {nullptr, nullptr, nullptr};
+  int strides[3] = {0, 0, 0};
+  VideoFrameView view;               // Picture handed to the encoder
+  bool result = false;               // Outcome of the last job
+};
+
+class LadderEncoderImpl : public LadderEncoder {
+ public:
+  explicit LadderEncoderImpl(const LadderEncoderConfig& config) : config_(config) {
+    if (config_.keyframe_interval <= 0) {
+      config_.keyframe_interval = 120;
+    }
+  }
+
+  ~LadderEncoderImpl() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    work_cond_.notify_all();
+
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  bool Initialize() {
+    if (config_.width <= 0 || config_.height <= 0 || config_.renditions.empty()) {
+      std::cerr << "Invalid ladder configuration" << std::endl;
+      return false;
+    }
+
+    rungs_.resize(config_.renditions.size());
+    for (size_t i = 0; i < rungs_.size(); i++) {
+      VideoEncoderConfig rung_config = config_.renditions[i];
+      if (rung_config.width <= 0 || rung_config.height <= 0 ||
+          rung_config.width > config_.width || rung_config.height > config_.height) {
+        std::cerr << "Rendition " << i << " must fit inside the source" << std::endl;
+        return false;
+      }
+      ApplyLadderGop(&rung_config, config_.keyframe_interval);
+
+      Rung& rung = rungs_[i];
+      rung.encoder = VideoEncoder::Create(rung_config);
+      if (!rung.encoder) {
+        std::cerr << "Failed to create encoder for rendition " << i << std::endl;
+        return false;
+      }
+      rung.width = rung_config.width;
+      rung.height = rung_config.height;
+      rung.same_as_source = rung.width == config_.width && rung.height == config_.height;
+    }
+
+    BuildPyramid();
+
+    if (config_.parallel && rungs_.size() > 1) {
+      for (size_t i = 0; i < rungs_.size(); i++) {
+        workers_.emplace_back(&LadderEncoderImpl::WorkerLoop, this, i);
+      }
+    }
+    return true;
+  }
+
+  bool Encode(const VideoFrameView& frame,
+              std::vector<std::vector<EncodedPacket>>* packets) override {
+    if (!packets) {
+      return false;
+    }
+    if (frame.width != config_.width || frame.height != config_.height) {
+      std::cerr << "Frame dimensions " << frame.width << "x" << frame.height
+                << " do not match ladder " << config_.width << "x"
+                << config_.height << std::endl;
+      return false;
+    }
+
+    if (!ScalePyramid(frame)) {
+      return false;
+    }
+
+    const bool keyframe = DecideKeyframe(frame);
+    for (Rung& rung : rungs_) {
+      rung.view.pts = frame.pts;
+      rung.view.force_keyframe = keyframe;
+    }
+
+    packets->assign(rungs_.size(), std::vector<EncodedPacket>());
+    return Run(false, packets);
+  }
+
+  bool Flush(std::vector<std::vector<EncodedPacket>>* packets) override {
+    if (!packets) {
+      return false;
+    }
+
+    packets->assign(rungs_.size(), std::vector<EncodedPacket>());
+    return Run(true, packets);
+  }
+
+  size_t GetRenditionCount() const override {
+    return rungs_.size();
+  }
+
+  LadderEncoderConfig GetConfig() const override {
+    return config_;
+  }
+
+ private:
+  // Orders the levels largest first and picks, for each one, the closest
+  // larger level to scale from. Allocates the aligned pyramid planes.
+  void BuildPyramid() {
+    scale_order_.clear();
+    for (size_t i = 0; i < rungs_.size(); i++) {
+      if (!rungs_[i].same_as_source) {
+        scale_order_.push_back(static_cast<int>(i));
+      }
+    }
+    std::sort(scale_order_.begin(), scale_order_.end(), [this](int a, int b) {
+      return rungs_[a].width * rungs_[a].height > rungs_[b].width * rungs_[b].height;
+    });
+
+    for (size_t i = 0; i < scale_order_.size(); i++) {
+      Rung& rung = rungs_[scale_order_[i]];
+      rung.parent = -1;
+      for (size_t j = i; j-- > 0;) {
+        const Rung& larger = rungs_[scale_order_[j]];
+        if (larger.width >= rung.width && larger.height >= rung.height) {
+          rung.parent = scale_order_[j];
+          break;
+        }
+      }
+
+      const int chroma_width = (rung.width + 1) / 2;
+      const int chroma_height = (rung.height + 1) / 2;
+      const size_t y_size = static_cast<size_t>(AlignUp(rung.width)) * rung.height;
+      const size_t c_size = static_cast<size_t>(AlignUp(chroma_width)) * chroma_height;
+      rung.buffer.resize(y_size + 2 * c_size + kPlaneAlignment);
+
+      // Start the planes on an aligned address inside the buffer
+      uint8_t* base = rung.buffer.data();
+      base += (kPlaneAlignment - reinterpret_cast<uintptr_t>(base) % kPlaneAlignment) %
+              kPlaneAlignment;
+
+      rung.planes[0] = base;
+      rung.planes[1] = base + y_size;
+      rung.planes[2] = base + y_size + c_size;
+      rung.strides[0] = AlignUp(rung.width);
+      rung.strides[1] = AlignUp(chroma_width);
+      rung.strides[2] = AlignUp(chroma_width);
+
+      rung.view = VideoFrameView();
+      rung.view.width = rung.width;
+      rung.view.height = rung.height;
+      for (int p = 0; p < 3; p++) {
+        rung.view.data[p] = rung.planes[p];
+        rung.view.stride[p] = rung.strides[p];
+      }
+    }
+  }
+
+  // Fills every pyramid level for |frame|, each from its parent level
+  bool ScalePyramid(const VideoFrameView& frame) {
+    for (Rung& rung : rungs_) {
+      if (rung.same_as_source) {
+        rung.view = frame;
+      }
+    }
+
+    for (int index : scale_order_) {
+      Rung& rung = rungs_[index];
+      const VideoFrameView& src = rung.parent < 0 ? frame : rungs_[rung.parent].view;
+      if (!image_utils_.ScaleYUV420(src, rung.planes, rung.strides, rung.width, rung.height)) {
+        std::cerr << "Failed to scale rendition " << index << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Keyframe on the shared interval, or on a scene cut measured on the
+  // smallest pyramid level
+  bool DecideKeyframe(const VideoFrameView& frame) {
+    const VideoFrameView& probe = scale_order_.empty() ? frame : rungs_[scale_order_.back()].view;
+    const int difference = LumaDifference(probe);
+
+    bool keyframe = frame_count_ == 0 || frames_since_keyframe_ >= config_.keyframe_interval;
+    if (!keyframe && config_.scene_cut_threshold > 0 &&
+        difference >= config_.scene_cut_threshold &&
+        frames_since_keyframe_ >= config_.min_keyframe_interval) {
+      keyframe = true;
+    }
+
+    frame_count_++;
+    frames_since_keyframe_ = keyframe ? 1 : frames_since_keyframe_ + 1;
+    return keyframe;
+  }
+
+  // Mean absolute difference against the previous probe luma, then keeps
+  // a copy of this one. Returns 0 for the first frame.
+  int LumaDifference(const VideoFrameView& probe) {
+    const size_t size = static_cast<size_t>(probe.width) * probe.height;
+    const bool has_previous = previous_luma_.size() == size;
+
+    uint64_t sum = 0;
+    previous_luma_.resize(size);
+    for (int y = 0; y < probe.height; y++) {
+      const uint8_t* row = probe.data[0] + static_cast<size_t>(y) * probe.stride[0];
+      uint8_t* previous = previous_luma_.data() + static_cast<size_t>(y) * probe.width;
+      if (has_previous) {
+        for (int x = 0; x < probe.width; x++) {
+          sum += std::abs(static_cast<int>(row[x]) - previous[x]);
+        }
+      }
+      std::copy(row, row + probe.width, previous);
+    }
+
+    return has_previous && size > 0 ? static_cast<int>(sum / size) : 0;
+  }
+
+  // Runs one encode or flush on every rung, concurrently when workers exist
+  bool Run(bool flush, std::vector<std::vector<EncodedPacket>>* packets) {
+    if (workers_.empty()) {
+      bool result = true;
+      for (size_t i = 0; i < rungs_.size(); i++) {
+        result = RunRung(i, flush, &(*packets)[i]) && result;
+      }
+      return result;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    flush_ = flush;
+    outputs_ = packets;
+    remaining_ = rungs_.size();
+    generation_++;
+    work_cond_.notify_all();
+    done_cond_.wait(lock, [this] { return remaining_ == 0; });
+    outputs_ = nullptr;
+
+    bool result = true;
+    for (const Rung& rung : rungs_) {
+      result = result && rung.result;
+    }
+    return result;
+  }
+
+  bool RunRung(size_t index, bool flush, std::vector<EncodedPacket>* packets) {
+    Rung& rung = rungs_[index];
+    rung.result = flush ? rung.encoder->Flush(packets)
+                        : rung.encoder->EncodeYUV420(rung.view, packets);
+    if (!rung.result) {
+      std::cerr << (flush ? "Flush" : "Encode") << " failed for rendition "
+                << index << std::endl;
+    }
+    return rung.result;
+  }
+
+  void WorkerLoop(size_t index) {
+    uint64_t seen = 0;
+    while (true) {
+      bool flush = false;
+      std::vector<EncodedPacket>* output = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_cond_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) {
+          return;
+        }
+        seen = generation_;
+        flush = flush_;
+        output = &(*outputs_)[index];
+      }
+
+      RunRung(index, flush, output);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--remaining_ == 0) {
+        done_cond_.notify_one();
+      }
+    }
+  }
+
+  LadderEncoderConfig config_;
+  std::vector<Rung> rungs_;
+  std::vector<int> scale_order_;  // Scaled rungs, largest first
+  ImageUtils image_utils_;
+
+  // Keyframe decisions
+  uint64_t frame_count_ = 0;
+  int frames_since_keyframe_ = 0;
+  std::vector<uint8_t> previous_luma_;
+
+  // Rung workers
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_cond_;
+  std::condition_variable done_cond_;
+  uint64_t generation_ = 0;
+  size_t remaining_ = 0;
+  bool flush_ = false;
+  bool stopping_ = false;
+  std::vector<std::vector<EncodedPacket>>* outputs_ = nullptr;
+};
+
+}  // namespace
+
+std::unique_ptr<LadderEncoder> LadderEncoder::Create(const LadderEncoderConfig& config) {
+  std::unique_ptr<LadderEncoderImpl> ladder(new LadderEncoderImpl(config));
+  if (!ladder->Initialize()) {
+    return nullptr;
+  }
+  return std::unique_ptr<LadderEncoder>(ladder.release());
+}
+
+} // namespace media
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef MEDIA_LADDER_ENCODER_H_
+#define MEDIA_LADDER_ENCODER_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "media_encoded_packet.h"
+#include "media_video_encoder.h"
+#include "media_video_frame.h"
+
+namespace media {
+
+// Rendition ladder options for LadderEncoder
+struct LadderEncoderConfig {
+  int width = 0;   // Source frame width
+  int height = 0;  // Source frame height
+
+  // One encoder per rung, each at its own output size. Codec, bitrate and
+  // advanced parameters are taken as given; the GOP settings are replaced
+  // by the shared ones below.
+  std::vector<VideoEncoderConfig> renditions;
+
+  // Frames between keyframes, shared by every rung
+  int keyframe_interval = 120;
+
+  // Mean absolute luma difference (0-255) between consecutive frames that
+  // starts a new GOP in every rung (0 = no scene cut keyframes)
+  int scene_cut_threshold = 30;
+
+  // Minimum number of frames between two scene cut keyframes
+  int min_keyframe_interval = 12;
+
+  // Encode the rungs concurrently, one thread per rung
+  bool parallel = true;
+};
+
+// Encodes one source into several renditions at once. Each source frame is
+// downscaled once into a pyramid, largest rung first, with every rung scaled
+// from the closest larger one. Keyframes are decided by the ladder (fixed
+// interval plus scene cuts detected on the smallest level) and forced on all
+// rungs together, so GOPs and segment boundaries line up across renditions.
+class LadderEncoder {
+ public:
+  // Factory method to create a ladder; returns nullptr if any rung fails
+  static std::unique_ptr<LadderEncoder> Create(const LadderEncoderConfig& config);
+
+  virtual ~LadderEncoder() = default;
+
+  // Encode one source frame in every rendition. |packets| receives one list
+  // per rendition, in the order of LadderEncoderConfig::renditions.
+  virtual bool Encode(const VideoFrameView& frame,
+                      std::vector<std::vector<EncodedPacket>>* packets) = 0;
+
+  // Drain every rung, one packet list per rendition
+  virtual bool Flush(std::vector<std::vector<EncodedPacket>>* packets) = 0;
+
+  // Number of renditions
+  virtual size_t GetRenditionCount() const = 0;
+
+  // Get the current configuration
+  virtual LadderEncoderConfig GetConfig() const = 0;
+};
+
+} // namespace media
+
+#endif  // MEDIA_LADDER_ENCODER_H_
\ No newline at end of file
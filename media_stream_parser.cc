@@ -0,0 +1,195 @@
+#include "media_stream_parser.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+namespace media {
+
+namespace {
+
+constexpr int kObuTemporalDelimiter = 2;
+
+// Length of the temporal unit at the start of |data|, or 0 if it may
+// continue past |size|. A unit ends where the next temporal delimiter OBU
+// begins; OBUs without a size field run to the end of the data.
+size_t TemporalUnitSize(const uint8_t* data, size_t size) {
+  size_t pos = 0;
+  while (pos < size) {
+    const uint8_t header = data[pos];
+    const int type = (header >> 3) & 0x0F;
+    if (type == kObuTemporalDelimiter && pos > 0) {
+      return pos;
+    }
+    if (!(header & 0x02)) {
+      return size;
+    }
+
+    size_t cursor = pos + ((header & 0x04) ? 2 : 1);
+    uint64_t obu_size = 0;
+    bool complete = false;
+    for (int i = 0; i < 8 && cursor < size; i++) {
+      const uint8_t byte = data[cursor++];
+      obu_size |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+      if (!(byte & 0x80)) {
+        complete = true;
+        break;
+      }
+    }
+    if (!complete || obu_size > size - cursor) {
+      return 0;
+    }
+    pos = cursor + static_cast<size_t>(obu_size);
+  }
+  return 0;
+}
+
+int ToCodecId(CodecType codec) {
+  switch (codec) {
+    case CodecType::H264:
+      return AV_CODEC_ID_H264;
+    case CodecType::HEVC:
+      return AV_CODEC_ID_HEVC;
+    default:
+      return AV_CODEC_ID_NONE;
+  }
+}
+
+}  // namespace
+
+StreamParser::StreamParser(CodecType codec) : codec_(codec) {}
+
+StreamParser::~StreamParser() {
+  if (parser_) {
+    av_parser_close(parser_);
+  }
+}
+
+void StreamParser::Feed(const uint8_t* data, size_t size) {
+  if (!data || size == 0) {
+    end_of_stream_ = true;
+    return;
+  }
+
+  // A temporal unit left over from the last chunk is completed in place
+  if (carry_pos_ < carry_.size()) {
+    carry_.erase(carry_.begin(), carry_.begin() + carry_pos_);
+    carry_pos_ = 0;
+    carry_.insert(carry_.end(), data, data + size);
+    return;
+  }
+
+  carry_.clear();
+  carry_pos_ = 0;
+  input_ = data;
+  input_size_ = size;
+}
+
+bool StreamParser::Next(AVCodecContext* context, AVPacket* packet) {
+  if (!packet) {
+    return false;
+  }
+  // The packet only borrows the data, so no earlier buffer may stay attached
+  av_packet_unref(packet);
+  return codec_ == CodecType::AV1 ? NextTemporalUnit(packet) : NextParsed(context, packet);
+}
+
+void StreamParser::Reset() {
+  if (parser_) {
+    av_parser_close(parser_);
+    parser_ = nullptr;
+  }
+  input_ = nullptr;
+  input_size_ = 0;
+  end_of_stream_ = false;
+  carry_.clear();
+  carry_pos_ = 0;
+}
+
+bool StreamParser::NextParsed(AVCodecContext* context, AVPacket* packet) {
+  if (!parser_) {
+    parser_ = av_parser_init(ToCodecId(codec_));
+    if (!parser_) {
+      std::cerr << "Could not initialize stream parser" << std::endl;
+      return false;
+    }
+  }
+
+  while (input_size_ > 0 || end_of_stream_) {
+    // An empty buffer asks the parser for the unit it is holding back
+    const int chunk = static_cast<int>(std::min(input_size_, static_cast<size_t>(INT_MAX)));
+    uint8_t* data = nullptr;
+    int size = 0;
+    const int used = av_parser_parse2(parser_, context, &data, &size,
+                                      chunk > 0 ? input_ : nullptr, chunk,
+                                      AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+    if (used < 0) {
+      std::cerr << "Error while parsing stream" << std::endl;
+      input_size_ = 0;
+      end_of_stream_ = false;
+      return false;
+    }
+    input_ += used;
+    input_size_ -= static_cast<size_t>(used);
+
+    if (size > 0) {
+      packet->data = data;
+      packet->size = size;
+      return true;
+    }
+    if (chunk == 0) {
+      // Flushed; the parser starts over with the next chunk
+      end_of_stream_ = false;
+      av_parser_close(parser_);
+      parser_ = nullptr;
+    } else if (used == 0) {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool StreamParser::NextTemporalUnit(AVPacket* packet) {
+  const bool from_carry = carry_pos_ < carry_.size();
+  const uint8_t* data = from_carry ? carry_.data() + carry_pos_ : input_;
+  const size_t available = from_carry ? carry_.size() - carry_pos_ : input_size_;
+  if (available == 0) {
+    end_of_stream_ = false;
+    return false;
+  }
+
+  size_t size = TemporalUnitSize(data, available);
+  if (size == 0) {
+    if (!end_of_stream_) {
+      // Keep the incomplete unit until the next chunk arrives
+      if (!from_carry) {
+        carry_.assign(data, data + available);
+        carry_pos_ = 0;
+        input_size_ = 0;
+      }
+      return false;
+    }
+    size = available;
+  }
+  if (size > static_cast<size_t>(INT_MAX)) {
+    std::cerr << "Temporal unit too large" << std::endl;
+    Reset();
+    return false;
+  }
+
+  packet->data = const_cast<uint8_t*>(data);
+  packet->size = static_cast<int>(size);
+  if (from_carry) {
+    carry_pos_ += size;
+  } else {
+    input_ += size;
+    input_size_ -= size;
+  }
+  return true;
+}
+
+}  // namespace media
\ No newline at end of file
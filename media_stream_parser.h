@@ -0,0 +1,64 @@
+#ifndef MEDIA_STREAM_PARSER_H_
+#define MEDIA_STREAM_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "media_video_frame.h"
+
+// Forward declarations for FFmpeg structs
+extern "C" {
+struct AVCodecContext;
+struct AVCodecParserContext;
+struct AVPacket;
+}
+
+namespace media {
+
+// Splits an elementary stream that arrives in chunks of any size into the
+// access units a decoder takes. H264 and HEVC (Annex B) go through
+// av_parser_parse2; AV1 (low-overhead OBU stream) is cut at temporal
+// delimiters, since FFmpeg's AV1 parser expects whole temporal units.
+// Chunks are read in place. Only for AV1, a unit that spans two chunks is
+// buffered together with the chunk that completes it.
+class StreamParser {
+ public:
+  explicit StreamParser(CodecType codec);
+  ~StreamParser();
+
+  StreamParser(const StreamParser&) = delete;
+  StreamParser& operator=(const StreamParser&) = delete;
+
+  // Queues the next chunk, which must stay valid until Next() returns
+  // false. An empty chunk marks the end of the stream, so Next() also
+  // returns the last, unterminated unit.
+  void Feed(const uint8_t* data, size_t size);
+
+  // Points |packet| at the next complete unit without copying it. The data
+  // is valid until the following call. Returns false when more input is
+  // needed or on a parser error.
+  bool Next(AVCodecContext* context, AVPacket* packet);
+
+  // Drops buffered bytes, e.g. after a seek
+  void Reset();
+
+ private:
+  bool NextParsed(AVCodecContext* context, AVPacket* packet);
+  bool NextTemporalUnit(AVPacket* packet);
+
+  CodecType codec_;
+  AVCodecParserContext* parser_ = nullptr;
+
+  const uint8_t* input_ = nullptr;
+  size_t input_size_ = 0;
+  bool end_of_stream_ = false;
+
+  // Tail of an earlier chunk holding an incomplete AV1 temporal unit
+  std::vector<uint8_t> carry_;
+  size_t carry_pos_ = 0;
+};
+
+}  // namespace media
+
+#endif  // MEDIA_STREAM_PARSER_H_
\ No newline at end of file
@@ -0,0 +1,442 @@
+#include "media_video_decoder.h"
+
+#include <iostream>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include "h264_decoder.h"
+#include "hevc_decoder.h"
+#include "vp8_decoder.h"
+#include "vp9_decoder.h"
+#include "av1_decoder.h"
+#include "media_image_utils.h"
+#include "media_keyframe.h"
+
+namespace media {
+
+namespace {
+
+// Parts shared by every codec: the configuration, packet-level keyframe
+// filtering and thumbnail scaling
+class DecoderBase : public VideoDecoder {
+ public:
+  explicit DecoderBase(const VideoDecoderConfig& config) : config_(config) {}
+
+  int DecodeThumbnail(const std::vector<uint8_t>& packet,
+                      int width, int height,
+                      std::vector<uint8_t>* yuv) override {
+    if (!yuv || width <= 0 || height <= 0) return -1;
+
+    DecodedFrame frame;
+    int ret = Decode(packet, &frame);
+    if (ret <= 0) {
+      return ret;
+    }
+
+    ImageView src;
+    switch (frame.pixel_format()) {
+      case AV_PIX_FMT_YUV420P:
+      case AV_PIX_FMT_YUVJ420P:
+        src.format = ImageFormat::YUV420P;
+        break;
+      case AV_PIX_FMT_NV12:
+        src.format = ImageFormat::NV12;
+        break;
+      default:
+        std::cerr << "Cannot scale decoded pixel format " << frame.pixel_format() << std::endl;
+        return -1;
+    }
+    src.width = frame.width();
+    src.height = frame.height();
+    for (int i = 0; i < 3; i++) {
+      src.data[i] = frame.data(i);
+      src.stride[i] = frame.stride(i);
+    }
+
+    const int chroma_width = (width + 1) / 2;
+    yuv->resize(YUV420BufferSize(width, height));
+    MutableImageView dst;
+    dst.format = ImageFormat::YUV420P;
+    dst.width = width;
+    dst.height = height;
+    dst.data[0] = yuv->data();
+    dst.data[1] = dst.data[0] + static_cast<size_t>(width) * height;
+    dst.data[2] = dst.data[1] + static_cast<size_t>(chroma_width) * ((height + 1) / 2);
+    dst.stride[0] = width;
+    dst.stride[1] = chroma_width;
+    dst.stride[2] = chroma_width;
+
+    if (!scaler_) {
+      scaler_.reset(new ImageUtils());
+    }
+    if (!*scaler_) {
+      std::cerr << "Failed to create thumbnail scaler" << std::endl;
+      return -1;
+    }
+    // Thumbnails are large downscales, where a box filter keeps detail
+    return scaler_->ConvertAndScale(src, dst, ScaleFilter::AREA) ? 1 : -1;
+  }
+
+  int DecodeFrames(const std::vector<uint8_t>& packet,
+                   std::vector<DecodedFrame>* frames) override {
+    if (!frames) return -1;
+
+    DecodedFrame frame;
+    int ret = Decode(packet, &frame);
+    if (ret < 0) {
+      return ret;
+    }
+    int count = 0;
+    if (ret > 0) {
+      frames->push_back(frame);
+      count++;
+    }
+    return count + ReceiveFrames(frames);
+  }
+
+  VideoDecoderConfig GetConfig() const override {
+    return config_;
+  }
+
+ protected:
+  // True if keyframes_only is set and the decoder would discard |packet|
+  bool SkipPacket(const std::vector<uint8_t>& packet) const {
+    return config_.keyframes_only &&
+           !IsKeyframePacket(config_.input_codec, packet.data(), packet.size());
+  }
+
+  VideoDecoderConfig config_;
+
+ private:
+  std::unique_ptr<ImageUtils> scaler_;
+};
+
+// H264 decoder implementation
+class H264DecoderImpl : public DecoderBase {
+ public:
+  explicit H264DecoderImpl(const VideoDecoderConfig& config) : DecoderBase(config) {
+    H264DecoderConfig h264_config;
+    h264_config.width = config.width;
+    h264_config.height = config.height;
+    h264_config.thread_count = config.threads;
+    h264_config.low_delay = config.low_delay;
+    h264_config.extradata = config.extradata;
+    // H264Decoder drops non-key packets itself
+    h264_config.keyframes_only = config.keyframes_only;
+
+    decoder_ = H264Decoder::Create(h264_config);
+  }
+
+  bool IsValid() const { return decoder_ != nullptr; }
+
+  int Decode(const std::vector<uint8_t>& packet, DecodedFrame* frame) override {
+    if (!frame) return -1;
+    *frame = DecodedFrame();
+    return decoder_->Decode(frame, &packet);
+  }
+
+  int ReceiveFrames(std::vector<DecodedFrame>* frames) override {
+    return decoder_->ReceiveFrames(frames);
+  }
+
+  int Flush(std::vector<DecodedFrame>* frames) override {
+    return decoder_->Flush(frames);
+  }
+
+  int GetDelay() const override {
+    return decoder_->GetDelay();
+  }
+
+  void Reset() override {
+    decoder_->Reset();
+  }
+
+  int GetWidth() const override {
+    int width = 0;
+    decoder_->GetFrameDimensions(&width, nullptr);
+    return width;
+  }
+
+  int GetHeight() const override {
+    int height = 0;
+    decoder_->GetFrameDimensions(nullptr, &height);
+    return height;
+  }
+
+ private:
+  std::unique_ptr<H264Decoder> decoder_;
+};
+
+// HEVC decoder implementation
+class HEVCDecoderImpl : public DecoderBase {
+ public:
+  explicit HEVCDecoderImpl(const VideoDecoderConfig& config) : DecoderBase(config) {
+    HEVCDecoderConfig hevc_config;
+    hevc_config.threads = config.threads;
+    hevc_config.low_latency = config.low_delay;
+    hevc_config.output_10bit = config.output_10bit;
+    hevc_config.extradata = config.extradata;
+    if (config.keyframes_only) {
+      hevc_config.skip_frame = AVDISCARD_NONKEY;
+    }
+
+    decoder_ = HEVCDecoder::Create(hevc_config);
+  }
+
+  bool IsValid() const { return decoder_ != nullptr; }
+
+  int Decode(const std::vector<uint8_t>& packet, DecodedFrame* frame) override {
+    if (!frame) return -1;
+    *frame = DecodedFrame();
+    if (SkipPacket(packet)) return 0;
+    return decoder_->Decode(frame, &packet);
+  }
+
+  int ReceiveFrames(std::vector<DecodedFrame>* frames) override {
+    return decoder_->ReceiveFrames(frames);
+  }
+
+  int Flush(std::vector<DecodedFrame>* frames) override {
+    return decoder_->Flush(frames);
+  }
+
+  int GetDelay() const override {
+    return decoder_->GetDelay();
+  }
+
+  void Reset() override {
+    decoder_->Flush();
+  }
+
+  int GetWidth() const override {
+    return decoder_->GetWidth();
+  }
+
+  int GetHeight() const override {
+    return decoder_->GetHeight();
+  }
+
+ private:
+  std::unique_ptr<HEVCDecoder> decoder_;
+};
+
+// VP8 decoder implementation
+class VP8DecoderImpl : public DecoderBase {
+ public:
+  explicit VP8DecoderImpl(const VideoDecoderConfig& config) : DecoderBase(config) {
+    vp8_config_.width = config.width;
+    vp8_config_.height = config.height;
+    vp8_config_.thread_count = config.threads;
+    vp8_config_.low_delay = config.low_delay;
+    vp8_config_.extradata = config.extradata;
+    if (config.keyframes_only) {
+      vp8_config_.skip_frame = AVDISCARD_NONKEY;
+    }
+
+    decoder_ = VP8Decoder::Create(vp8_config_);
+  }
+
+  bool IsValid() const { return decoder_ != nullptr; }
+
+  int Decode(const std::vector<uint8_t>& packet, DecodedFrame* frame) override {
+    if (!frame) return -1;
+    *frame = DecodedFrame();
+    if (SkipPacket(packet)) return 0;
+    if (!decoder_->Decode(packet, frame)) {
+      return -1;
+    }
+    if (frame->empty()) {
+      return 0;
+    }
+
+    width_ = frame->width();
+    height_ = frame->height();
+    return 1;
+  }
+
+  int ReceiveFrames(std::vector<DecodedFrame>* frames) override {
+    if (!frames) return 0;
+    int count = decoder_->ReceiveFrames(frames);
+    if (count > 0) {
+      width_ = frames->back().width();
+      height_ = frames->back().height();
+    }
+    return count;
+  }
+
+  int Flush(std::vector<DecodedFrame>* frames) override {
+    if (!frames) return 0;
+    int count = decoder_->Flush(frames);
+    if (count > 0) {
+      width_ = frames->back().width();
+      height_ = frames->back().height();
+    }
+    return count;
+  }
+
+  int GetDelay() const override {
+    return decoder_->GetDelay();
+  }
+
+  void Reset() override {
+    // VP8Decoder has no flush entry point, so start from a fresh instance
+    auto decoder = VP8Decoder::Create(vp8_config_);
+    if (decoder) {
+      decoder_ = decoder;
+    }
+  }
+
+  int GetWidth() const override {
+    return width_;
+  }
+
+  int GetHeight() const override {
+    return height_;
+  }
+
+ private:
+  VP8DecoderConfig vp8_config_;
+  std::shared_ptr<VP8Decoder> decoder_;
+  int width_ = 0;
+  int height_ = 0;
+};
+
+// VP9 decoder implementation
+class VP9DecoderImpl : public DecoderBase {
+ public:
+  explicit VP9DecoderImpl(const VideoDecoderConfig& config) : DecoderBase(config) {
+    VP9DecoderConfig vp9_config;
+    vp9_config.threads = config.threads;
+    vp9_config.low_delay = config.low_delay;
+    vp9_config.output_10bit = config.output_10bit;
+    if (config.keyframes_only) {
+      vp9_config.skip_frame = AVDISCARD_NONKEY;
+    }
+
+    decoder_ = VP9Decoder::Create(vp9_config);
+  }
+
+  bool IsValid() const { return decoder_ != nullptr; }
+
+  int Decode(const std::vector<uint8_t>& packet, DecodedFrame* frame) override {
+    if (!frame) return -1;
+    *frame = DecodedFrame();
+    if (SkipPacket(packet)) return 0;
+    return decoder_->Decode(packet, frame);
+  }
+
+  int ReceiveFrames(std::vector<DecodedFrame>* frames) override {
+    return decoder_->ReceiveFrames(frames);
+  }
+
+  int Flush(std::vector<DecodedFrame>* frames) override {
+    return decoder_->Flush(frames);
+  }
+
+  int GetDelay() const override {
+    return decoder_->GetDelay();
+  }
+
+  void Reset() override {
+    decoder_->Reset();
+  }
+
+  int GetWidth() const override {
+    return decoder_->GetWidth();
+  }
+
+  int GetHeight() const override {
+    return decoder_->GetHeight();
+  }
+
+ private:
+  std::unique_ptr<VP9Decoder> decoder_;
+};
+
+// AV1 decoder implementation
+class AV1DecoderImpl : public DecoderBase {
+ public:
+  explicit AV1DecoderImpl(const VideoDecoderConfig& config) : DecoderBase(config) {
+    AV1DecoderConfig av1_config;
+    av1_config.threads = config.threads;
+    av1_config.low_delay = config.low_delay;
+    av1_config.output_10bit = config.output_10bit;
+    av1_config.extradata = config.extradata;
+    if (config.keyframes_only) {
+      av1_config.skip_frames = AVDISCARD_NONKEY;
+    }
+
+    decoder_ = AV1Decoder::Create(av1_config);
+  }
+
+  bool IsValid() const { return decoder_ != nullptr; }
+
+  int Decode(const std::vector<uint8_t>& packet, DecodedFrame* frame) override {
+    if (!frame) return -1;
+    *frame = DecodedFrame();
+    if (SkipPacket(packet)) return 0;
+    return decoder_->Decode(frame, &packet);
+  }
+
+  int ReceiveFrames(std::vector<DecodedFrame>* frames) override {
+    return decoder_->ReceiveFrames(frames);
+  }
+
+  int Flush(std::vector<DecodedFrame>* frames) override {
+    return decoder_->Flush(frames);
+  }
+
+  int GetDelay() const override {
+    return decoder_->GetDelay();
+  }
+
+  void Reset() override {
+    decoder_->Reset();
+  }
+
+  int GetWidth() const override {
+    return decoder_->GetWidth();
+  }
+
+  int GetHeight() const override {
+    return decoder_->GetHeight();
+  }
+
+ private:
+  std::unique_ptr<AV1Decoder> decoder_;
+};
+
+// Returns |decoder| if the underlying codec opened, nullptr otherwise
+template <typename T>
+std::unique_ptr<VideoDecoder> CheckDecoder(std::unique_ptr<T> decoder) {
+  if (!decoder->IsValid()) {
+    std::cerr << "Failed to create video decoder" << std::endl;
+    return nullptr;
+  }
+  return std::unique_ptr<VideoDecoder>(decoder.release());
+}
+
+}  // namespace
+
+// Factory method implementation
+std::unique_ptr<VideoDecoder> VideoDecoder::Create(const VideoDecoderConfig& config) {
+  switch (config.input_codec) {
+    case CodecType::H264:
+      return CheckDecoder(std::unique_ptr<H264DecoderImpl>(new H264DecoderImpl(config)));
+    case CodecType::HEVC:
+      return CheckDecoder(std::unique_ptr<HEVCDecoderImpl>(new HEVCDecoderImpl(config)));
+    case CodecType::VP8:
+      return CheckDecoder(std::unique_ptr<VP8DecoderImpl>(new VP8DecoderImpl(config)));
+    case CodecType::VP9:
+      return CheckDecoder(std::unique_ptr<VP9DecoderImpl>(new VP9DecoderImpl(config)));
+    case CodecType::AV1:
+      return CheckDecoder(std::unique_ptr<AV1DecoderImpl>(new AV1DecoderImpl(config)));
+    default:
+      std::cerr << "Unsupported codec type" << std::endl;
+      return nullptr;
+  }
+}
+
+} // namespace media
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef MEDIA_VIDEO_DECODER_H_
+#define MEDIA_VIDEO_DECODER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "media_decoded_frame.h"
+#include "media_video_frame.h"
+
+namespace media {
+
+// Generic video decoder configuration
+struct VideoDecoderConfig {
+  CodecType input_codec = CodecType::H264;  // Input codec type
+
+  // Frame dimensions (0 if unknown, detected from the stream). Only H264
+  // and VP8 use them as a hint; HEVC, VP9 and AV1 always read the stream.
+  int width = 0;
+  int height = 0;
+
+  // Threading and latency options shared by all codecs
+  int threads = 0;         // Number of decoding threads (0 = auto)
+  bool low_delay = false;  // Output frames as soon as possible
+
+  // HEVC, VP9 and AV1: hand out 10-bit streams as native YUV420P10 frames
+  // (DecodedFrame::bit_depth() == 10) instead of rounding them to 8 bits
+  bool output_10bit = false;
+
+  // Decode keyframes only (AVDISCARD_NONKEY). Other packets are recognized
+  // from their headers and dropped before they reach the decoder, so a
+  // seek-thumbnail pass costs one decode per keyframe.
+  bool keyframes_only = false;
+
+  // Codec extradata (SPS/PPS, VPS or sequence header), empty if in-band.
+  // VP9 carries everything in-band and ignores it.
+  std::vector<uint8_t> extradata;
+};
+
+// Video decoder interface
+class VideoDecoder {
+ public:
+  // Factory method to create a decoder instance
+  static std::unique_ptr<VideoDecoder> Create(const VideoDecoderConfig& config);
+
+  // Virtual destructor
+  virtual ~VideoDecoder() = default;
+
+  // Decode one compressed packet. |frame| references the decoder's buffers
+  // and is left empty when no picture is ready yet. An empty packet ends
+  // the stream; each such call then hands out one of the remaining
+  // pictures until 0 is returned.
+  // Returns 1 if a frame was output, 0 if more data is needed, negative on error
+  virtual int Decode(const std::vector<uint8_t>& packet, DecodedFrame* frame) = 0;
+
+  // Decode() returns at most one frame per packet. With frame threading a
+  // packet can release several, so call this after each Decode() to
+  // collect the rest; they are appended to |frames| in output order.
+  // Returns the number of frames appended
+  virtual int ReceiveFrames(std::vector<DecodedFrame>* frames) = 0;
+
+  // Decode one packet and append every frame it released to |frames|, so
+  // nothing piles up inside the decoder.
+  // Returns the number of frames appended, negative on error
+  virtual int DecodeFrames(const std::vector<uint8_t>& packet,
+                           std::vector<DecodedFrame>* frames) = 0;
+
+  // End of stream: append every picture the decoder still holds (reorder
+  // buffer, frame threads) to |frames| and get ready for a new stream.
+  // Returns the number of frames appended
+  virtual int Flush(std::vector<DecodedFrame>* frames) = 0;
+
+  // Frames the decoder holds back before output (reorder buffer plus frame
+  // threads), i.e. how far output lags input. Known once a frame is out.
+  virtual int GetDelay() const = 0;
+
+  // Decode one packet like Decode() and scale the picture into |yuv| as
+  // |width| x |height| I420, resizing it to YUV420BufferSize(). Meant for
+  // thumbnails together with keyframes_only.
+  // Returns 1 if a frame was output, 0 if more data is needed, negative on error
+  virtual int DecodeThumbnail(const std::vector<uint8_t>& packet,
+                              int width, int height,
+                              std::vector<uint8_t>* yuv) = 0;
+
+  // Discard buffered state, e.g. before seeking
+  virtual void Reset() = 0;
+
+  // Dimensions of the last decoded frame
+  virtual int GetWidth() const = 0;
+  virtual int GetHeight() const = 0;
+
+  // Get current decoder configuration
+  virtual VideoDecoderConfig GetConfig() const = 0;
+};
+
+} // namespace media
+
+#endif  // MEDIA_VIDEO_DECODER_H_
\ No newline at end of file
@@ -1,9 +1,19 @@
 #include "media_video_encoder.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <string>
 #include <typeinfo>
+#include <utility>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+#include "media_color_convert.h"
 
 #include "h264_encoder.h"
 #include "hevc_encoder.h"
@@ -19,7 +29,57 @@
 
 namespace media {
 
+int InputBitDepth(PixelFormat format) {
+  return format == PixelFormat::YUV420P10 || format == PixelFormat::P010 ? 10 : 8;
+}
+
 // Default implementation for methods that are not always required
+bool VideoEncoder::EncodeYUV420(const VideoFrameView& frame,
+                               std::vector<uint8_t>* encoded_frame) {
+  // Default implementation: repack the planes into a contiguous buffer
+  const int chroma_width = (frame.width + 1) / 2;
+  const int chroma_height = (frame.height + 1) / 2;
+  std::vector<uint8_t> yuv_data(frame.width * frame.height +
+                                2 * chroma_width * chroma_height);
+
+  uint8_t* dst = yuv_data.data();
+  for (int plane = 0; plane < 3; plane++) {
+    const int plane_width = plane == 0 ? frame.width : chroma_width;
+    const int plane_height = plane == 0 ? frame.height : chroma_height;
+    if (!frame.data[plane] || frame.stride[plane] < plane_width) {
+      std::cerr << "Invalid frame planes or strides" << std::endl;
+      return false;
+    }
+    for (int y = 0; y < plane_height; y++) {
+      std::memcpy(dst, frame.data[plane] + y * frame.stride[plane], plane_width);
+      dst += plane_width;
+    }
+  }
+
+  return EncodeYUV420(yuv_data, encoded_frame);
+}
+
+bool VideoEncoder::EncodeYUV420(const VideoFrameView& frame,
+                               std::vector<EncodedPacket>* packets) {
+  // Default implementation: not supported
+  std::cerr << "Packet output is not supported by this encoder" << std::endl;
+  return false;
+}
+
+bool VideoEncoder::EncodeRGB(const VideoFrameView& frame,
+                            std::vector<uint8_t>* encoded_frame) {
+  // Default implementation: not supported
+  std::cerr << "EncodeRGB is not supported by this encoder" << std::endl;
+  return false;
+}
+
+bool VideoEncoder::EncodeRGB(const VideoFrameView& frame,
+                            std::vector<EncodedPacket>* packets) {
+  // Default implementation: not supported
+  std::cerr << "EncodeRGB is not supported by this encoder" << std::endl;
+  return false;
+}
+
 bool VideoEncoder::EncodeNV12(const std::vector<uint8_t>& nv12_data,
                              std::vector<uint8_t>* encoded_frame) {
   // Default implementation: not supported
@@ -32,6 +92,14 @@ bool VideoEncoder::Flush(std::vector<uint8_t>* encoded_frame) {
   return true;
 }
 
+bool VideoEncoder::Flush(std::vector<EncodedPacket>* packets) {
+  // Default implementation: nothing to flush
+  if (packets) {
+    packets->clear();
+  }
+  return true;
+}
+
 bool VideoEncoder::UpdateBitrate(int new_bitrate) {
   // Default implementation: not supported
   std::cerr << "UpdateBitrate is not supported by this encoder" << std::endl;
@@ -44,8 +112,189 @@ bool VideoEncoder::UpdateFramerate(int new_framerate) {
   return false;
 }
 
+bool VideoEncoder::UpdateRateControl(const RateControlConfig& rate_control) {
+  // Default implementation: bitrate and frame rate only
+  if (rate_control.max_bitrate > 0 || rate_control.buffer_size > 0) {
+    std::cerr << "VBV updates are not supported by this encoder" << std::endl;
+    return false;
+  }
+  if (rate_control.bitrate > 0 && !UpdateBitrate(rate_control.bitrate)) {
+    return false;
+  }
+  if (rate_control.framerate > 0 && !UpdateFramerate(rate_control.framerate)) {
+    return false;
+  }
+  return true;
+}
+
+bool VideoEncoder::GetStats(EncoderStats* stats) const {
+  // Default implementation: not supported
+  std::cerr << "GetStats is not supported by this encoder" << std::endl;
+  return false;
+}
+
+void VideoEncoder::ResetStats() {
+  // Default implementation: nothing to reset
+}
+
 namespace {
 
+// Records applied rate control targets in the facade configuration
+void ApplyRateControl(const RateControlConfig& rate_control, VideoEncoderConfig* config) {
+  if (rate_control.bitrate > 0) {
+    config->bitrate = rate_control.bitrate;
+  }
+  if (rate_control.framerate > 0) {
+    config->framerate = rate_control.framerate;
+  }
+}
+
+// True for the 16-bit sample formats that need a 10-bit encoder
+bool IsHighBitDepth(PixelFormat format) {
+  return InputBitDepth(format) > 8;
+}
+
+// AVColorSpace signalled for |matrix|
+int ToAVColorSpace(ColorMatrix matrix) {
+  return matrix == ColorMatrix::BT709 ? AVCOL_SPC_BT709 : AVCOL_SPC_SMPTE170M;
+}
+
+// AVColorRange signalled for |range|
+int ToAVColorRange(ColorRange range) {
+  return range == ColorRange::FULL ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+}
+
+// Converts packed RGB or NV12 input into YUV420 planes owned by the
+// encoder. The planes are 64-byte aligned with padded strides, so the codec
+// wrappers borrow them instead of copying.
+class InputConverter {
+ public:
+  // Matrix and range for RGB input (default BT.601 limited range)
+  void SetColorSpace(ColorMatrix matrix, ColorRange range) {
+    coefficients_ = color::MakeCoefficients(matrix, range);
+  }
+
+  bool FromRGB(PixelFormat format, const VideoFrameView& rgb, VideoFrameView* yuv) {
+    color::PackedFormat packed;
+    int bytes_per_pixel;
+    switch (format) {
+      case PixelFormat::BGRA:
+        packed = color::PackedFormat::kBGRA;
+        bytes_per_pixel = 4;
+        break;
+      case PixelFormat::RGBA:
+        packed = color::PackedFormat::kRGBA;
+        bytes_per_pixel = 4;
+        break;
+      case PixelFormat::RGB24:
+        packed = color::PackedFormat::kRGB24;
+        bytes_per_pixel = 3;
+        break;
+      default:
+        std::cerr << "EncodeRGB needs a BGRA, RGBA or RGB24 input_format" << std::endl;
+        return false;
+    }
+    if (!rgb.data[0] || rgb.width <= 0 || rgb.height <= 0 ||
+        rgb.stride[0] < rgb.width * bytes_per_pixel) {
+      std::cerr << "Invalid RGB frame" << std::endl;
+      return false;
+    }
+
+    if (rgb.width != width_ || rgb.height != height_ || bytes_per_sample_ != 1) {
+      Allocate(rgb.width, rgb.height, 1);
+    }
+
+    color::PackedToI420(packed, rgb.data[0], rgb.stride[0], rgb.width, rgb.height,
+                        planes_[0], strides_[0], planes_[1], strides_[1],
+                        planes_[2], strides_[2], coefficients_);
+
+    *yuv = rgb;
+    for (int i = 0; i < 3; i++) {
+      yuv->data[i] = planes_[i];
+      yuv->stride[i] = strides_[i];
+    }
+    return true;
+  }
+
+  // NV12 keeps its luma plane in place and only has the chroma
+  // deinterleaved; P010 is unpacked to YUV420P10 as a whole
+  bool FromSemiPlanar(PixelFormat format, const std::vector<uint8_t>& nv12,
+                      int width, int height, VideoFrameView* yuv) {
+    const bool p010 = format == PixelFormat::P010;
+    const int bytes = p010 ? 2 : 1;
+    const int chroma_width = (width + 1) / 2;
+    const int chroma_height = (height + 1) / 2;
+    const size_t luma_size = static_cast<size_t>(width) * height * bytes;
+    if (width <= 0 || height <= 0 ||
+        nv12.size() < luma_size + static_cast<size_t>(chroma_width) * 2 * chroma_height * bytes) {
+      std::cerr << "Input " << (p010 ? "P010" : "NV12") << " data is too small" << std::endl;
+      return false;
+    }
+
+    if (width != width_ || height != height_ || bytes != bytes_per_sample_) {
+      Allocate(width, height, bytes);
+    }
+
+    *yuv = VideoFrameView();
+    yuv->width = width;
+    yuv->height = height;
+    for (int i = 0; i < 3; i++) {
+      yuv->data[i] = planes_[i];
+      yuv->stride[i] = strides_[i];
+    }
+
+    if (p010) {
+      color::P010ToYUV420P10(nv12.data(), width * 2, nv12.data() + luma_size, chroma_width * 4,
+                             width, height,
+                             planes_[0], strides_[0], planes_[1], strides_[1],
+                             planes_[2], strides_[2]);
+      yuv->bit_depth = 10;
+      return true;
+    }
+
+    color::SplitUV(nv12.data() + luma_size, chroma_width * 2, chroma_width, chroma_height,
+                   planes_[1], strides_[1], planes_[2], strides_[2]);
+    yuv->data[0] = nv12.data();
+    yuv->stride[0] = width;
+    return true;
+  }
+
+ private:
+  static const int kAlignment = 64;
+
+  static int AlignUp(int value) {
+    return (value + kAlignment - 1) / kAlignment * kAlignment;
+  }
+
+  void Allocate(int width, int height, int bytes_per_sample) {
+    width_ = width;
+    height_ = height;
+    bytes_per_sample_ = bytes_per_sample;
+    const int chroma_height = (height + 1) / 2;
+    strides_[0] = AlignUp(width * bytes_per_sample);
+    strides_[1] = strides_[2] = AlignUp((width + 1) / 2 * bytes_per_sample);
+
+    const size_t luma_size = static_cast<size_t>(strides_[0]) * height;
+    const size_t chroma_size = static_cast<size_t>(strides_[1]) * chroma_height;
+    buffer_.resize(luma_size + 2 * chroma_size + kAlignment);
+
+    const uintptr_t base = reinterpret_cast<uintptr_t>(buffer_.data());
+    uint8_t* aligned = buffer_.data() + (kAlignment - base % kAlignment) % kAlignment;
+    planes_[0] = aligned;
+    planes_[1] = aligned + luma_size;
+    planes_[2] = aligned + luma_size + chroma_size;
+  }
+
+  color::Coefficients coefficients_ =
+      color::MakeCoefficients(ColorMatrix::BT601, ColorRange::LIMITED);
+  std::vector<uint8_t> buffer_;
+  uint8_t* planes_[3] = {nullptr, nullptr, nullptr};
+  int strides_[3] = {0, 0, 0};
+  int width_ = 0;
+  int height_ = 0;
+  int bytes_per_sample_ = 1;
+};
+
 // Helper class for H264 encoder implementation
 class H264EncoderImpl : public VideoEncoder {
  public:
@@ -55,6 +304,9 @@ class H264EncoderImpl : public VideoEncoder {
     h264_config_.height = config.height;
     h264_config_.bitrate = config.bitrate;
     h264_config_.framerate = config.framerate;
+    h264_config_.colorspace = ToAVColorSpace(config.color_matrix);
+    h264_config_.color_range = ToAVColorRange(config.color_range);
+    input_.SetColorSpace(config.color_matrix, config.color_range);
     
     // Apply advanced parameters if provided
     if (config.codec_params && typeid(*config.codec_params) == typeid(codec::H264Params)) {
@@ -67,8 +319,13 @@ class H264EncoderImpl : public VideoEncoder {
       h264_config_.constant_bitrate = advanced.constant_bitrate;
       h264_config_.crf = advanced.crf;
       h264_config_.threads = advanced.threads;
+      h264_config_.scenecut_threshold = advanced.scenecut;
     }
     
+    if (IsHighBitDepth(config.input_format)) {
+      std::cerr << "10-bit input is not supported by the H264 encoder" << std::endl;
+      return;
+    }
     encoder_ = H264Encoder::Create(h264_config_);
   }
   
@@ -78,16 +335,56 @@ class H264EncoderImpl : public VideoEncoder {
     return encoder_->EncodeYUV420(yuv_data, encoded_frame);
   }
   
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, encoded_frame);
+  }
+  
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, packets);
+  }
+  
+  bool EncodeNV12(const std::vector<uint8_t>& nv12_data,
+                 std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    VideoFrameView frame;
+    if (!input_.FromSemiPlanar(config_.input_format, nv12_data, config_.width, config_.height, &frame)) return false;
+    return EncodeYUV420(frame, encoded_frame);
+  }
+  
   bool Flush(std::vector<uint8_t>* encoded_frame) override {
     if (!encoder_) return false;
     return encoder_->Flush(encoded_frame);
   }
   
+  bool Flush(std::vector<EncodedPacket>* packets) override {
+    if (!encoder_) return false;
+    return encoder_->Flush(packets);
+  }
+  
   bool UpdateBitrate(int new_bitrate) override {
+    RateControlConfig rate_control;
+    rate_control.bitrate = new_bitrate;
+    return UpdateRateControl(rate_control);
+  }
+  
+  bool UpdateFramerate(int new_framerate) override {
+    RateControlConfig rate_control;
+    rate_control.framerate = new_framerate;
+    return UpdateRateControl(rate_control);
+  }
+  
+  bool UpdateRateControl(const RateControlConfig& rate_control) override {
     if (!encoder_) return false;
-    H264EncoderConfig new_config = h264_config_;
-    new_config.bitrate = new_bitrate;
-    return encoder_->Reconfigure(new_config);
+    if (!encoder_->UpdateRateControl(rate_control.bitrate, rate_control.max_bitrate,
+                                     rate_control.buffer_size, rate_control.framerate)) {
+      return false;
+    }
+    ApplyRateControl(rate_control, &config_);
+    return true;
   }
   
   VideoEncoderConfig GetConfig() const override {
@@ -98,6 +395,7 @@ class H264EncoderImpl : public VideoEncoder {
   VideoEncoderConfig config_;
   H264EncoderConfig h264_config_;
   std::unique_ptr<H264Encoder> encoder_;
+  InputConverter input_;
 };
 
 // Helper class for HEVC encoder implementation
@@ -109,6 +407,9 @@ class HEVCEncoderImpl : public VideoEncoder {
     hevc_config_.height = config.height;
     hevc_config_.bitrate = config.bitrate;
     hevc_config_.framerate = config.framerate;
+    hevc_config_.colorspace = ToAVColorSpace(config.color_matrix);
+    hevc_config_.fullrange = config.color_range == ColorRange::FULL;
+    input_.SetColorSpace(config.color_matrix, config.color_range);
     
     // Apply advanced parameters if provided
     if (config.codec_params && typeid(*config.codec_params) == typeid(codec::HEVCParams)) {
@@ -138,6 +439,14 @@ class HEVCEncoderImpl : public VideoEncoder {
       hevc_config_.rc_mode = advanced.constant_bitrate ? RateControlMode::CBR : RateControlMode::CRF;
       hevc_config_.bframes = advanced.max_b_frames;
       hevc_config_.threads = advanced.threads;
+      hevc_config_.scenecut = advanced.scenecut;
+      hevc_config_.forced_idr = advanced.forced_idr;
+    }
+    
+    // 10-bit input needs the Main10 profile
+    if (IsHighBitDepth(config.input_format)) {
+      hevc_config_.profile = HEVCProfile::MAIN_10;
+      hevc_config_.bit_depth = 10;
     }
     
     encoder_ = HEVCEncoder::Create(hevc_config_);
@@ -149,22 +458,56 @@ class HEVCEncoderImpl : public VideoEncoder {
     return encoder_->EncodeYUV420(yuv_data, encoded_frame) == 1;
   }
   
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, encoded_frame) == 1;
+  }
+  
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, packets) == 1;
+  }
+  
+  bool EncodeNV12(const std::vector<uint8_t>& nv12_data,
+                 std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    VideoFrameView frame;
+    if (!input_.FromSemiPlanar(config_.input_format, nv12_data, config_.width, config_.height, &frame)) return false;
+    return EncodeYUV420(frame, encoded_frame);
+  }
+  
   bool Flush(std::vector<uint8_t>* encoded_frame) override {
     if (!encoder_) return false;
     return encoder_->Flush(encoded_frame) == 1;
   }
   
-  bool UpdateParams(int new_bitrate, int new_framerate) {
+  bool Flush(std::vector<EncodedPacket>* packets) override {
     if (!encoder_) return false;
-    return encoder_->UpdateParams(new_bitrate, new_framerate);
+    return encoder_->Flush(packets) == 1;
   }
   
   bool UpdateBitrate(int new_bitrate) override {
-    return UpdateParams(new_bitrate, hevc_config_.framerate);
+    RateControlConfig rate_control;
+    rate_control.bitrate = new_bitrate;
+    return UpdateRateControl(rate_control);
   }
   
   bool UpdateFramerate(int new_framerate) override {
-    return UpdateParams(hevc_config_.bitrate, new_framerate);
+    RateControlConfig rate_control;
+    rate_control.framerate = new_framerate;
+    return UpdateRateControl(rate_control);
+  }
+  
+  bool UpdateRateControl(const RateControlConfig& rate_control) override {
+    if (!encoder_) return false;
+    if (!encoder_->UpdateRateControl(rate_control.bitrate, rate_control.max_bitrate,
+                                     rate_control.buffer_size, rate_control.framerate)) {
+      return false;
+    }
+    ApplyRateControl(rate_control, &config_);
+    return true;
   }
   
   VideoEncoderConfig GetConfig() const override {
@@ -175,6 +518,7 @@ class HEVCEncoderImpl : public VideoEncoder {
   VideoEncoderConfig config_;
   HEVCEncoderConfig hevc_config_;
   std::unique_ptr<HEVCEncoder> encoder_;
+  InputConverter input_;
 };
 
 // Helper class for VP8 encoder implementation
@@ -186,6 +530,7 @@ class VP8EncoderImpl : public VideoEncoder {
     vp8_config_.height = config.height;
     vp8_config_.bitrate = config.bitrate;
     vp8_config_.framerate = config.framerate;
+    input_.SetColorSpace(config.color_matrix, config.color_range);
     
     // Apply advanced parameters if provided
     if (config.codec_params && typeid(*config.codec_params) == typeid(codec::VP8Params)) {
@@ -194,8 +539,13 @@ class VP8EncoderImpl : public VideoEncoder {
       vp8_config_.keyframe_interval = advanced.keyframe_interval;
       vp8_config_.rc_mode = advanced.constant_bitrate ? VP8EncoderConfig::RC_MODE_CBR : VP8EncoderConfig::RC_MODE_VBR;
       vp8_config_.thread_count = advanced.threads;
+      vp8_config_.auto_keyframe = advanced.auto_keyframes;
     }
     
+    if (IsHighBitDepth(config.input_format)) {
+      std::cerr << "10-bit input is not supported by the VP8 encoder" << std::endl;
+      return;
+    }
     encoder_.reset(VP8Encoder::Create(vp8_config_));
   }
   
@@ -205,6 +555,48 @@ class VP8EncoderImpl : public VideoEncoder {
     return encoder_->EncodeYUV420(yuv_data, encoded_frame) > 0;
   }
   
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, encoded_frame) > 0;
+  }
+  
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, packets) > 0;
+  }
+  
+  bool EncodeNV12(const std::vector<uint8_t>& nv12_data,
+                 std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    VideoFrameView frame;
+    if (!input_.FromSemiPlanar(config_.input_format, nv12_data, config_.width, config_.height, &frame)) return false;
+    return EncodeYUV420(frame, encoded_frame);
+  }
+  
+  bool UpdateBitrate(int new_bitrate) override {
+    RateControlConfig rate_control;
+    rate_control.bitrate = new_bitrate;
+    return UpdateRateControl(rate_control);
+  }
+  
+  bool UpdateFramerate(int new_framerate) override {
+    RateControlConfig rate_control;
+    rate_control.framerate = new_framerate;
+    return UpdateRateControl(rate_control);
+  }
+  
+  bool UpdateRateControl(const RateControlConfig& rate_control) override {
+    if (!encoder_) return false;
+    if (!encoder_->UpdateRateControl(rate_control.bitrate, rate_control.max_bitrate,
+                                     rate_control.buffer_size, rate_control.framerate)) {
+      return false;
+    }
+    ApplyRateControl(rate_control, &config_);
+    return true;
+  }
+  
   VideoEncoderConfig GetConfig() const override {
     return config_;
   }
@@ -213,6 +605,7 @@ class VP8EncoderImpl : public VideoEncoder {
   VideoEncoderConfig config_;
   VP8EncoderConfig vp8_config_;
   std::unique_ptr<VP8Encoder> encoder_;
+  InputConverter input_;
 };
 
 // Helper class for VP9 encoder implementation
@@ -224,12 +617,16 @@ class VP9EncoderImpl : public VideoEncoder {
     vp9_config_.height = config.height;
     vp9_config_.bitrate = config.bitrate;
     vp9_config_.framerate = config.framerate;
+    vp9_config_.colorspace = ToAVColorSpace(config.color_matrix);
+    vp9_config_.color_range = ToAVColorRange(config.color_range);
+    input_.SetColorSpace(config.color_matrix, config.color_range);
     
     // Apply advanced parameters if provided
     if (config.codec_params && typeid(*config.codec_params) == typeid(codec::VP9Params)) {
       const auto& advanced = *static_cast<const codec::VP9Params*>(config.codec_params.get());
       vp9_config_.crf = advanced.quality;
       vp9_config_.keyframe_interval = advanced.keyframe_interval;
+      vp9_config_.auto_keyframe = advanced.auto_keyframes;
       vp9_config_.use_cbr = advanced.constant_bitrate;
       vp9_config_.threads = advanced.threads;
       vp9_config_.tile_columns = advanced.tile_columns;
@@ -247,6 +644,12 @@ class VP9EncoderImpl : public VideoEncoder {
       else if (advanced.profile == "3") vp9_config_.profile = VP9Profile::PROFILE_3;
     }
     
+    // 10-bit input needs profile 2
+    if (IsHighBitDepth(config.input_format)) {
+      vp9_config_.profile = VP9Profile::PROFILE_2;
+      vp9_config_.bit_depth = 10;
+    }
+    
     encoder_ = VP9Encoder::Create(vp9_config_);
   }
   
@@ -256,14 +659,46 @@ class VP9EncoderImpl : public VideoEncoder {
     return encoder_->EncodeYUV420(yuv_data, encoded_frame);
   }
   
-  bool UpdateBitrate(int new_bitrate) override {
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* encoded_frame) override {
     if (!encoder_) return false;
-    return encoder_->UpdateBitrate(new_bitrate);
+    return encoder_->EncodeYUV420(frame, encoded_frame);
+  }
+  
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, packets);
+  }
+  
+  bool EncodeNV12(const std::vector<uint8_t>& nv12_data,
+                 std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    VideoFrameView frame;
+    if (!input_.FromSemiPlanar(config_.input_format, nv12_data, config_.width, config_.height, &frame)) return false;
+    return EncodeYUV420(frame, encoded_frame);
+  }
+  
+  bool UpdateBitrate(int new_bitrate) override {
+    RateControlConfig rate_control;
+    rate_control.bitrate = new_bitrate;
+    return UpdateRateControl(rate_control);
   }
   
   bool UpdateFramerate(int new_framerate) override {
+    RateControlConfig rate_control;
+    rate_control.framerate = new_framerate;
+    return UpdateRateControl(rate_control);
+  }
+  
+  bool UpdateRateControl(const RateControlConfig& rate_control) override {
     if (!encoder_) return false;
-    return encoder_->UpdateFramerate(new_framerate);
+    if (!encoder_->UpdateRateControl(rate_control.bitrate, rate_control.max_bitrate,
+                                     rate_control.buffer_size, rate_control.framerate)) {
+      return false;
+    }
+    ApplyRateControl(rate_control, &config_);
+    return true;
   }
   
   VideoEncoderConfig GetConfig() const override {
@@ -274,6 +709,7 @@ class VP9EncoderImpl : public VideoEncoder {
   VideoEncoderConfig config_;
   VP9EncoderConfig vp9_config_;
   std::unique_ptr<VP9Encoder> encoder_;
+  InputConverter input_;
 };
 
 // Helper class for AV1 encoder implementation
@@ -285,6 +721,9 @@ class AV1EncoderImpl : public VideoEncoder {
     av1_config_.height = config.height;
     av1_config_.bitrate = config.bitrate;
     av1_config_.framerate = config.framerate;
+    av1_config_.colorspace = ToAVColorSpace(config.color_matrix);
+    av1_config_.color_range = config.color_range == ColorRange::FULL ? 1 : 0;
+    input_.SetColorSpace(config.color_matrix, config.color_range);
     
     // Apply advanced parameters if provided
     if (config.codec_params && typeid(*config.codec_params) == typeid(codec::AV1Params)) {
@@ -308,6 +747,7 @@ class AV1EncoderImpl : public VideoEncoder {
       }
       
       av1_config_.keyframe_interval = advanced.keyframe_interval;
+      av1_config_.auto_keyframe = advanced.auto_keyframes;
       av1_config_.rc_mode = advanced.constant_bitrate ? 
           AV1RateControlMode::CBR : AV1RateControlMode::CRF;
       av1_config_.crf = advanced.crf;
@@ -316,6 +756,10 @@ class AV1EncoderImpl : public VideoEncoder {
       av1_config_.tile_rows = advanced.tile_rows;
     }
     
+    if (IsHighBitDepth(config.input_format)) {
+      av1_config_.bit_depth = 10;
+    }
+    
     encoder_ = AV1Encoder::Create(av1_config_);
   }
   
@@ -325,11 +769,58 @@ class AV1EncoderImpl : public VideoEncoder {
     return encoder_->EncodeYUV420(yuv_data, encoded_frame);
   }
   
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, encoded_frame);
+  }
+  
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, packets);
+  }
+  
+  bool EncodeNV12(const std::vector<uint8_t>& nv12_data,
+                 std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    VideoFrameView frame;
+    if (!input_.FromSemiPlanar(config_.input_format, nv12_data, config_.width, config_.height, &frame)) return false;
+    return EncodeYUV420(frame, encoded_frame);
+  }
+  
   bool Flush(std::vector<uint8_t>* encoded_frame) override {
     if (!encoder_) return false;
     return encoder_->Flush(encoded_frame);
   }
   
+  bool Flush(std::vector<EncodedPacket>* packets) override {
+    if (!encoder_) return false;
+    return encoder_->Flush(packets);
+  }
+  
+  bool UpdateBitrate(int new_bitrate) override {
+    RateControlConfig rate_control;
+    rate_control.bitrate = new_bitrate;
+    return UpdateRateControl(rate_control);
+  }
+  
+  bool UpdateFramerate(int new_framerate) override {
+    RateControlConfig rate_control;
+    rate_control.framerate = new_framerate;
+    return UpdateRateControl(rate_control);
+  }
+  
+  bool UpdateRateControl(const RateControlConfig& rate_control) override {
+    if (!encoder_) return false;
+    if (!encoder_->UpdateRateControl(rate_control.bitrate, rate_control.max_bitrate,
+                                     rate_control.buffer_size, rate_control.framerate)) {
+      return false;
+    }
+    ApplyRateControl(rate_control, &config_);
+    return true;
+  }
+  
   VideoEncoderConfig GetConfig() const override {
     return config_;
   }
@@ -338,6 +829,7 @@ class AV1EncoderImpl : public VideoEncoder {
   VideoEncoderConfig config_;
   AV1EncoderConfig av1_config_;
   std::unique_ptr<AV1Encoder> encoder_;
+  InputConverter input_;
 };
 
 
@@ -368,6 +860,18 @@ class NvidiaH264EncoderImpl : public VideoEncoder {
     return encoder_->EncodeYUV420(yuv_data, encoded_frame);
   }
   
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, encoded_frame);
+  }
+  
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, packets);
+  }
+  
   bool EncodeNV12(const std::vector<uint8_t>& nv12_data,
                  std::vector<uint8_t>* encoded_frame) override {
     if (!encoder_) return false;
@@ -411,6 +915,18 @@ class NvidiaHEVCEncoderImpl : public VideoEncoder {
     return encoder_->EncodeYUV420(yuv_data, encoded_frame);
   }
   
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, encoded_frame);
+  }
+  
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, packets);
+  }
+  
   bool EncodeNV12(const std::vector<uint8_t>& nv12_data,
                  std::vector<uint8_t>* encoded_frame) override {
     if (!encoder_) return false;
@@ -455,6 +971,18 @@ class NvidiaAV1EncoderImpl : public VideoEncoder {
     return encoder_->EncodeYUV420(yuv_data, encoded_frame);
   }
   
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* encoded_frame) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, encoded_frame);
+  }
+  
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets) override {
+    if (!encoder_) return false;
+    return encoder_->EncodeYUV420(frame, packets);
+  }
+  
   bool EncodeNV12(const std::vector<uint8_t>& nv12_data,
                  std::vector<uint8_t>* encoded_frame) override {
     if (!encoder_) return false;
@@ -471,15 +999,311 @@ class NvidiaAV1EncoderImpl : public VideoEncoder {
   std::unique_ptr<NvidiaAV1Encoder> encoder_;
 };
 
+// Encode latency histogram with four sub-buckets per power of two (about
+// 19% resolution) from 1 us to over a minute. Recording is a single relaxed
+// increment, so it stays on in production.
+class LatencyHistogram {
+ public:
+  LatencyHistogram() { Reset(); }
 
-} // namespace
+  void Record(int64_t micros) {
+    counts_[BucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+  }
 
-std::unique_ptr<VideoEncoder> VideoEncoder::Create(const VideoEncoderConfig& config) {
+  // Upper bound of the bucket holding the |fraction| quantile
+  int64_t Percentile(double fraction) const {
+    uint64_t total = 0;
+    for (int i = 0; i < kBuckets; i++) {
+      total += counts_[i].load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+      return 0;
+    }
+
+    const uint64_t target = static_cast<uint64_t>(fraction * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+      seen += counts_[i].load(std::memory_order_relaxed);
+      if (seen >= target) {
+        return BucketLimit(i);
+      }
+    }
+    return BucketLimit(kBuckets - 1);
+  }
+
+  void Reset() {
+    for (int i = 0; i < kBuckets; i++) {
+      counts_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  static const int kMaxExponent = 36;
+  static const int kBuckets = 4 + (kMaxExponent - 1) * 4;
+
+  static int BucketIndex(int64_t value) {
+    if (value < 4) {
+      return value < 0 ? 0 : static_cast<int>(value);
+    }
+    int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+    if (exponent > kMaxExponent) {
+      return kBuckets - 1;
+    }
+    const int sub_bucket = static_cast<int>((value >> (exponent - 2)) & 3);
+    return 4 + (exponent - 2) * 4 + sub_bucket;
+  }
+
+  static int64_t BucketLimit(int index) {
+    if (index < 4) {
+      return index;
+    }
+    const int exponent = (index - 4) / 4 + 2;
+    const int sub_bucket = (index - 4) % 4;
+    return ((static_cast<int64_t>(4 + sub_bucket + 1)) << (exponent - 2)) - 1;
+  }
+
+  std::atomic<uint64_t> counts_[kBuckets];
+};
+
+// Wraps every encoder handed out by Create() and keeps its EncoderStats.
+// Counters are single-writer atomics, so GetStats() may run on any thread.
+// Packed RGB input is converted here, so every backend accepts it.
+class StatsEncoder : public VideoEncoder {
+ public:
+  explicit StatsEncoder(std::unique_ptr<VideoEncoder> encoder)
+      : encoder_(std::move(encoder)),
+        input_format_(encoder_->GetConfig().input_format) {}
+
+  bool EncodeYUV420(const std::vector<uint8_t>& yuv_data,
+                   std::vector<uint8_t>* encoded_frame) override {
+    const auto start = Clock::now();
+    const bool result = encoder_->EncodeYUV420(yuv_data, encoded_frame);
+    RecordFrame(result, start);
+    if (result && encoded_frame) {
+      RecordBuffer(*encoded_frame);
+    }
+    return result;
+  }
+
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* encoded_frame) override {
+    const auto start = Clock::now();
+    const bool result = encoder_->EncodeYUV420(frame, encoded_frame);
+    RecordFrame(result, start);
+    if (result && encoded_frame) {
+      RecordBuffer(*encoded_frame);
+    }
+    return result;
+  }
+
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets) override {
+    const auto start = Clock::now();
+    const bool result = encoder_->EncodeYUV420(frame, packets);
+    RecordFrame(result, start);
+    if (result && packets) {
+      RecordPackets(*packets);
+    }
+    return result;
+  }
+
+  bool EncodeRGB(const VideoFrameView& frame,
+                std::vector<uint8_t>* encoded_frame) override {
+    const auto start = Clock::now();
+    VideoFrameView yuv;
+    const bool result = ConvertRGB(frame, &yuv) && encoder_->EncodeYUV420(yuv, encoded_frame);
+    RecordFrame(result, start);
+    if (result && encoded_frame) {
+      RecordBuffer(*encoded_frame);
+    }
+    return result;
+  }
+
+  bool EncodeRGB(const VideoFrameView& frame,
+                std::vector<EncodedPacket>* packets) override {
+    const auto start = Clock::now();
+    VideoFrameView yuv;
+    const bool result = ConvertRGB(frame, &yuv) && encoder_->EncodeYUV420(yuv, packets);
+    RecordFrame(result, start);
+    if (result && packets) {
+      RecordPackets(*packets);
+    }
+    return result;
+  }
+
+  bool EncodeNV12(const std::vector<uint8_t>& nv12_data,
+                 std::vector<uint8_t>* encoded_frame) override {
+    const auto start = Clock::now();
+    const bool result = encoder_->EncodeNV12(nv12_data, encoded_frame);
+    RecordFrame(result, start);
+    if (result && encoded_frame) {
+      RecordBuffer(*encoded_frame);
+    }
+    return result;
+  }
+
+  bool Flush(std::vector<uint8_t>* encoded_frame) override {
+    const bool result = encoder_->Flush(encoded_frame);
+    if (result && encoded_frame) {
+      RecordBuffer(*encoded_frame);
+    }
+    return result;
+  }
+
+  bool Flush(std::vector<EncodedPacket>* packets) override {
+    const bool result = encoder_->Flush(packets);
+    if (result && packets) {
+      RecordPackets(*packets);
+    }
+    return result;
+  }
+
+  bool UpdateBitrate(int new_bitrate) override {
+    return encoder_->UpdateBitrate(new_bitrate);
+  }
+
+  bool UpdateFramerate(int new_framerate) override {
+    return encoder_->UpdateFramerate(new_framerate);
+  }
+
+  bool UpdateRateControl(const RateControlConfig& rate_control) override {
+    return encoder_->UpdateRateControl(rate_control);
+  }
+
+  bool GetStats(EncoderStats* stats) const override {
+    if (!stats) {
+      return false;
+    }
+
+    *stats = EncoderStats();
+    stats->frames_in = frames_in_.load(std::memory_order_relaxed);
+    stats->frames_out = frames_out_.load(std::memory_order_relaxed);
+    stats->frames_dropped = frames_dropped_.load(std::memory_order_relaxed);
+    stats->bytes_out = bytes_out_.load(std::memory_order_relaxed);
+    stats->i_frames = i_frames_.load(std::memory_order_relaxed);
+    stats->p_frames = p_frames_.load(std::memory_order_relaxed);
+    stats->b_frames = b_frames_.load(std::memory_order_relaxed);
+
+    const uint64_t qp_frames = qp_frames_.load(std::memory_order_relaxed);
+    if (qp_frames > 0) {
+      stats->average_qp =
+          static_cast<double>(qp_sum_.load(std::memory_order_relaxed)) / qp_frames;
+    }
+
+    stats->latency_p50_us = latency_.Percentile(0.50);
+    stats->latency_p95_us = latency_.Percentile(0.95);
+    stats->latency_p99_us = latency_.Percentile(0.99);
+    stats->input_copy_us = input_copy_us_.load(std::memory_order_relaxed);
+
+    const int64_t accepted = static_cast<int64_t>(stats->frames_in - stats->frames_dropped);
+    stats->queue_depth = std::max<int64_t>(0, accepted - static_cast<int64_t>(stats->frames_out));
+    return true;
+  }
+
+  void ResetStats() override {
+    frames_in_.store(0, std::memory_order_relaxed);
+    frames_out_.store(0, std::memory_order_relaxed);
+    frames_dropped_.store(0, std::memory_order_relaxed);
+    bytes_out_.store(0, std::memory_order_relaxed);
+    i_frames_.store(0, std::memory_order_relaxed);
+    p_frames_.store(0, std::memory_order_relaxed);
+    b_frames_.store(0, std::memory_order_relaxed);
+    qp_sum_.store(0, std::memory_order_relaxed);
+    qp_frames_.store(0, std::memory_order_relaxed);
+    input_copy_us_.store(0, std::memory_order_relaxed);
+    latency_.Reset();
+  }
+
+  VideoEncoderConfig GetConfig() const override {
+    return encoder_->GetConfig();
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // The conversion is the only pass over the input, so it counts as input
+  // copy time
+  bool ConvertRGB(const VideoFrameView& frame, VideoFrameView* yuv) {
+    const auto start = Clock::now();
+    const bool result = rgb_input_.FromRGB(input_format_, frame, yuv);
+    input_copy_us_.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start).count(), std::memory_order_relaxed);
+    return result;
+  }
+
+  void RecordFrame(bool result, Clock::time_point start) {
+    const int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start).count();
+    latency_.Record(elapsed);
+    input_copy_us_.fetch_add(TakeFrameCopyTime(), std::memory_order_relaxed);
+
+    frames_in_.fetch_add(1, std::memory_order_relaxed);
+    if (!result) {
+      frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void RecordBuffer(const std::vector<uint8_t>& encoded_frame) {
+    if (encoded_frame.empty()) {
+      return;
+    }
+    frames_out_.fetch_add(1, std::memory_order_relaxed);
+    bytes_out_.fetch_add(encoded_frame.size(), std::memory_order_relaxed);
+  }
+
+  void RecordPackets(const std::vector<EncodedPacket>& packets) {
+    for (const EncodedPacket& packet : packets) {
+      frames_out_.fetch_add(1, std::memory_order_relaxed);
+      bytes_out_.fetch_add(packet.size(), std::memory_order_relaxed);
+
+      switch (packet.frame_type()) {
+        case FrameType::kI:
+          i_frames_.fetch_add(1, std::memory_order_relaxed);
+          break;
+        case FrameType::kP:
+          p_frames_.fetch_add(1, std::memory_order_relaxed);
+          break;
+        case FrameType::kB:
+          b_frames_.fetch_add(1, std::memory_order_relaxed);
+          break;
+        default:
+          break;
+      }
+
+      if (packet.qp() >= 0) {
+        qp_sum_.fetch_add(packet.qp(), std::memory_order_relaxed);
+        qp_frames_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::unique_ptr<VideoEncoder> encoder_;
+  const PixelFormat input_format_;
+  InputConverter rgb_input_;
+
+  std::atomic<uint64_t> frames_in_{0};
+  std::atomic<uint64_t> frames_out_{0};
+  std::atomic<uint64_t> frames_dropped_{0};
+  std::atomic<uint64_t> bytes_out_{0};
+  std::atomic<uint64_t> i_frames_{0};
+  std::atomic<uint64_t> p_frames_{0};
+  std::atomic<uint64_t> b_frames_{0};
+  std::atomic<uint64_t> qp_sum_{0};
+  std::atomic<uint64_t> qp_frames_{0};
+  std::atomic<int64_t> input_copy_us_{0};
+  LatencyHistogram latency_;
+};
+
+// Creates the backend encoder for |config| without the stats wrapper
+std::unique_ptr<VideoEncoder> CreateBackend(const VideoEncoderConfig& config) {
   const auto codec = config.output_codec;
   const bool use_gpu = config.gpu_acceleration;
   
-  // For GPU-accelerated encoders
-  if (use_gpu) {
+  // For GPU-accelerated encoders, which take 8-bit NV12 only
+  if (use_gpu && IsHighBitDepth(config.input_format)) {
+    std::cerr << "GPU encoders do not take 10-bit input. "
+              << "Falling back to CPU encoder." << std::endl;
+  } else if (use_gpu) {
 
     switch (codec) {
       case CodecType::H264:
@@ -518,4 +1342,14 @@ std::unique_ptr<VideoEncoder> VideoEncoder::Create(const VideoEncoderConfig& con
   }
 }
 
+} // namespace
+
+std::unique_ptr<VideoEncoder> VideoEncoder::Create(const VideoEncoderConfig& config) {
+  std::unique_ptr<VideoEncoder> encoder = CreateBackend(config);
+  if (!encoder) {
+    return nullptr;
+  }
+  return std::unique_ptr<VideoEncoder>(new StatsEncoder(std::move(encoder)));
+}
+
 } // namespace media
\ No newline at end of file
@@ -6,22 +6,25 @@
 #include <string>
 #include <vector>
 
+#include "media_encoded_packet.h"
+#include "media_video_frame.h"
+
 namespace media {
 
 // Supported pixel formats for input
 enum class PixelFormat {
   YUV420,  // Planar YUV 4:2:0
-  NV12     // Semi-planar YUV 4:2:0 (Y + interleaved UV)
+  NV12,    // Semi-planar YUV 4:2:0 (Y + interleaved UV)
+  YUV420P10,  // Planar 4:2:0, 10 bits in the low end of 16-bit LE words (HEVC, VP9, AV1)
+  P010,       // Semi-planar 4:2:0, 10 bits in the top of 16-bit LE words (EncodeNV12)
+  BGRA,    // Packed 8-bit B, G, R, A (EncodeRGB)
+  RGBA,    // Packed 8-bit R, G, B, A (EncodeRGB)
+  RGB24    // Packed 8-bit R, G, B (EncodeRGB)
 };
 
-// Supported video codecs
-enum class CodecType {
-  H264,    // H.264 / AVC
-  HEVC,    // H.265 / HEVC
-  VP8,     // VP8
-  VP9,     // VP9
-  AV1      // AV1
-};
+// Bits per sample of the YUV420 buffers an encoder takes for |format|:
+// 10 for YUV420P10 and P010, 8 otherwise
+int InputBitDepth(PixelFormat format);
 
 // Base struct for codec-specific params
 namespace codec {
@@ -39,6 +42,7 @@ struct H264Params : public BaseCodecParams {
   bool constant_bitrate = false;  // Use CBR instead of VBR
   int crf = 23;                   // Constant Rate Factor (quality, lower is better quality)
   int threads = 0;                // Number of threads (0 = auto)
+  int scenecut = 40;              // Scene cut threshold (0 = no encoder-placed scene cut keyframes)
 };
 
 struct HEVCParams : public BaseCodecParams {
@@ -50,6 +54,8 @@ struct HEVCParams : public BaseCodecParams {
   bool constant_bitrate = false;  // Use CBR instead of VBR
   int max_b_frames = 4;           // Number of B-frames between I and P
   int threads = 0;                // Number of threads (0 = auto)
+  int scenecut = 40;              // Scene cut threshold (0 = no encoder-placed scene cut keyframes)
+  bool forced_idr = false;        // Code requested keyframes as IDR, not CRA, pictures
 };
 
 struct VP8Params : public BaseCodecParams {
@@ -57,6 +63,7 @@ struct VP8Params : public BaseCodecParams {
   int keyframe_interval = 120;    // Maximum distance between keyframes in frames
   bool constant_bitrate = false;  // Use CBR instead of VBR
   int threads = 0;                // Number of threads (0 = auto)
+  bool auto_keyframes = true;     // Let libvpx add keyframes before the interval ends
 };
 
 struct VP9Params : public BaseCodecParams {
@@ -68,6 +75,7 @@ struct VP9Params : public BaseCodecParams {
   int threads = 0;                // Number of threads (0 = auto)
   int tile_columns = 0;           // Log2 of number of tile columns (0-6)
   int tile_rows = 0;              // Log2 of number of tile rows (0-2)
+  bool auto_keyframes = true;     // Let libvpx add keyframes before the interval ends
 };
 
 struct AV1Params : public BaseCodecParams {
@@ -79,6 +87,7 @@ struct AV1Params : public BaseCodecParams {
   int threads = 0;                // Number of threads (0 = auto)
   int tile_columns = 0;           // Number of tile columns (0=auto)
   int tile_rows = 0;              // Number of tile rows (0=auto)
+  bool auto_keyframes = true;     // Let libaom add keyframes before the interval ends
 };
 
 } // namespace codec
@@ -95,6 +104,11 @@ struct VideoEncoderConfig {
   int bitrate = 5000000;  // 5 Mbps
   int framerate = 30;
   
+  // YUV matrix and range used to convert EncodeRGB input, also signalled in
+  // the bitstream (VP8 has no field for them)
+  ColorMatrix color_matrix = ColorMatrix::BT601;
+  ColorRange color_range = ColorRange::LIMITED;
+  
   // Advanced parameters specific to each codec
   std::unique_ptr<codec::BaseCodecParams> codec_params;
   
@@ -130,7 +144,9 @@ struct VideoEncoderConfig {
         width(other.width),
         height(other.height),
         bitrate(other.bitrate),
-        framerate(other.framerate) {
+        framerate(other.framerate),
+        color_matrix(other.color_matrix),
+        color_range(other.color_range) {
     // Copy codec_params if present
     if (other.codec_params) {
       // Copy based on codec type
@@ -169,6 +185,8 @@ struct VideoEncoderConfig {
       height = other.height;
       bitrate = other.bitrate;
       framerate = other.framerate;
+      color_matrix = other.color_matrix;
+      color_range = other.color_range;
       
       // Copy codec_params if present
       if (other.codec_params) {
@@ -203,6 +221,34 @@ struct VideoEncoderConfig {
   }
 };
 
+// Rate control targets applied to a running encoder. Zero fields are left
+// unchanged.
+struct RateControlConfig {
+  int bitrate = 0;      // Target bitrate in bits/second
+  int max_bitrate = 0;  // VBV maximum rate in bits/second
+  int buffer_size = 0;  // VBV buffer size in bits
+  int framerate = 0;    // Frames per second, up to the rate the encoder was created with
+};
+
+// Counters kept for every encoder created by VideoEncoder::Create(). Frame
+// types, QP and queue depth are exact for the packet API; the contiguous
+// buffer APIs count each non-empty output as one frame.
+struct EncoderStats {
+  uint64_t frames_in = 0;       // Frames passed to an encode call
+  uint64_t frames_out = 0;      // Encoded frames returned
+  uint64_t frames_dropped = 0;  // Frames the encoder failed to accept
+  uint64_t bytes_out = 0;       // Total encoded payload size
+  uint64_t i_frames = 0;        // Encoded frames by picture type
+  uint64_t p_frames = 0;
+  uint64_t b_frames = 0;
+  double average_qp = -1.0;     // Mean QP of frames that report one (-1 = none)
+  int64_t latency_p50_us = 0;   // Encode call latency percentiles
+  int64_t latency_p95_us = 0;
+  int64_t latency_p99_us = 0;
+  int64_t input_copy_us = 0;    // Total time spent copying input planes
+  int64_t queue_depth = 0;      // Frames held for lookahead or reordering
+};
+
 // Video encoder interface
 class VideoEncoder {
  public:
@@ -212,21 +258,62 @@ class VideoEncoder {
   // Virtual destructor
   virtual ~VideoEncoder() = default;
   
-  // Encode a frame in YUV420 planar format
+  // Encode a frame in YUV420 planar format. With a YUV420P10 input_format
+  // every sample is a 16-bit word, so the buffer is twice as large; views
+  // must then set bit_depth to 10.
   virtual bool EncodeYUV420(const std::vector<uint8_t>& yuv_data,
                            std::vector<uint8_t>* encoded_frame) = 0;
   
-  // Encode a frame in NV12 semi-planar format (for GPU accelerated encoders)
+  // Encode a YUV420 frame given as plane pointers and strides. Encoders read
+  // the planes in place when possible and copy them at most once otherwise.
+  virtual bool EncodeYUV420(const VideoFrameView& frame,
+                           std::vector<uint8_t>* encoded_frame);
+  
+  // Encode a YUV420 frame and return every packet produced for it. Packets
+  // share the encoder's buffers and carry pts, dts and the keyframe flag.
+  virtual bool EncodeYUV420(const VideoFrameView& frame,
+                           std::vector<EncodedPacket>* packets);
+  
+  // Encode a packed RGB frame in the layout selected by
+  // VideoEncoderConfig::input_format (BGRA, RGBA or RGB24). Only data[0]
+  // and stride[0] of |frame| are read. The pixels are converted to YUV 4:2:0
+  // with VideoEncoderConfig::color_matrix and color_range in a single pass
+  // into an aligned buffer that the encoder reads in place, with no
+  // intermediate copy.
+  virtual bool EncodeRGB(const VideoFrameView& frame,
+                        std::vector<uint8_t>* encoded_frame);
+  virtual bool EncodeRGB(const VideoFrameView& frame,
+                        std::vector<EncodedPacket>* packets);
+  
+  // Encode a frame in NV12 semi-planar format. GPU encoders take it
+  // natively; software encoders read the luma plane in place and only
+  // deinterleave the chroma, without a swscale pass. With a P010
+  // input_format the buffer holds P010 and is unpacked to YUV420P10.
   virtual bool EncodeNV12(const std::vector<uint8_t>& nv12_data,
                          std::vector<uint8_t>* encoded_frame);
   
   // Flush any buffered frames
   virtual bool Flush(std::vector<uint8_t>* encoded_frame);
+  virtual bool Flush(std::vector<EncodedPacket>* packets);
   
   // Update encoder parameters at runtime
   virtual bool UpdateBitrate(int new_bitrate);
   virtual bool UpdateFramerate(int new_framerate);
   
+  // Change bitrate, VBV and frame rate targets together on the running
+  // encoder without reopening the codec, so no keyframe is forced and
+  // lookahead state is kept. Returns false if the encoder cannot apply a
+  // requested value in place: H264 takes the bitrate and VBV only when opened
+  // with constant_bitrate (ABR) and the frame rate always, VP8, VP9 and AV1
+  // only the frame rate, HEVC none.
+  virtual bool UpdateRateControl(const RateControlConfig& rate_control);
+  
+  // Snapshot of the encoder counters; cheap enough to poll while encoding
+  virtual bool GetStats(EncoderStats* stats) const;
+  
+  // Restart all counters from zero
+  virtual void ResetStats();
+  
   // Get current encoder configuration
   virtual VideoEncoderConfig GetConfig() const = 0;
 };
@@ -0,0 +1,262 @@
+#include "media_video_frame.h"
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace media {
+
+namespace {
+
+// Minimum alignment FFmpeg assumes for frame planes and strides
+const uintptr_t kFrameAlignment = 16;
+
+// Copy time accumulated by PrepareEncoderFrame() on this thread
+thread_local int64_t frame_copy_time_us = 0;
+
+// The caller keeps ownership of borrowed planes, so releasing the wrapping
+// buffer must not free anything
+void ReleaseBorrowedPlane(void* opaque, uint8_t* data) {}
+
+bool IsAligned(const uint8_t* data, int stride) {
+  return (reinterpret_cast<uintptr_t>(data) % kFrameAlignment) == 0 &&
+         (static_cast<uintptr_t>(stride) % kFrameAlignment) == 0;
+}
+
+// Sample depth of the encoder frame format (8 for NV12 and YUV420P)
+int FrameBitDepth(const AVFrame* frame) {
+  const AVPixFmtDescriptor* desc =
+      av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+  return desc ? desc->comp[0].depth : 8;
+}
+
+int BytesPerSample(int bit_depth) {
+  return bit_depth > 8 ? 2 : 1;
+}
+
+bool HasValidPlanes(const VideoFrameView& view) {
+  const int bytes = BytesPerSample(view.bit_depth);
+  const int chroma_width = (view.width + 1) / 2 * bytes;
+  return view.data[0] && view.data[1] && view.data[2] &&
+         view.stride[0] >= view.width * bytes &&
+         view.stride[1] >= chroma_width &&
+         view.stride[2] >= chroma_width;
+}
+
+bool CanBorrow(const VideoFrameView& view, const AVFrame* owned) {
+  if (owned->format != AV_PIX_FMT_YUV420P &&
+      owned->format != AV_PIX_FMT_YUV420P10LE &&
+      owned->format != AV_PIX_FMT_YUV420P12LE) {
+    return false;
+  }
+  for (int i = 0; i < 3; i++) {
+    if (!IsAligned(view.data[i], view.stride[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+AVFrame* BorrowPlanes(const VideoFrameView& view, const AVFrame* owned,
+                      AVFrame* borrowed) {
+  av_frame_unref(borrowed);
+
+  // Wrap the luma plane in a non-owning buffer so libavcodec treats the
+  // frame as reference counted and does not duplicate it on send
+  borrowed->buf[0] = av_buffer_create(
+      const_cast<uint8_t*>(view.data[0]),
+      static_cast<size_t>(view.stride[0]) * view.height,
+      ReleaseBorrowedPlane, nullptr, AV_BUFFER_FLAG_READONLY);
+  if (!borrowed->buf[0]) {
+    std::cerr << "Failed to wrap input planes" << std::endl;
+    return nullptr;
+  }
+
+  borrowed->format = owned->format;
+  borrowed->width = owned->width;
+  borrowed->height = owned->height;
+  for (int i = 0; i < 3; i++) {
+    borrowed->data[i] = const_cast<uint8_t*>(view.data[i]);
+    borrowed->linesize[i] = view.stride[i];
+  }
+
+  return borrowed;
+}
+
+AVFrame* CopyPlanes(const VideoFrameView& view, AVFrame* owned) {
+  if (av_frame_make_writable(owned) < 0) {
+    std::cerr << "Failed to make frame writable" << std::endl;
+    return nullptr;
+  }
+
+  const int bytes = BytesPerSample(view.bit_depth);
+  const int chroma_width = (view.width + 1) / 2;
+  const int chroma_height = (view.height + 1) / 2;
+
+  // Y plane
+  av_image_copy_plane(owned->data[0], owned->linesize[0],
+                      view.data[0], view.stride[0],
+                      view.width * bytes, view.height);
+
+  if (owned->format == AV_PIX_FMT_NV12) {
+    // Interleave U and V into the UV plane in the same pass
+    for (int y = 0; y < chroma_height; y++) {
+      const uint8_t* u_row = view.data[1] + y * view.stride[1];
+      const uint8_t* v_row = view.data[2] + y * view.stride[2];
+      uint8_t* uv_row = owned->data[1] + y * owned->linesize[1];
+      for (int x = 0; x < chroma_width; x++) {
+        uv_row[x * 2] = u_row[x];
+        uv_row[x * 2 + 1] = v_row[x];
+      }
+    }
+  } else {
+    // U and V planes
+    av_image_copy_plane(owned->data[1], owned->linesize[1],
+                        view.data[1], view.stride[1],
+                        chroma_width * bytes, chroma_height);
+    av_image_copy_plane(owned->data[2], owned->linesize[2],
+                        view.data[2], view.stride[2],
+                        chroma_width * bytes, chroma_height);
+  }
+
+  return owned;
+}
+
+}  // namespace
+
+FrameType FrameTypeFromPictureType(int pict_type) {
+  switch (pict_type) {
+    case AV_PICTURE_TYPE_I:
+    case AV_PICTURE_TYPE_SI:
+      return FrameType::kI;
+    case AV_PICTURE_TYPE_P:
+    case AV_PICTURE_TYPE_SP:
+      return FrameType::kP;
+    case AV_PICTURE_TYPE_B:
+    case AV_PICTURE_TYPE_BI:
+      return FrameType::kB;
+    default:
+      return FrameType::kUnknown;
+  }
+}
+
+VideoFrameView VideoFrameView::FromYUV420(const uint8_t* yuv_data,
+                                          int width, int height) {
+  VideoFrameView view;
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+
+  view.width = width;
+  view.height = height;
+  view.data[0] = yuv_data;
+  view.data[1] = yuv_data + width * height;
+  view.data[2] = view.data[1] + chroma_width * chroma_height;
+  view.stride[0] = width;
+  view.stride[1] = chroma_width;
+  view.stride[2] = chroma_width;
+  return view;
+}
+
+VideoFrameView VideoFrameView::FromYUV420(const uint8_t* yuv_data,
+                                          int width, int height,
+                                          int bit_depth) {
+  VideoFrameView view = FromYUV420(yuv_data, width, height);
+  if (bit_depth > 8) {
+    const int chroma_size = ((width + 1) / 2) * ((height + 1) / 2);
+    view.data[1] = yuv_data + 2 * width * height;
+    view.data[2] = view.data[1] + 2 * chroma_size;
+    for (int i = 0; i < 3; i++) {
+      view.stride[i] *= 2;
+    }
+  }
+  view.bit_depth = bit_depth;
+  return view;
+}
+
+size_t YUV420BufferSize(int width, int height, int bit_depth) {
+  const size_t chroma_size = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+  const size_t samples = static_cast<size_t>(width) * height + 2 * chroma_size;
+  return bit_depth > 8 ? samples * 2 : samples;
+}
+
+FrameClock::FrameClock(int time_base_rate)
+    : time_base_rate_(time_base_rate > 0 ? time_base_rate : 30),
+      framerate_(time_base_rate_) {}
+
+bool FrameClock::SetFramerate(int framerate) {
+  if (framerate <= 0 || framerate > time_base_rate_) {
+    return false;
+  }
+  framerate_ = framerate;
+  return true;
+}
+
+int64_t FrameClock::Next() {
+  int64_t pts = std::max<int64_t>(std::llround(position_), last_ + 1);
+  position_ += static_cast<double>(time_base_rate_) / framerate_;
+  last_ = pts;
+  return pts;
+}
+
+void FrameClock::Reset() {
+  framerate_ = time_base_rate_;
+  position_ = 0.0;
+  last_ = -1;
+}
+
+AVFrame* PrepareEncoderFrame(const VideoFrameView& view,
+                             AVFrame* owned,
+                             AVFrame* borrowed) {
+  if (!owned) {
+    return nullptr;
+  }
+
+  if (view.width != owned->width || view.height != owned->height) {
+    std::cerr << "Frame dimensions " << view.width << "x" << view.height
+              << " do not match encoder " << owned->width << "x"
+              << owned->height << std::endl;
+    return nullptr;
+  }
+
+  if (view.bit_depth != FrameBitDepth(owned)) {
+    std::cerr << "Frame bit depth " << view.bit_depth
+              << " does not match encoder bit depth " << FrameBitDepth(owned) << std::endl;
+    return nullptr;
+  }
+
+  if (!HasValidPlanes(view)) {
+    std::cerr << "Invalid frame planes or strides" << std::endl;
+    return nullptr;
+  }
+
+  AVFrame* frame = nullptr;
+  if (borrowed && CanBorrow(view, owned)) {
+    frame = BorrowPlanes(view, owned, borrowed);
+  } else {
+    const auto start = std::chrono::steady_clock::now();
+    frame = CopyPlanes(view, owned);
+    frame_copy_time_us += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+  }
+
+  if (frame) {
+    frame->pict_type = view.force_keyframe ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+  }
+  return frame;
+}
+
+int64_t TakeFrameCopyTime() {
+  const int64_t copy_time = frame_copy_time_us;
+  frame_copy_time_us = 0;
+  return copy_time;
+}
+
+}  // namespace media
\ No newline at end of file
@@ -0,0 +1,117 @@
+#ifndef MEDIA_VIDEO_FRAME_H_
+#define MEDIA_VIDEO_FRAME_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Forward declarations for FFmpeg structs
+extern "C" {
+struct AVFrame;
+}
+
+namespace media {
+
+// Supported video codecs
+enum class CodecType {
+  H264,    // H.264 / AVC
+  HEVC,    // H.265 / HEVC
+  VP8,     // VP8
+  VP9,     // VP9
+  AV1      // AV1
+};
+
+// Picture type of an encoded or decoded frame
+enum class FrameType {
+  kUnknown,
+  kI,
+  kP,
+  kB
+};
+
+// YUV matrix used when converting from RGB
+enum class ColorMatrix {
+  BT601,  // SD video and most capture APIs
+  BT709   // HD video
+};
+
+// Sample range of the YUV output
+enum class ColorRange {
+  LIMITED,  // Y in [16, 235], UV in [16, 240]
+  FULL      // All components in [0, 255]
+};
+
+// Maps an AVPictureType value to FrameType
+FrameType FrameTypeFromPictureType(int pict_type);
+
+// Describes a caller-owned planar YUV 4:2:0 picture. Rows may be padded;
+// |stride| is the distance in bytes between the starts of two rows.
+// The planes only need to stay valid for the duration of the encode call.
+struct VideoFrameView {
+  const uint8_t* data[3] = {nullptr, nullptr, nullptr};  // Y, U and V planes
+  int stride[3] = {0, 0, 0};                             // Bytes per row of each plane
+  int width = 0;
+  int height = 0;
+  int64_t pts = -1;  // Presentation timestamp (-1 = use the encoder's frame counter)
+  bool force_keyframe = false;  // Ask the encoder to code this frame as a keyframe
+  int bit_depth = 8;  // 8, or 10/12 for little-endian 16-bit samples (YUV420P10)
+
+  // Builds a view over a tightly packed YUV420 buffer of width * height * 3 / 2 bytes
+  static VideoFrameView FromYUV420(const uint8_t* yuv_data, int width, int height);
+
+  // Same for 16-bit samples holding |bit_depth| bits; the buffer is twice as large
+  static VideoFrameView FromYUV420(const uint8_t* yuv_data, int width, int height,
+                                   int bit_depth);
+};
+
+// Bytes in a tightly packed YUV 4:2:0 picture, with odd sizes rounded up for
+// chroma and two bytes per sample above 8 bits
+size_t YUV420BufferSize(int width, int height, int bit_depth = 8);
+
+// Generates encoder timestamps in the time base the codec was opened with,
+// 1/|time_base_rate|. Lowering the frame rate spaces the timestamps further
+// apart, so timestamp-driven rate control follows the new rate without the
+// codec being reopened.
+class FrameClock {
+ public:
+  explicit FrameClock(int time_base_rate = 30);
+
+  // Returns false if |framerate| is not within 1..time_base_rate
+  bool SetFramerate(int framerate);
+
+  // Timestamp for the next frame; strictly increasing
+  int64_t Next();
+
+  // Restart from timestamp zero at the time base rate
+  void Reset();
+
+  int framerate() const { return framerate_; }
+
+ private:
+  int time_base_rate_;
+  int framerate_;
+  double position_ = 0.0;  // Ideal timestamp of the next frame
+  int64_t last_ = -1;
+};
+
+// Selects the frame to hand to avcodec_send_frame() for |view|.
+// |owned| may be 8-bit or high bit depth 4:2:0 (YUV420P10 and the like);
+// the view's bit_depth must match it.
+// When |borrowed| is given and the view layout is compatible with |owned|
+// (same format, 16-byte aligned planes and strides) |borrowed| is pointed
+// straight at the caller planes and no bytes are copied. Otherwise the view
+// is copied once, row by row, into the buffers of |owned|.
+// The returned frame requests a keyframe when |view.force_keyframe| is set.
+// Returns nullptr if the view does not match the dimensions of |owned|.
+// Callers should av_frame_unref() |borrowed| once the frame has been sent.
+AVFrame* PrepareEncoderFrame(const VideoFrameView& view,
+                             AVFrame* owned,
+                             AVFrame* borrowed);
+
+// Returns the microseconds PrepareEncoderFrame() spent copying input planes
+// on the calling thread since the previous call, and restarts the count.
+// Borrowed frames add nothing.
+int64_t TakeFrameCopyTime();
+
+}  // namespace media
+
+#endif  // MEDIA_VIDEO_FRAME_H_
\ No newline at end of file
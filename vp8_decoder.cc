@@ -53,9 +53,6 @@ bool VP8Decoder::Initialize(const VP8DecoderConfig& config) {
     codec_context_->flags = config.flags;
     codec_context_->flags2 = config.flags2;
     
-    // Set output format
-    codec_context_->pix_fmt = static_cast<AVPixelFormat>(config.pixel_format);
-    
     // Decoder mode
     codec_context_->flags |= config.low_delay ? AV_CODEC_FLAG_LOW_DELAY : 0;
     
@@ -120,32 +117,89 @@ bool VP8Decoder::Initialize(const VP8DecoderConfig& config) {
 }
 
 int VP8Decoder::DecodeToYUV420(const std::vector<uint8_t>& vp8_frame, std::vector<uint8_t>* yuv_data) {
-    av_packet_unref(packet_);
-    packet_->data = const_cast<uint8_t*>(vp8_frame.data());
-    packet_->size = vp8_frame.size();
+    media::DecodedFrame frame;
+    if (!Decode(vp8_frame, &frame)) {
+        return false;
+    }
 
-    if (avcodec_send_packet(codec_context_, packet_) < 0) {
-        std::cerr << "Failed to send packet" << std::endl;
+    if (!frame.empty() && !frame.CopyTo(yuv_data, config_.pixel_format)) {
         return false;
     }
 
+    return true;
+}
+
+int VP8Decoder::Decode(const std::vector<uint8_t>& vp8_frame, media::DecodedFrame* frame) {
+    if (vp8_frame.empty()) {
+        // End of stream: queue what the decoder still holds
+        Drain();
+    } else {
+        av_packet_unref(packet_);
+        packet_->data = const_cast<uint8_t*>(vp8_frame.data());
+        packet_->size = vp8_frame.size();
+
+        if (SendPacket(packet_) < 0) {
+            std::cerr << "Failed to send packet" << std::endl;
+            return false;
+        }
+    }
+
+    // Hand the oldest picture over without a copy; later ones stay queued
+    // for ReceiveFrames() instead of being dropped
+    if (!pending_.empty()) {
+        *frame = pending_.front();
+        pending_.pop_front();
+    } else if (avcodec_receive_frame(codec_context_, frame_) >= 0) {
+        *frame = media::DecodedFrame::TakeFrom(frame_);
+    }
+
+    return true;
+}
+
+int VP8Decoder::ReceiveFrames(std::vector<media::DecodedFrame>* frames) {
+    if (!frames) {
+        return 0;
+    }
+
+    int count = static_cast<int>(pending_.size());
+    frames->insert(frames->end(), pending_.begin(), pending_.end());
+    pending_.clear();
     while (avcodec_receive_frame(codec_context_, frame_) >= 0) {
-        int width = frame_->width;
-        int height = frame_->height;
-        int y_size = width * height;
-        int uv_size = y_size / 4;
+        frames->push_back(media::DecodedFrame::TakeFrom(frame_));
+        count++;
+    }
+    return count;
+}
 
-        yuv_data->resize(y_size + uv_size * 2);
-        uint8_t* yuv_ptr = yuv_data->data();
+int VP8Decoder::Flush(std::vector<media::DecodedFrame>* frames) {
+    if (!frames) {
+        return 0;
+    }
 
-        for (int i = 0; i < height; ++i)
-            memcpy(yuv_ptr + i * width, frame_->data[0] + i * frame_->linesize[0], width);
+    Drain();
+    return ReceiveFrames(frames);
+}
 
-        for (int i = 0; i < height / 2; ++i) {
-            memcpy(yuv_ptr + y_size + i * (width / 2), frame_->data[1] + i * frame_->linesize[1], width / 2);
-            memcpy(yuv_ptr + y_size + uv_size + i * (width / 2), frame_->data[2] + i * frame_->linesize[2], width / 2);
+int VP8Decoder::SendPacket(const AVPacket* packet) {
+    int ret = avcodec_send_packet(codec_context_, packet);
+    if (ret == AVERROR(EAGAIN)) {
+        while (avcodec_receive_frame(codec_context_, frame_) >= 0) {
+            pending_.push_back(media::DecodedFrame::TakeFrom(frame_));
         }
+        ret = avcodec_send_packet(codec_context_, packet);
     }
+    return ret;
+}
 
-    return true;
+void VP8Decoder::Drain() {
+    if (SendPacket(nullptr) >= 0) {
+        while (avcodec_receive_frame(codec_context_, frame_) >= 0) {
+            pending_.push_back(media::DecodedFrame::TakeFrom(frame_));
+        }
+    }
+    avcodec_flush_buffers(codec_context_);
+}
+
+int VP8Decoder::GetDelay() const {
+    return media::DecoderDelay(codec_context_);
 }
\ No newline at end of file
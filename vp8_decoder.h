@@ -4,6 +4,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
 extern "C" {
@@ -12,6 +13,8 @@ extern "C" {
     #include <libavutil/opt.h>
 }
 
+#include "media_decoded_frame.h"
+
 struct VP8DecoderConfig {
     // Basic decoding parameters
     int width = 0;             // Width of the frame (0 for auto-detection)
@@ -31,7 +34,7 @@ struct VP8DecoderConfig {
     int flags = 0;             // Decoder flags (AV_CODEC_FLAG_*)
     int flags2 = 0;            // Additional decoder flags (AV_CODEC_FLAG2_*)
     
-    // Decoder output format
+    // Layout written by DecodeToYUV420: AV_PIX_FMT_YUV420P or AV_PIX_FMT_NV12
     int pixel_format = AV_PIX_FMT_YUV420P; // Output pixel format
     
     // Decoder mode
@@ -67,6 +70,24 @@ public:
     static std::shared_ptr<VP8Decoder> Create(const VP8DecoderConfig& config);
     int DecodeToYUV420(const std::vector<uint8_t>& vp8_frame, std::vector<uint8_t>* yuv_data);
 
+    // Decodes without copying the picture; |frame| references the decoder's
+    // buffers and is left empty when no picture is ready yet. An empty
+    // packet ends the stream and hands out one remaining picture per call.
+    int Decode(const std::vector<uint8_t>& vp8_frame, media::DecodedFrame* frame);
+
+    // Appends the frames still queued after Decode(), which only returns
+    // one; frame threading can release several per packet.
+    // Returns the number of frames appended
+    int ReceiveFrames(std::vector<media::DecodedFrame>* frames);
+
+    // Ends the stream: appends every picture still buffered to |frames| and
+    // leaves the decoder ready for a new stream.
+    // Returns the number of frames appended
+    int Flush(std::vector<media::DecodedFrame>* frames);
+
+    // Frames the decoder holds back before output (frame threads)
+    int GetDelay() const;
+
     // Make the destructor public
     ~VP8Decoder();
 
@@ -74,10 +95,21 @@ private:
     VP8Decoder();
     bool Initialize(const VP8DecoderConfig& config);
 
+    // Sends |packet| (nullptr to drain); on EAGAIN the ready pictures move
+    // to pending_ and the packet is sent again
+    int SendPacket(const AVPacket* packet);
+
+    // Sends the end of stream, queues every picture left and resets the
+    // decoder for the next stream
+    void Drain();
+
     AVCodecContext* codec_context_;
     AVFrame* frame_;
     AVPacket* packet_;
     VP8DecoderConfig config_;
+
+    // Pictures taken out of the decoder ahead of the caller, oldest first
+    std::deque<media::DecodedFrame> pending_;
 };
 
 #endif // VP8_DECODER_H
\ No newline at end of file
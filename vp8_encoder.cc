@@ -30,10 +30,22 @@ VP8Encoder::VP8Encoder(const VP8EncoderConfig& config)
     : initialized_(false),
       first_pass_complete_(false),
       config_(config),
-      codec_context_(nullptr) {
+      codec_context_(nullptr),
+      frame_(nullptr),
+      input_frame_(nullptr),
+      packet_(nullptr) {
 }
 
 VP8Encoder::~VP8Encoder() {
+    if (frame_) {
+        av_frame_free(&frame_);
+    }
+    if (input_frame_) {
+        av_frame_free(&input_frame_);
+    }
+    if (packet_) {
+        av_packet_free(&packet_);
+    }
     if (codec_context_) {
         avcodec_free_context(&codec_context_);
     }
@@ -105,10 +117,13 @@ bool VP8Encoder::ApplyCodecOptions(const VP8EncoderConfig& config) {
             break;
     }
     
-    // Keyframe settings
+    // Keyframe settings. libvpx only places keyframes on its own while the
+    // minimum and maximum distance differ.
     codec_context_->gop_size = config.keyframe_interval;
-    if (config.keyframe_min_interval > 0) {
-        av_opt_set_int(codec_context_->priv_data, "keyint_min", config.keyframe_min_interval, 0);
+    if (!config.auto_keyframe) {
+        codec_context_->keyint_min = config.keyframe_interval;
+    } else if (config.keyframe_min_interval > 0) {
+        codec_context_->keyint_min = config.keyframe_min_interval;
     }
     
     // Deadline/speed control
@@ -162,81 +177,139 @@ bool VP8Encoder::ApplyCodecOptions(const VP8EncoderConfig& config) {
         return false;
     }
     
+    if (!AllocateFrames()) {
+        avcodec_free_context(&codec_context_);
+        return false;
+    }
+    
+    clock_ = FrameClock(config.framerate);
     initialized_ = true;
     return true;
 }
 
-int VP8Encoder::EncodeYUV420(const std::vector<uint8_t>& yuv_data, std::vector<uint8_t>* encoded_frame) {
-    if (!initialized_ || !codec_context_) {
-        return 0;
+bool VP8Encoder::AllocateFrames() {
+    // Reallocate so the frame always matches the (re)opened codec context
+    if (frame_) {
+        av_frame_free(&frame_);
     }
     
-    AVPacket* pkt = av_packet_alloc();
-    if (!pkt) return 0;
-
-    AVFrame* frame = av_frame_alloc();
-    if (!frame) {
-        av_packet_free(&pkt);
-        return 0;
+    frame_ = av_frame_alloc();
+    if (!frame_) {
+        return false;
     }
-
-    frame->format = codec_context_->pix_fmt;
-    frame->width = codec_context_->width;
-    frame->height = codec_context_->height;
-
-    // Allocate frame buffers
-    if (av_frame_get_buffer(frame, 0) < 0) {
-        av_frame_free(&frame);
-        av_packet_free(&pkt);
-        return 0;
+    
+    frame_->format = codec_context_->pix_fmt;
+    frame_->width = codec_context_->width;
+    frame_->height = codec_context_->height;
+    
+    if (av_frame_get_buffer(frame_, 0) < 0) {
+        av_frame_free(&frame_);
+        return false;
     }
     
-    // Make sure frame is writable
-    if (av_frame_make_writable(frame) < 0) {
-        av_frame_free(&frame);
-        av_packet_free(&pkt);
-        return 0;
+    if (!input_frame_) {
+        input_frame_ = av_frame_alloc();
+        if (!input_frame_) {
+            return false;
+        }
     }
+    
+    if (!packet_) {
+        packet_ = av_packet_alloc();
+        if (!packet_) {
+            return false;
+        }
+    }
+    
+    return true;
+}
 
+int VP8Encoder::EncodeYUV420(const std::vector<uint8_t>& yuv_data, std::vector<uint8_t>* encoded_frame) {
+    if (!initialized_ || !codec_context_) {
+        return 0;
+    }
+    
     // Calculate plane sizes
     int y_size = codec_context_->width * codec_context_->height;
     int uv_size = y_size / 4;
     
     // Make sure we have enough data
     if (yuv_data.size() < y_size + 2 * uv_size) {
-        av_frame_free(&frame);
-        av_packet_free(&pkt);
         return 0;
     }
     
-    // Copy data to frame planes - Y plane
-    std::copy(yuv_data.begin(), yuv_data.begin() + y_size, frame->data[0]);
+    return EncodeYUV420(VideoFrameView::FromYUV420(yuv_data.data(),
+                                                   codec_context_->width,
+                                                   codec_context_->height),
+                        encoded_frame);
+}
+
+int VP8Encoder::EncodeYUV420(const VideoFrameView& frame, std::vector<uint8_t>* encoded_frame) {
+    if (!encoded_frame) {
+        return 0;
+    }
     
-    // U plane
-    std::copy(yuv_data.begin() + y_size, yuv_data.begin() + y_size + uv_size, frame->data[1]);
+    std::vector<EncodedPacket> packets;
+    if (!EncodeYUV420(frame, &packets) || packets.empty()) {
+        return 0;
+    }
     
-    // V plane
-    std::copy(yuv_data.begin() + y_size + uv_size, yuv_data.begin() + y_size + 2 * uv_size, frame->data[2]);
+    encoded_frame->clear();
+    AppendPackets(packets, encoded_frame);
+    return 1;
+}
 
-    int ret = avcodec_send_frame(codec_context_, frame);
+int VP8Encoder::EncodeYUV420(const VideoFrameView& frame, std::vector<EncodedPacket>* packets) {
+    if (!initialized_ || !codec_context_ || !packets) {
+        return 0;
+    }
+    
+    // Reference the caller planes directly or copy them into frame_
+    AVFrame* input = PrepareEncoderFrame(frame, frame_, input_frame_);
+    if (!input) {
+        return 0;
+    }
+    
+    int64_t pts = clock_.Next();
+    input->pts = frame.pts >= 0 ? frame.pts : pts;
+
+    int ret = avcodec_send_frame(codec_context_, input);
+    av_frame_unref(input_frame_);
     if (ret < 0) {
-        av_frame_free(&frame);
-        av_packet_free(&pkt);
         return 0;
     }
 
-    ret = avcodec_receive_packet(codec_context_, pkt);
-    if (ret == 0) {
-        encoded_frame->resize(pkt->size);
-        std::copy(pkt->data, pkt->data + pkt->size, encoded_frame->begin());
-        av_packet_free(&pkt);
-        av_frame_free(&frame);
-        return 1;
+    packets->clear();
+    while ((ret = avcodec_receive_packet(codec_context_, packet_)) == 0) {
+        packets->push_back(EncodedPacket::TakeFrom(packet_));
     }
 
-    av_frame_free(&frame);
-    av_packet_free(&pkt);
-    return 0;
+    return (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) ? 1 : 0;
+}
+
+bool VP8Encoder::UpdateRateControl(int bitrate, int max_bitrate, int buffer_size, int framerate) {
+    if (!initialized_ || !codec_context_) {
+        return false;
+    }
+    
+    // FFmpeg hands the bitrate and buffer targets to libvpx only when the
+    // codec is opened, so they cannot change on a running encoder
+    if (bitrate > 0 || max_bitrate > 0 || buffer_size > 0) {
+        std::cerr << "Bitrate and VBV updates are not supported by the running VP8 encoder"
+                  << std::endl;
+        return false;
+    }
+    
+    // The time base is fixed once the codec is open, so a lower rate is
+    // expressed through wider timestamp spacing, which libvpx rate control
+    // follows frame by frame
+    if (framerate > 0 && !clock_.SetFramerate(framerate)) {
+        std::cerr << "Frame rate " << framerate
+                  << " exceeds the rate the encoder was opened with" << std::endl;
+        return false;
+    }
+    
+    return true;
 }
 
 bool VP8Encoder::StartFirstPass() {
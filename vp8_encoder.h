@@ -11,6 +11,9 @@ extern "C" {
     #include <libavutil/opt.h>
 }
 
+#include "media_encoded_packet.h"
+#include "media_video_frame.h"
+
 namespace media {
 
 // Enhanced VP8 encoder configuration with all possible parameters
@@ -124,6 +127,20 @@ public:
 
     int EncodeYUV420(const std::vector<uint8_t>& yuv_data, std::vector<uint8_t>* encoded_frame);
     
+    // Encodes a YUV420 frame described by plane pointers and strides without
+    // repacking it first; planes are copied at most once into the encoder frame
+    int EncodeYUV420(const VideoFrameView& frame, std::vector<uint8_t>* encoded_frame);
+    
+    // Encodes a frame and returns every packet the encoder produced for it,
+    // referencing the encoder's buffers instead of copying them. Returns 1 on
+    // success, including when the encoder is still buffering input
+    int EncodeYUV420(const VideoFrameView& frame, std::vector<EncodedPacket>* packets);
+    
+    // Change the frame rate of the running encoder, up to the rate it was
+    // opened with. libvpx takes bitrate and buffer size only when it is
+    // opened, so nonzero values for them are rejected.
+    bool UpdateRateControl(int bitrate, int max_bitrate, int buffer_size, int framerate);
+    
     // For two-pass encoding
     bool StartFirstPass();
     bool StartSecondPass();
@@ -135,10 +152,17 @@ private:
     // Apply config settings to codec context
     bool ApplyCodecOptions(const VP8EncoderConfig& config);
     
+    // Allocate the reusable frame and packet once the codec is open
+    bool AllocateFrames();
+    
     bool initialized_;
     bool first_pass_complete_;
     VP8EncoderConfig config_;
     AVCodecContext* codec_context_;
+    AVFrame* frame_;
+    AVFrame* input_frame_;      // References caller planes, never owns them
+    AVPacket* packet_;
+    FrameClock clock_;          // Timestamps in the time base the codec was opened with
 };
 
 } // namespace media
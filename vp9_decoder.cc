@@ -10,6 +10,7 @@ extern "C" {
 }
 
 #include <cstring>
+#include <deque>
 #include <iostream>
 #include <fstream>
 
@@ -86,19 +87,45 @@ class FFmpegVP9Decoder : public VP9Decoder {
 
   int DecodeToYUV420(const std::vector<uint8_t>& vp9_frame,
                     std::vector<uint8_t>* yuv_data) override {
-    if (!initialized_ && !Initialize()) {
+    if (!yuv_data) {
+      return 0;
+    }
+
+    DecodedFrame frame;
+    if (Decode(vp9_frame, &frame) <= 0) {
       return 0;
     }
 
-    if (vp9_frame.empty() || !yuv_data) {
+    // Pack the planes into the output buffer in the requested layout,
+    // honoring each plane's stride
+    if (!frame.CopyTo(yuv_data, config_.pixel_format)) {
       return 0;
     }
 
+    return 1;
+  }
+
+  int Decode(const std::vector<uint8_t>& vp9_frame,
+             DecodedFrame* frame) override {
+    if (!initialized_ && !Initialize()) {
+      return -1;
+    }
+
+    if (!frame) {
+      return -1;
+    }
+
+    // End of stream: queue what the decoder still holds
+    if (vp9_frame.empty()) {
+      Drain();
+      return NextFrame(frame);
+    }
+
     // Create packet
     AVPacket* packet = av_packet_alloc();
     if (!packet) {
       std::cerr << "Could not allocate packet!" << std::endl;
-      return 0;
+      return -1;
     }
 
     // Set packet data
@@ -106,56 +133,44 @@ class FFmpegVP9Decoder : public VP9Decoder {
     packet->size = static_cast<int>(vp9_frame.size());
 
     // Send packet to decoder
-    int ret = avcodec_send_packet(codec_context_, packet);
+    int ret = SendPacket(packet);
     if (ret < 0) {
       std::cerr << "Error sending packet for decoding: " << error_to_string(ret) << std::endl;
       av_packet_free(&packet);
-      return 0;
-    }
-
-    // Receive frame from decoder
-    ret = avcodec_receive_frame(codec_context_, frame_);
-    if (ret < 0) {
-      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-        // Need more data or end of file
-        av_packet_free(&packet);
-        return 0;
-      }
-      std::cerr << "Error during decoding: " << error_to_string(ret) << std::endl;
-      av_packet_free(&packet);
-      return 0;
+      return ret;
     }
 
-    // Update width and height
-    width_ = frame_->width;
-    height_ = frame_->height;
-
-    // Convert frame data to YUV420 format and store in yuv_data
-    size_t y_size = frame_->width * frame_->height;
-    size_t u_size = (frame_->width / 2) * (frame_->height / 2);
-    size_t v_size = u_size;
-    size_t total_size = y_size + u_size + v_size;
-
-    yuv_data->resize(total_size);
+    // Clean up
+    av_packet_free(&packet);
 
-    // Copy Y plane
-    std::memcpy(yuv_data->data(), frame_->data[0], y_size);
+    return NextFrame(frame);
+  }
 
-    // Copy U plane
-    std::memcpy(yuv_data->data() + y_size, frame_->data[1], u_size);
+  int ReceiveFrames(std::vector<DecodedFrame>* frames) override {
+    if (!initialized_ || !frames) {
+      return 0;
+    }
 
-    // Copy V plane
-    std::memcpy(yuv_data->data() + y_size + u_size, frame_->data[2], v_size);
+    int count = 0;
+    DecodedFrame frame;
+    while (NextFrame(&frame) > 0) {
+      frames->push_back(frame);
+      count++;
+    }
+    return count;
+  }
 
-    // Handle debug visualization if enabled
-    if (config_.debug_visualization) {
-      DumpFrameForDebug();
+  int Flush(std::vector<DecodedFrame>* frames) override {
+    if (!initialized_ || !frames) {
+      return 0;
     }
 
-    // Clean up
-    av_packet_free(&packet);
+    Drain();
+    return ReceiveFrames(frames);
+  }
 
-    return 1;
+  int GetDelay() const override {
+    return initialized_ ? DecoderDelay(codec_context_) : 0;
   }
 
   int GetWidth() const override {
@@ -167,6 +182,7 @@ class FFmpegVP9Decoder : public VP9Decoder {
   }
 
   void Reset() override {
+    pending_.clear();
     if (initialized_) {
       avcodec_flush_buffers(codec_context_);
     }
@@ -215,6 +231,75 @@ class FFmpegVP9Decoder : public VP9Decoder {
   }
 
  private:
+  // Takes the next ready picture from the decoder; 1 if there was one
+  int ReceiveFrame(DecodedFrame* frame) {
+    int ret = avcodec_receive_frame(codec_context_, frame_);
+    if (ret < 0) {
+      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+        // Need more data or end of file
+        return 0;
+      }
+      std::cerr << "Error during decoding: " << error_to_string(ret) << std::endl;
+      return ret;
+    }
+
+    // Update width and height
+    width_ = frame_->width;
+    height_ = frame_->height;
+
+    // Handle debug visualization if enabled
+    if (config_.debug_visualization) {
+      DumpFrameForDebug();
+    }
+
+    // High bit depth pictures stay native only when the caller asked for them
+    if (!config_.output_10bit && !ReduceTo8Bit(frame_)) {
+      av_frame_unref(frame_);
+      return -1;
+    }
+
+    // Hand the decoder's buffers to the caller without copying them
+    *frame = DecodedFrame::TakeFrom(frame_);
+
+    return 1;
+  }
+
+  // Hands out the oldest picture, queued ones first; 1 if there was one
+  int NextFrame(DecodedFrame* frame) {
+    if (pending_.empty()) {
+      return ReceiveFrame(frame);
+    }
+    *frame = pending_.front();
+    pending_.pop_front();
+    return 1;
+  }
+
+  // Sends a packet (nullptr to drain). On EAGAIN the ready pictures move to
+  // pending_ and the packet is sent again instead of being lost.
+  int SendPacket(const AVPacket* packet) {
+    int ret = avcodec_send_packet(codec_context_, packet);
+    if (ret == AVERROR(EAGAIN)) {
+      DecodedFrame frame;
+      while (ReceiveFrame(&frame) > 0) {
+        pending_.push_back(frame);
+      }
+      ret = avcodec_send_packet(codec_context_, packet);
+    }
+    return ret;
+  }
+
+  // Sends the end of stream, queues every picture left and resets the
+  // decoder for the next stream
+  void Drain() {
+    if (SendPacket(nullptr) >= 0) {
+      DecodedFrame frame;
+      while (ReceiveFrame(&frame) > 0) {
+        pending_.push_back(frame);
+      }
+    }
+    avcodec_flush_buffers(codec_context_);
+  }
+
   void Cleanup() {
     if (parser_context_) {
       av_parser_close(parser_context_);
@@ -383,6 +468,9 @@ class FFmpegVP9Decoder : public VP9Decoder {
   bool initialized_;
   int width_;
   int height_;
+
+  // Pictures taken out of the decoder ahead of the caller, oldest first
+  std::deque<DecodedFrame> pending_;
 };
 
 }  // namespace
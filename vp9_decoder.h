@@ -6,6 +6,8 @@
 #include <cstdint>
 #include <string>
 
+#include "media_decoded_frame.h"
+
 namespace media {
 
 struct VP9DecoderConfig {
@@ -46,6 +48,8 @@ struct VP9DecoderConfig {
   
   // Color conversion options
   bool full_range = false;  // Output YUV in full range (0-255) instead of limited (16-235)
+  int pixel_format = -1;  // DecodeToYUV420 layout: AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12 or -1 (decoder's own)
+  bool output_10bit = false;  // Hand out profile 2 pictures as YUV420P10 instead of rounding to 8 bits
   int color_primaries = 0;  // Color primaries override (0=from stream)
   int color_trc = 0;  // Transfer characteristics override (0=from stream)
   int colorspace = 0;  // Colorspace override (0=from stream)
@@ -64,11 +68,35 @@ class VP9Decoder {
 
   virtual ~VP9Decoder() = default;
 
-  // Decode a VP9 frame to YUV420 format
+  // Decode a VP9 frame to YUV420 format. With output_10bit, 10-bit frames
+  // are written as YUV420P10 (two bytes per sample).
   // Returns 1 on success, 0 on failure
   virtual int DecodeToYUV420(const std::vector<uint8_t>& vp9_frame,
                             std::vector<uint8_t>* yuv_data) = 0;
 
+  // Decode a VP9 frame without copying the picture. |frame| references the
+  // decoder's buffers and stays valid across later calls.
+  // An empty packet ends the stream; each such call then hands out one of
+  // the remaining pictures until 0 is returned.
+  // Returns 1 if a frame was output, 0 if more data is needed, negative on error
+  virtual int Decode(const std::vector<uint8_t>& vp9_frame,
+                     DecodedFrame* frame) = 0;
+
+  // Decode() returns at most one frame per packet. With frame threading a
+  // packet can release several, so call this after each Decode() to
+  // collect the rest; they are appended to |frames| in output order.
+  // Returns the number of frames appended
+  virtual int ReceiveFrames(std::vector<DecodedFrame>* frames) = 0;
+
+  // Ends the stream: appends every picture still buffered to |frames| and
+  // leaves the decoder ready for a new stream.
+  // Returns the number of frames appended
+  virtual int Flush(std::vector<DecodedFrame>* frames) = 0;
+
+  // Frames the decoder holds back before output (reorder buffer plus frame
+  // threads), i.e. how far output lags input
+  virtual int GetDelay() const = 0;
+
   // Get the width of the decoded frames
   virtual int GetWidth() const = 0;
 
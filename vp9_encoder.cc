@@ -4,6 +4,7 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
 }
 
 #include <cstring>
@@ -38,6 +39,14 @@ class VP9EncoderImpl : public VP9Encoder {
   bool EncodeYUV420(const std::vector<uint8_t>& yuv_data,
                    std::vector<uint8_t>* encoded_frame) override;
 
+  // Encodes a frame described by plane pointers and strides.
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<uint8_t>* encoded_frame) override;
+
+  // Encodes a frame and returns the packets it produced.
+  bool EncodeYUV420(const VideoFrameView& frame,
+                   std::vector<EncodedPacket>* packets) override;
+
   // Returns the current configuration of the encoder.
   const VP9EncoderConfig& GetConfig() const override { return config_; }
   
@@ -47,6 +56,10 @@ class VP9EncoderImpl : public VP9Encoder {
   // Update framerate at runtime
   bool UpdateFramerate(int new_framerate) override;
 
+  // Update rate control targets at runtime
+  bool UpdateRateControl(int bitrate, int max_bitrate,
+                         int buffer_size, int framerate) override;
+
  private:
   VP9EncoderImpl(const VP9EncoderConfig& config,
                 AVCodecContext* codec_context,
@@ -62,10 +75,11 @@ class VP9EncoderImpl : public VP9Encoder {
   // FFmpeg objects for encoding.
   AVCodecContext* codec_context_;
   AVFrame* frame_;
+  AVFrame* input_frame_ = nullptr;  // References caller planes, never owns them
   AVPacket* packet_;
   
-  // Track frame index for PTS
-  int64_t frame_index_ = 0;
+  // Timestamps in the time base the codec was opened with
+  FrameClock clock_;
 };
 
 std::unique_ptr<VP9EncoderImpl> VP9EncoderImpl::Create(
@@ -91,6 +105,12 @@ std::unique_ptr<VP9EncoderImpl> VP9EncoderImpl::Create(
   codec_context->framerate = AVRational{config.framerate, 1};
   codec_context->pix_fmt = AV_PIX_FMT_YUV420P;  // Default to YUV420P
   codec_context->codec_type = AVMEDIA_TYPE_VIDEO;
+  if (config.colorspace >= 0) {
+    codec_context->colorspace = static_cast<AVColorSpace>(config.colorspace);
+  }
+  if (config.color_range >= 0) {
+    codec_context->color_range = static_cast<AVColorRange>(config.color_range);
+  }
   
   // Apply profile-specific settings
   if (config.profile == VP9Profile::PROFILE_1 || 
@@ -163,8 +183,19 @@ std::unique_ptr<VP9EncoderImpl> VP9EncoderImpl::Create(
     return nullptr;
   }
 
+  // Allocate the frame used to reference caller-owned planes
+  AVFrame* input_frame = av_frame_alloc();
+  if (!input_frame) {
+    std::cerr << "Failed to allocate input frame" << std::endl;
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&codec_context);
+    return nullptr;
+  }
+
   // Update the frame and packet pointers in our encoder
   encoder->frame_ = frame;
+  encoder->input_frame_ = input_frame;
   encoder->packet_ = packet;
   
   return encoder;
@@ -217,8 +248,12 @@ bool VP9EncoderImpl::ConfigureCodecContext(AVCodecContext* codec_context,
     av_opt_set_int(codec_context->priv_data, "lossless", 1, 0);
   }
   
-  // GOP structure
+  // GOP structure. libvpx only places keyframes on its own while the
+  // minimum and maximum distance differ.
   codec_context->gop_size = config.keyframe_interval;
+  if (!config.auto_keyframe) {
+    codec_context->keyint_min = config.keyframe_interval;
+  }
   
   if (config.auto_alt_ref) {
     av_opt_set_int(codec_context->priv_data, "auto-alt-ref", 1, 0);
@@ -316,7 +351,7 @@ VP9EncoderImpl::VP9EncoderImpl(const VP9EncoderConfig& config,
       codec_context_(codec_context),
       frame_(frame),
       packet_(packet),
-      frame_index_(0) {}
+      clock_(config.framerate) {}
 
 VP9EncoderImpl::~VP9EncoderImpl() {
   // Flush the encoder
@@ -327,13 +362,16 @@ VP9EncoderImpl::~VP9EncoderImpl() {
   }
   
   av_packet_free(&packet_);
+  av_frame_free(&input_frame_);
   av_frame_free(&frame_);
   avcodec_free_context(&codec_context_);
 }
 
 bool VP9EncoderImpl::EncodeYUV420(const std::vector<uint8_t>& yuv_data,
                                  std::vector<uint8_t>* encoded_frame) {
-  if (yuv_data.size() < (config_.width * config_.height * 3) / 2) {
+  // Profile 2 takes 10 or 12-bit samples in 16-bit words
+  const int bit_depth = av_pix_fmt_desc_get(codec_context_->pix_fmt)->comp[0].depth;
+  if (yuv_data.size() < YUV420BufferSize(config_.width, config_.height, bit_depth)) {
     std::cerr << "YUV data size too small for the specified resolution" << std::endl;
     return false;
   }
@@ -343,94 +381,109 @@ bool VP9EncoderImpl::EncodeYUV420(const std::vector<uint8_t>& yuv_data,
     return false;
   }
 
-  // Make sure the frame is writable
-  if (av_frame_make_writable(frame_) < 0) {
-    std::cerr << "Failed to make frame writable" << std::endl;
+  return EncodeYUV420(
+      VideoFrameView::FromYUV420(yuv_data.data(), config_.width, config_.height, bit_depth),
+      encoded_frame);
+}
+
+bool VP9EncoderImpl::EncodeYUV420(const VideoFrameView& frame,
+                                 std::vector<uint8_t>* encoded_frame) {
+  if (!encoded_frame) {
+    std::cerr << "Output buffer pointer is null" << std::endl;
     return false;
   }
 
-  // Copy Y plane
-  const size_t y_plane_size = config_.width * config_.height;
-  std::memcpy(frame_->data[0], yuv_data.data(), y_plane_size);
+  std::vector<EncodedPacket> packets;
+  if (!EncodeYUV420(frame, &packets)) {
+    return false;
+  }
 
-  // Copy U plane
-  const size_t u_plane_size = (config_.width * config_.height) / 4;
-  std::memcpy(frame_->data[1], yuv_data.data() + y_plane_size, u_plane_size);
+  encoded_frame->clear();
+  AppendPackets(packets, encoded_frame);
+  return true;
+}
 
-  // Copy V plane
-  const size_t v_plane_offset = y_plane_size + u_plane_size;
-  std::memcpy(frame_->data[2], yuv_data.data() + v_plane_offset, u_plane_size);
+bool VP9EncoderImpl::EncodeYUV420(const VideoFrameView& frame,
+                                 std::vector<EncodedPacket>* packets) {
+  if (!packets) {
+    std::cerr << "Output packet list pointer is null" << std::endl;
+    return false;
+  }
+
+  // Reference the caller planes directly or copy them into frame_
+  AVFrame* input = PrepareEncoderFrame(frame, frame_, input_frame_);
+  if (!input) {
+    return false;
+  }
 
   // Set the presentation timestamp
-  frame_->pts = frame_index_++;
+  int64_t pts = clock_.Next();
+  input->pts = frame.pts >= 0 ? frame.pts : pts;
 
   // Send the frame to the encoder
-  int ret = avcodec_send_frame(codec_context_, frame_);
+  int ret = avcodec_send_frame(codec_context_, input);
+  av_frame_unref(input_frame_);
   if (ret < 0) {
     std::cerr << "Error sending frame to encoder: " << ret << std::endl;
     return false;
   }
 
   // Get encoded packets
-  ret = avcodec_receive_packet(codec_context_, packet_);
-  if (ret < 0) {
-    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-      // EAGAIN means we need to feed more frames
-      // EOF means the encoder is flushed
-      // Both are not actual errors in this context
-      return true;
+  packets->clear();
+  while (true) {
+    ret = avcodec_receive_packet(codec_context_, packet_);
+    if (ret < 0) {
+      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+        // EAGAIN means we need to feed more frames
+        // EOF means the encoder is flushed
+        // Both are not actual errors in this context
+        return true;
+      }
+      std::cerr << "Error receiving packet from encoder: " << ret << std::endl;
+      return false;
     }
-    std::cerr << "Error receiving packet from encoder: " << ret << std::endl;
-    return false;
-  }
-
-  // Copy encoded data to output buffer
-  encoded_frame->resize(packet_->size);
-  std::memcpy(encoded_frame->data(), packet_->data, packet_->size);
 
-  // Unref the packet for reuse
-  av_packet_unref(packet_);
-
-  return true;
+    // Hand the packet buffer to the caller without copying it
+    packets->push_back(EncodedPacket::TakeFrom(packet_));
+  }
 }
 
 bool VP9EncoderImpl::UpdateBitrate(int new_bitrate) {
   if (new_bitrate <= 0) {
     return false;
   }
-  
-  // Update the bitrate in our configuration
-  config_.bitrate = new_bitrate;
-  
-  // Update the codec context
-  codec_context_->bit_rate = new_bitrate;
-  
-  // If we have min/max rates set, update them proportionally
-  if (config_.min_bitrate > 0) {
-    codec_context_->rc_min_rate = 
-        new_bitrate * config_.undershoot_pct / 100;
-  }
-  
-  if (config_.max_bitrate > 0) {
-    codec_context_->rc_max_rate = 
-        new_bitrate * config_.overshoot_pct / 100;
-  }
-  
-  return true;
+  return UpdateRateControl(new_bitrate, 0, 0, 0);
 }
 
 bool VP9EncoderImpl::UpdateFramerate(int new_framerate) {
   if (new_framerate <= 0) {
     return false;
   }
-  
-  // Update the framerate in our configuration
-  config_.framerate = new_framerate;
-  
-  // Update the codec context
-  codec_context_->time_base = (AVRational){1, new_framerate};
-  codec_context_->framerate = (AVRational){new_framerate, 1};
-  
+  return UpdateRateControl(0, 0, 0, new_framerate);
+}
+
+bool VP9EncoderImpl::UpdateRateControl(int bitrate, int max_bitrate,
+                                       int buffer_size, int framerate) {
+  // FFmpeg hands the bitrate and buffer targets to libvpx only when the
+  // codec is opened, so they cannot change on a running encoder
+  if (bitrate > 0 || max_bitrate > 0 || buffer_size > 0) {
+    std::cerr << "Bitrate and VBV updates are not supported by the running VP9 encoder"
+              << std::endl;
+    return false;
+  }
+
+  // The time base is fixed once the codec is open, so a lower rate is
+  // expressed through wider timestamp spacing, which libvpx rate control
+  // follows frame by frame
+  if (framerate > 0) {
+    if (!clock_.SetFramerate(framerate)) {
+      std::cerr << "Frame rate " << framerate
+                << " exceeds the rate the encoder was opened with" << std::endl;
+      return false;
+    }
+    config_.framerate = framerate;
+  }
+
   return true;
 }
 
@@ -6,6 +6,9 @@
 #include <string>
 #include <vector>
 
+#include "media_encoded_packet.h"
+#include "media_video_frame.h"
+
 namespace media {
 
 // Enum for VP9 quality modes
@@ -45,6 +48,7 @@ struct VP9EncoderConfig {
   
   // GOP (Group of Pictures) structure
   int keyframe_interval = 120;            // Maximum distance between keyframes
+  bool auto_keyframe = true;              // Let libvpx add keyframes before the interval ends
   bool auto_alt_ref = true;               // Enable/disable automatic alternate reference frames
   int lag_in_frames = 25;                 // Number of frames to look ahead for alternate reference frame selection
   
@@ -63,6 +67,8 @@ struct VP9EncoderConfig {
   // Profile settings
   VP9Profile profile = VP9Profile::PROFILE_0;  // VP9 profile
   int bit_depth = 8;                          // Bit depth (8, 10, 12)
+  int colorspace = -1;                        // AVColorSpace in the frame header (-1 = unspecified)
+  int color_range = -1;                       // AVColorRange (-1 = unspecified)
   
   // ROI (Region of Interest) settings
   bool roi_enabled = false;                   // Enable ROI-based encoding
@@ -97,14 +103,32 @@ class VP9Encoder {
   virtual bool EncodeYUV420(const std::vector<uint8_t>& yuv_data,
                            std::vector<uint8_t>* encoded_frame) = 0;
 
+  // Encodes a YUV420 frame described by plane pointers and strides.
+  // Planes are read in place when their layout allows it, otherwise they are
+  // copied once, row by row, into the encoder's frame.
+  virtual bool EncodeYUV420(const VideoFrameView& frame,
+                           std::vector<uint8_t>* encoded_frame) = 0;
+
+  // Encodes a frame and returns every packet the encoder produced for it.
+  // Packets reference the encoder's buffers directly and keep packet
+  // boundaries, timestamps and the keyframe flag.
+  virtual bool EncodeYUV420(const VideoFrameView& frame,
+                           std::vector<EncodedPacket>* packets) = 0;
+
   // Returns the current configuration of the encoder.
   virtual const VP9EncoderConfig& GetConfig() const = 0;
   
   // Set a new target bitrate at runtime
   virtual bool UpdateBitrate(int new_bitrate) = 0;
   
-  // Set a new framerate at runtime
+  // Set a new framerate at runtime, up to the rate the encoder was opened with
   virtual bool UpdateFramerate(int new_framerate) = 0;
+
+  // Change the frame rate of the running encoder, up to the rate it was
+  // opened with. libvpx takes bitrate and buffer size only when it is
+  // opened, so nonzero values for them are rejected.
+  virtual bool UpdateRateControl(int bitrate, int max_bitrate,
+                                 int buffer_size, int framerate) = 0;
 };
 
 }  // namespace media